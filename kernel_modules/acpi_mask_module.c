@@ -2,146 +2,306 @@
 #include <linux/kernel.h>
 #include <linux/kprobes.h>
 #include <linux/acpi.h>
-#include <linux/fs.h>
-#include <linux/file.h>
-#include <linux/uaccess.h>
+#include <linux/hashtable.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/printk.h>
 #include <linux/ctype.h>
 
-static struct kprobe kp;
+/*
+ * Every installed ACPI table is rewritten once at load and a reference is
+ * held on it until unload, so its mapping (and the patch) stays in place
+ * and later acpi_get_table() calls return the already-patched copy. Tables
+ * installed after load are patched on their first acpi_get_table() from a
+ * kretprobe. Each lookup after that is one hash probe.
+ */
 
-// Pointer to the original `acpi_get_table` function
-static acpi_status (*orig_acpi_get_table)(acpi_string signature, u32 instance, struct acpi_table_header **out_table) = acpi_get_table;
+static bool verbose;
+module_param(verbose, bool, 0644);
+MODULE_PARM_DESC(verbose, "Log each patched table and dump its first 64 bytes (default off)");
 
-// Function to update the checksum for an ACPI table
-static void update_acpi_table_checksum(struct acpi_table_header *table, size_t length) {
+// Known virtualization artifacts and their generic replacements
+struct mask_rule {
+    const char *target;
+    const char *replacement;   // truncated or space-padded to the target length
+};
+
+static const struct mask_rule mask_rules[] = {
+    { "QEMU",    "GENUINE" },
+    { "VMWARE",  "MICROSFT" },
+    { "EDK2",    "BIOSV" },
+    { "BXPC",    "SYSC " },
+    { "VIRTUAL", "REAL  " },
+};
+
+#define MASK_MAX_STATES 64
+
+// Aho-Corasick automaton over the rule targets, ASCII case-folded, built at load
+static u8 ac_next[MASK_MAX_STATES][256];
+static s8 ac_rule[MASK_MAX_STATES];    // rule ending at the state, -1 if none
+static unsigned int ac_states;
+
+/*
+ * One table we have patched. The header as we left it (signature, OEM and
+ * table IDs, length, checksum) tells our patched copy from a fresh mapping,
+ * or from a different table, that later lands at the same address.
+ */
+struct patched_table {
+    struct hlist_node node;
+    struct acpi_table_header *table;
+    struct acpi_table_header header;
+    bool held;                          // reference taken at load, dropped at unload
+};
+
+static DEFINE_HASHTABLE(patched_tables, 7);
+static DEFINE_SPINLOCK(patched_lock);
+static unsigned int patched_count;
+
+static int build_matcher(void) {
+    u8 fail[MASK_MAX_STATES] = { 0 };
+    u8 queue[MASK_MAX_STATES];
+    unsigned int head = 0, tail = 0;
+    size_t r, i;
+    int c;
+
+    memset(ac_next, 0, sizeof(ac_next));
+    memset(ac_rule, -1, sizeof(ac_rule));
+    ac_states = 1;
+
+    // Trie; 0 means "no edge" while building since the root is never a child
+    for (r = 0; r < ARRAY_SIZE(mask_rules); r++) {
+        const char *target = mask_rules[r].target;
+        unsigned int state = 0;
+
+        for (i = 0; target[i]; i++) {
+            u8 lc = tolower(target[i]);
+
+            if (!ac_next[state][lc]) {
+                if (ac_states == MASK_MAX_STATES)
+                    return -ENOSPC;
+                ac_next[state][lc] = ac_states;
+                ac_next[state][toupper(lc)] = ac_states;
+                ac_states++;
+            }
+            state = ac_next[state][lc];
+        }
+        ac_rule[state] = r;
+    }
+
+    // Breadth-first: resolve failure links into the transition table.
+    // Upper-case columns share the lower-case child, so only queue it once.
+    for (c = 0; c < 256; c++) {
+        if (ac_next[0][c] && c == tolower(c))
+            queue[tail++] = ac_next[0][c];
+    }
+    while (head < tail) {
+        unsigned int state = queue[head++];
+
+        if (ac_rule[state] < 0)
+            ac_rule[state] = ac_rule[fail[state]];
+        for (c = 0; c < 256; c++) {
+            u8 child = ac_next[state][c];
+            u8 fallback = ac_next[fail[state]][c];
+
+            if (!child) {
+                ac_next[state][c] = fallback;
+            } else if (c == tolower(c)) {
+                fail[child] = fallback;
+                queue[tail++] = child;
+            }
+        }
+    }
+    return 0;
+}
+
+static void update_acpi_table_checksum(struct acpi_table_header *table) {
     unsigned char *bytes = (unsigned char *)table;
     unsigned char sum = 0;
-    size_t i;
+    u32 i;
 
-    for (i = 0; i < length; i++) {
-        if (i != offsetof(struct acpi_table_header, checksum))
-            sum += bytes[i];
-    }
+    table->checksum = 0;
+    for (i = 0; i < table->length; i++)
+        sum += bytes[i];
     table->checksum = (unsigned char)(0 - sum);
 }
 
-// Function to print a portion of the ACPI table in hex format
-static void print_acpi_table_hex(struct acpi_table_header *table, size_t length) {
-    size_t i;
-    pr_info("ACPI Table Dump (first %zu bytes):\n", length);
+// One pass over the table; returns the number of replacements
+static unsigned int mask_table(struct acpi_table_header *table) {
+    u8 *data = (u8 *)table;
+    u32 length = table->length;
+    u32 patched_to = 0;
+    unsigned int state = 0, replaced = 0;
+    u32 i;
+
     for (i = 0; i < length; i++) {
-        if (i % 16 == 0)
-            pr_info("\n%04zx: ", i);
-        pr_cont("%02x ", ((unsigned char *)table)[i]);
+        const struct mask_rule *rule;
+        size_t target_len;
+        u32 start;
+
+        state = ac_next[state][data[i]];
+        if (ac_rule[state] < 0)
+            continue;
+
+        rule = &mask_rules[ac_rule[state]];
+        target_len = strlen(rule->target);
+        start = i + 1 - target_len;
+        // Overlapping matches: the earlier replacement wins
+        if (start < patched_to)
+            continue;
+
+        memset(&data[start], ' ', target_len);
+        memcpy(&data[start], rule->replacement, min(target_len, strlen(rule->replacement)));
+        patched_to = i + 1;
+        replaced++;
     }
-    pr_info("\n");
+
+    if (replaced)
+        update_acpi_table_checksum(table);
+    return replaced;
 }
 
-// Function to perform case-insensitive replacement in the table
-static void replace_string_in_table(struct acpi_table_header *table, size_t length, const char *target, const char *replacement) {
-    unsigned char *data = (unsigned char *)table;
-    size_t target_len = strlen(target);
-    size_t replacement_len = strlen(replacement);
-
-    for (size_t i = 0; i <= length - target_len; i++) {
-        bool match = true;
-        
-        // Perform case-insensitive comparison
-        for (size_t j = 0; j < target_len; j++) {
-            if (tolower(data[i + j]) != tolower(target[j])) {
-                match = false;
-                break;
-            }
-        }
+static void log_patched_table(struct acpi_table_header *table, unsigned int replaced) {
+    if (!verbose)
+        return;
+    pr_info("acpi_mask: %.4s (OEM %.6s %.8s): %u replacements\n",
+            table->signature, table->oem_id, table->oem_table_id, replaced);
+    print_hex_dump(KERN_INFO, "acpi_mask: ", DUMP_PREFIX_OFFSET, 16, 1,
+                   table, min_t(u32, table->length, 64), true);
+}
 
-        // If target is found, replace it
-        if (match) {
-            // Replace target with replacement, pad with spaces if replacement is shorter
-            memset(&data[i], ' ', target_len);
-            memcpy(&data[i], replacement, min(target_len, replacement_len));
-            i += target_len - 1;
-        }
+static struct patched_table *find_patched(struct acpi_table_header *table) {
+    struct patched_table *entry;
+
+    hash_for_each_possible(patched_tables, entry, node, (unsigned long)table) {
+        if (entry->table == table)
+            return entry;
     }
+    return NULL;
 }
 
-// Hook function for acpi_get_table
-static int hook_acpi_get_table(struct kprobe *p, struct pt_regs *regs) {
-    acpi_status status;
-    struct acpi_table_header *table;
-    acpi_string signature;
-    u32 instance;
-
-#ifdef __x86_64__
-    signature = (acpi_string)regs->di;
-    instance = (u32)regs->si;
-#elif defined(__aarch64__)
-    signature = (acpi_string)regs->regs[0];
-    instance = (u32)regs->regs[1];
-#else
-#error "Unsupported architecture"
-#endif
-
-    status = orig_acpi_get_table(signature, instance, &table);
-
-    if (ACPI_SUCCESS(status)) {
-        pr_info("ACPI table successfully retrieved. Signature: %.4s\n", table->signature);
-
-        // Replace known virtualization artifacts with generic values
-        replace_string_in_table(table, table->length, "QEMU", "GENUINE");
-        replace_string_in_table(table, table->length, "VMWARE", "MICROSFT");
-        replace_string_in_table(table, table->length, "EDK2", "BIOSV");
-        replace_string_in_table(table, table->length, "BXPC", "SYSC ");
-        replace_string_in_table(table, table->length, "VIRTUAL", "REAL  "); // Added "VIRTUAL"
-
-        // Update the checksum after modification
-        update_acpi_table_checksum(table, table->length);
-
-        // Print the modified table for verification
-        print_acpi_table_hex(table, 64);
-    } else {
-        pr_err("Failed to retrieve ACPI table: %d\n", status);
+/*
+ * Patches table unless it is already recorded with the same header.
+ * Callable from the kretprobe, so no sleeping.
+ */
+static void mask_once(struct acpi_table_header *table, bool held) {
+    struct patched_table *entry;
+    unsigned long flags;
+    unsigned int replaced;
+    bool drop;
+
+    spin_lock_irqsave(&patched_lock, flags);
+    entry = find_patched(table);
+    // Keep a single held reference per table
+    drop = held && entry && entry->held;
+    if (entry && !memcmp(&entry->header, table, sizeof(entry->header))) {
+        entry->held |= held;
+        spin_unlock_irqrestore(&patched_lock, flags);
+        if (drop)
+            acpi_put_table(table);
+        return;
     }
+    if (!entry) {
+        entry = kzalloc(sizeof(*entry), GFP_ATOMIC);
+        if (!entry) {
+            spin_unlock_irqrestore(&patched_lock, flags);
+            if (held)
+                acpi_put_table(table);
+            return;
+        }
+        entry->table = table;
+        hash_add(patched_tables, &entry->node, (unsigned long)table);
+    }
+    entry->held |= held;
+    replaced = mask_table(table);
+    memcpy(&entry->header, table, sizeof(entry->header));
+    patched_count++;
+    spin_unlock_irqrestore(&patched_lock, flags);
+
+    if (drop)
+        acpi_put_table(table);
+    log_patched_table(table, replaced);
+}
 
+// acpi_get_table(signature, instance, out_table): remember out_table for the return
+static int entry_handler(struct kretprobe_instance *ri, struct pt_regs *regs) {
+    struct acpi_table_header ***out_table = (struct acpi_table_header ***)ri->data;
+
+    *out_table = (struct acpi_table_header **)regs_get_kernel_argument(regs, 2);
     return 0;
 }
 
-// File read function using kernel_read
-static ssize_t read_acpi_table(const char *path, char *buffer, size_t len) {
-    struct file *file;
-    ssize_t ret;
+static int ret_handler(struct kretprobe_instance *ri, struct pt_regs *regs) {
+    struct acpi_table_header **out_table = *(struct acpi_table_header ***)ri->data;
 
-    file = filp_open(path, O_RDONLY, 0);
-    if (IS_ERR(file)) {
-        pr_err("Could not open file: %s\n", path);
-        return PTR_ERR(file);
-    }
+    if (regs_return_value(regs) != AE_OK || !out_table || !*out_table)
+        return 0;
+    mask_once(*out_table, false);
+    return 0;
+}
 
-    ret = kernel_read(file, buffer, len, &file->f_pos);
+static struct kretprobe get_table_probe = {
+    .kp.symbol_name = "acpi_get_table",
+    .entry_handler = entry_handler,
+    .handler = ret_handler,
+    .data_size = sizeof(struct acpi_table_header **),
+    .maxactive = 16,
+};
 
-    filp_close(file, NULL);
-    return ret;
+static void release_tables(void) {
+    struct patched_table *entry;
+    struct hlist_node *tmp;
+    int bkt;
+
+    hash_for_each_safe(patched_tables, bkt, tmp, entry, node) {
+        if (entry->held)
+            acpi_put_table(entry->table);
+        hash_del(&entry->node);
+        kfree(entry);
+    }
 }
 
 static int __init acpi_mask_init(void) {
+    struct acpi_table_header *table;
+    unsigned int count = 0, skipped = 0;
+    acpi_status status;
     int ret;
+    u32 i;
 
-    kp.pre_handler = hook_acpi_get_table;
-    kp.addr = (kprobe_opcode_t *)orig_acpi_get_table;
+    ret = build_matcher();
+    if (ret < 0) {
+        pr_err("acpi_mask: rule set exceeds %d matcher states\n", MASK_MAX_STATES);
+        return ret;
+    }
 
-    ret = register_kprobe(&kp);
+    // Probe first, so a table installed during the walk is not missed
+    ret = register_kretprobe(&get_table_probe);
     if (ret < 0) {
-        pr_err("register_kprobe failed, returned %d\n", ret);
+        pr_err("register_kretprobe failed, returned %d\n", ret);
         return ret;
     }
 
-    pr_info("acpi_mask_module loaded with kernel_read monitoring.\n");
+    /*
+     * Patch every installed table now and keep it mapped until unload. Only
+     * an index past the table count is AE_BAD_PARAMETER; any other failure
+     * is one table that could not be mapped, so keep walking.
+     */
+    for (i = 0; (status = acpi_get_table_by_index(i, &table)) != AE_BAD_PARAMETER; i++) {
+        if (ACPI_FAILURE(status)) {
+            skipped++;
+            continue;
+        }
+        mask_once(table, true);
+        count++;
+    }
+
+    pr_info("acpi_mask_module loaded: %u tables patched at load, %u could not be mapped.\n", count, skipped);
     return 0;
 }
 
 static void __exit acpi_mask_exit(void) {
-    unregister_kprobe(&kp);
-    pr_info("acpi_mask_module unloaded.\n");
+    unregister_kretprobe(&get_table_probe);
+    release_tables();
+    pr_info("acpi_mask_module unloaded (%u table rewrites).\n", patched_count);
 }
 
 module_init(acpi_mask_init);
@@ -149,4 +309,4 @@ module_exit(acpi_mask_exit);
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Your Name");
-MODULE_DESCRIPTION("ACPI Table Masking Kernel Module with kernel_read");
+MODULE_DESCRIPTION("ACPI Table Masking Kernel Module");
@@ -1,145 +1,181 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
-#include <linux/mm.h>
-#include <linux/io.h>
 #include <linux/string.h>
 #include <linux/kprobes.h>
 #include <linux/ptrace.h>
-#include <asm/pgtable.h>
-#include <asm/pgalloc.h>
-
-#define DMI_PHYSICAL_ADDRESS 0x000E0010  // Replace with actual address from dmidecode
-#define DMI_TABLE_SIZE 28548             // Replace with actual size from dmidecode
-
-static void __iomem *dmi_table_virt;
-
-// Kretprobe structure for intercepting dmi_get_system_info
-static struct kretprobe kp;
-
-// Static strings to replace virtualization identifiers
-static char vendor_override[] = "Dell Inc.";
-static char product_override[] = "Latitude E7470";
-
-// Function to change the page permissions of the specified virtual address
-static void set_page_rw(void *address) {
-    unsigned long addr = (unsigned long)address;
-    pgd_t *pgd;
-    p4d_t *p4d;
-    pud_t *pud;
-    pmd_t *pmd;
-    pte_t *pte;
-
-    // Use current->mm to access the current process's memory map
-    pgd = pgd_offset(current->mm, addr);
-    if (pgd_none(*pgd) || pgd_bad(*pgd)) {
-        pr_err("Invalid PGD\n");
+#include <linux/dmi.h>
+#include <linux/efi.h>
+
+/*
+ * Reports chosen DMI/SMBIOS values instead of the hypervisor's.
+ *
+ * Overrides are module parameters named after the /sys/class/dmi/id files,
+ * e.g. insmod dmi_module.ko sys_vendor="Dell Inc." product_name="Latitude E7470",
+ * stored in a table indexed by enum dmi_field. A kretprobe on
+ * dmi_get_system_info (which also backs /sys/class/dmi/id) swaps the return
+ * value with one array lookup. At load the same strings are written into the
+ * raw SMBIOS structures through dmi_walk(), so dmidecode agrees; the kernel
+ * located that table from the EFI config tables or the legacy entry point, so
+ * nothing is hardcoded and no page tables are touched.
+ */
+
+static bool verbose;
+module_param(verbose, bool, 0644);
+MODULE_PARM_DESC(verbose, "Log the SMBIOS entry point and every rewritten string (default off)");
+
+// Override per field; NULL keeps the firmware value
+static char *overrides[DMI_STRING_MAX] = {
+    [DMI_SYS_VENDOR] = "Dell Inc.",
+    [DMI_PRODUCT_NAME] = "Latitude E7470",
+};
+
+#define DMI_OVERRIDE_PARAM(name, field) \
+    module_param_named(name, overrides[field], charp, 0444); \
+    MODULE_PARM_DESC(name, "Value reported for " #field)
+
+DMI_OVERRIDE_PARAM(bios_vendor, DMI_BIOS_VENDOR);
+DMI_OVERRIDE_PARAM(bios_version, DMI_BIOS_VERSION);
+DMI_OVERRIDE_PARAM(bios_date, DMI_BIOS_DATE);
+DMI_OVERRIDE_PARAM(sys_vendor, DMI_SYS_VENDOR);
+DMI_OVERRIDE_PARAM(product_name, DMI_PRODUCT_NAME);
+DMI_OVERRIDE_PARAM(product_version, DMI_PRODUCT_VERSION);
+DMI_OVERRIDE_PARAM(product_serial, DMI_PRODUCT_SERIAL);
+DMI_OVERRIDE_PARAM(product_sku, DMI_PRODUCT_SKU);
+DMI_OVERRIDE_PARAM(product_family, DMI_PRODUCT_FAMILY);
+DMI_OVERRIDE_PARAM(board_vendor, DMI_BOARD_VENDOR);
+DMI_OVERRIDE_PARAM(board_name, DMI_BOARD_NAME);
+DMI_OVERRIDE_PARAM(board_version, DMI_BOARD_VERSION);
+DMI_OVERRIDE_PARAM(board_serial, DMI_BOARD_SERIAL);
+DMI_OVERRIDE_PARAM(board_asset_tag, DMI_BOARD_ASSET_TAG);
+DMI_OVERRIDE_PARAM(chassis_vendor, DMI_CHASSIS_VENDOR);
+DMI_OVERRIDE_PARAM(chassis_version, DMI_CHASSIS_VERSION);
+DMI_OVERRIDE_PARAM(chassis_serial, DMI_CHASSIS_SERIAL);
+DMI_OVERRIDE_PARAM(chassis_asset_tag, DMI_CHASSIS_ASSET_TAG);
+
+// Where each field's string number lives in the SMBIOS structures (offset 0: none)
+struct smbios_slot {
+    u8 type;
+    u8 offset;
+};
+
+static const struct smbios_slot smbios_slots[DMI_STRING_MAX] = {
+    [DMI_BIOS_VENDOR]       = { 0, 0x04 },
+    [DMI_BIOS_VERSION]      = { 0, 0x05 },
+    [DMI_BIOS_DATE]         = { 0, 0x08 },
+    [DMI_SYS_VENDOR]        = { 1, 0x04 },
+    [DMI_PRODUCT_NAME]      = { 1, 0x05 },
+    [DMI_PRODUCT_VERSION]   = { 1, 0x06 },
+    [DMI_PRODUCT_SERIAL]    = { 1, 0x07 },
+    [DMI_PRODUCT_SKU]       = { 1, 0x19 },
+    [DMI_PRODUCT_FAMILY]    = { 1, 0x1a },
+    [DMI_BOARD_VENDOR]      = { 2, 0x04 },
+    [DMI_BOARD_NAME]        = { 2, 0x05 },
+    [DMI_BOARD_VERSION]     = { 2, 0x06 },
+    [DMI_BOARD_SERIAL]      = { 2, 0x07 },
+    [DMI_BOARD_ASSET_TAG]   = { 2, 0x08 },
+    [DMI_CHASSIS_VENDOR]    = { 3, 0x04 },
+    [DMI_CHASSIS_VERSION]   = { 3, 0x06 },
+    [DMI_CHASSIS_SERIAL]    = { 3, 0x07 },
+    [DMI_CHASSIS_ASSET_TAG] = { 3, 0x08 },
+};
+
+static unsigned int rewritten_strings;
+
+// Overwrites string number index of a structure in place, space-padded to its old length
+static void rewrite_string(struct dmi_header *dm, u8 index, const char *value) {
+    char *s = (char *)dm + dm->length;
+    size_t len, value_len = strlen(value);
+
+    while (--index > 0 && *s)
+        s += strlen(s) + 1;
+    if (!*s)
         return;
-    }
 
-    p4d = p4d_offset(pgd, addr);
-    if (p4d_none(*p4d) || p4d_bad(*p4d)) {
-        pr_err("Invalid P4D\n");
-        return;
-    }
+    len = strlen(s);
+    if (verbose)
+        pr_info("dmi_module: type %u string \"%s\" -> \"%.*s\"\n", dm->type, s, (int)min(len, value_len), value);
+    memset(s, ' ', len);
+    memcpy(s, value, min(len, value_len));
+    rewritten_strings++;
+}
 
-    pud = pud_offset(p4d, addr);
-    if (pud_none(*pud) || pud_bad(*pud)) {
-        pr_err("Invalid PUD\n");
-        return;
+// dmi_walk callback; the structure lives in the kernel's mapping of the firmware table
+static void rewrite_structure(const struct dmi_header *header, void *private_data) {
+    struct dmi_header *dm = (struct dmi_header *)header;
+    const u8 *bytes = (const u8 *)dm;
+    int field;
+
+    for (field = 0; field < DMI_STRING_MAX; field++) {
+        const struct smbios_slot *slot = &smbios_slots[field];
+
+        if (!overrides[field] || !slot->offset || slot->type != dm->type || slot->offset >= dm->length)
+            continue;
+        if (bytes[slot->offset])
+            rewrite_string(dm, bytes[slot->offset], overrides[field]);
     }
+}
 
-    pmd = pmd_offset(pud, addr);
-    if (pmd_none(*pmd) || pmd_bad(*pmd)) {
-        pr_err("Invalid PMD\n");
+static void log_entry_point(void) {
+    if (!verbose)
+        return;
+#ifdef CONFIG_EFI
+    if (efi.smbios3 != EFI_INVALID_TABLE_ADDR) {
+        pr_info("dmi_module: SMBIOS 3 entry point at %#lx (EFI)\n", efi.smbios3);
         return;
     }
-
-    pte = pte_offset_kernel(pmd, addr);
-    if (!pte) {
-        pr_err("Invalid PTE\n");
+    if (efi.smbios != EFI_INVALID_TABLE_ADDR) {
+        pr_info("dmi_module: SMBIOS entry point at %#lx (EFI)\n", efi.smbios);
         return;
     }
-
-    // Set the page to writable
-    set_pte_atomic(pte, pte_mkwrite(*pte));
-    pr_info("Page permissions changed to R/W\n");
+#endif
+    pr_info("dmi_module: SMBIOS entry point found by the legacy 0xF0000 scan\n");
 }
 
-// Function to replace specific strings in the DMI table
-static void replace_dmi_string(void *table, size_t size) {
-    char *data = (char *)table;
-    const char *target = "VMware";
-    const char *replacement = "Dell  "; // Make sure the replacement is the same length
-
-    size_t target_len = strlen(target);
-    size_t replacement_len = strlen(replacement);
-
-    for (size_t i = 0; i <= size - target_len; i++) {
-        // Check if the target string is found
-        if (memcmp(&data[i], target, target_len) == 0) {
-            // Replace with the new string
-            memcpy(&data[i], replacement, target_len);
-
-            pr_info("Replaced '%s' with '%s' at offset %zu\n", target, replacement, i);
-        }
-    }
+// dmi_get_system_info(int field): remember the field for the return handler
+static int entry_handler(struct kretprobe_instance *ri, struct pt_regs *regs) {
+    *(int *)ri->data = (int)regs_get_kernel_argument(regs, 0);
+    return 0;
 }
 
-// Kretprobe handler function to intercept dmi_get_system_info
-static int ret_handler(struct kretprobe_instance *ri, struct pt_regs *regs)
-{
-    const char *retval = (const char *)regs_return_value(regs);
-
-    if (retval) {
-        // Compare the returned string and replace if necessary
-        if (strcmp(retval, "VMware, Inc.") == 0) {
-            regs_set_return_value(regs, (unsigned long)vendor_override);
-            pr_info("Overridden sys_vendor\n");
-        } else if (strcmp(retval, "VMware Virtual Platform") == 0) {
-            regs_set_return_value(regs, (unsigned long)product_override);
-            pr_info("Overridden product_name\n");
-        }
-        // Add more conditions as needed
-    }
+static int ret_handler(struct kretprobe_instance *ri, struct pt_regs *regs) {
+    int field = *(int *)ri->data;
 
+    if (field >= 0 && field < DMI_STRING_MAX && overrides[field])
+        regs_set_return_value(regs, (unsigned long)overrides[field]);
     return 0;
 }
 
+static struct kretprobe kp = {
+    .kp.symbol_name = "dmi_get_system_info",
+    .entry_handler = entry_handler,
+    .handler = ret_handler,
+    .data_size = sizeof(int),
+    .maxactive = 16,
+};
+
 static int __init modify_dmi_init(void) {
     int ret;
 
-    // Map the DMI table
-    dmi_table_virt = ioremap(DMI_PHYSICAL_ADDRESS, DMI_TABLE_SIZE);
-    if (!dmi_table_virt) {
-        pr_err("Failed to map DMI table\n");
-        return -ENOMEM;
-    }
-
-    // Change permissions to make the table writable
-    set_page_rw(dmi_table_virt);
-
-    // Now modify DMI data as needed
-    replace_dmi_string(dmi_table_virt, DMI_TABLE_SIZE);
+    log_entry_point();
 
-    // Register the kretprobe
-    kp.handler = ret_handler;
-    kp.kp.symbol_name = "dmi_get_system_info";
+    // Rewrite the raw structures so tools reading the table see the same values
+    ret = dmi_walk(rewrite_structure, NULL);
+    if (ret < 0)
+        pr_warn("dmi_module: no SMBIOS table to rewrite (%d), overriding lookups only\n", ret);
 
     ret = register_kretprobe(&kp);
     if (ret < 0) {
         pr_err("register_kretprobe failed, returned %d\n", ret);
-        iounmap(dmi_table_virt);
         return ret;
     }
 
-    pr_info("Module loaded: DMI table modified and kretprobe registered\n");
+    pr_info("Module loaded: %u SMBIOS strings rewritten and kretprobe registered\n", rewritten_strings);
     return 0;
 }
 
 static void __exit modify_dmi_exit(void) {
     unregister_kretprobe(&kp);
-    iounmap(dmi_table_virt);
-    pr_info("Module unloaded: kretprobe unregistered and DMI table unmapped\n");
+    pr_info("Module unloaded: kretprobe unregistered\n");
 }
 
 module_init(modify_dmi_init);
@@ -147,4 +183,4 @@ module_exit(modify_dmi_exit);
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Your Name");
-MODULE_DESCRIPTION("Kernel module to modify DMI table and intercept dmi_get_system_info");
+MODULE_DESCRIPTION("Kernel module to override DMI/SMBIOS fields and intercept dmi_get_system_info");
@@ -0,0 +1,377 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include <linux/atomic.h>
+#include <linux/dmi.h>
+#include <linux/acpi.h>
+#include <linux/pci.h>
+#include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
+#include <linux/cpu.h>
+#include <linux/smp.h>
+#include <net/net_namespace.h>
+#ifdef CONFIG_X86_64
+#include <asm/desc.h>
+#endif
+
+#include "vmd_snapshot.h"
+
+/*
+ * Serves /dev/vmd_snapshot: every open() collects DMI strings, ACPI table
+ * headers, PCI IDs, module names, NIC addresses and per-CPU descriptor
+ * table registers into one buffer (layout in src/vmd_snapshot.h), and read()
+ * copies it out. The scanner gets in one syscall what otherwise takes
+ * thousands of procfs/sysfs reads plus root-only helpers.
+ */
+
+static atomic64_t generation = ATOMIC64_INIT(0);
+
+// Growable snapshot under construction; sections are appended in order
+struct snapshot_buf {
+    u8 *data;
+    size_t used;
+    size_t cap;
+    bool failed;
+    u32 sections;
+    u32 section_start;
+};
+
+static void *snap_reserve(struct snapshot_buf *b, size_t len) {
+    void *p;
+
+    if (b->failed)
+        return NULL;
+    if (b->used + len > b->cap) {
+        size_t cap = max(b->cap * 2, b->used + len);
+        u8 *grown = kvzalloc(cap, GFP_KERNEL);
+
+        if (!grown) {
+            b->failed = true;
+            return NULL;
+        }
+        memcpy(grown, b->data, b->used);
+        kvfree(b->data);
+        b->data = grown;
+        b->cap = cap;
+    }
+    p = b->data + b->used;
+    b->used += len;
+    return p;
+}
+
+static struct vmd_snapshot_section *section_entry(struct snapshot_buf *b, u32 index) {
+    return (struct vmd_snapshot_section *)(b->data + sizeof(struct vmd_snapshot_header)) + index;
+}
+
+static void begin_section(struct snapshot_buf *b, u32 type, u32 entry_size) {
+    struct vmd_snapshot_section *section;
+
+    snap_reserve(b, ALIGN(b->used, 8) - b->used);
+    if (b->failed)
+        return;
+    section = section_entry(b, b->sections);
+    section->type = type;
+    section->entry_size = entry_size;
+    section->offset = b->used;
+    b->section_start = b->used;
+}
+
+static void end_section(struct snapshot_buf *b) {
+    struct vmd_snapshot_section *section;
+
+    if (b->failed)
+        return;
+    section = section_entry(b, b->sections++);
+    section->count = (b->used - b->section_start) / section->entry_size;
+}
+
+struct dmi_name {
+    int field;
+    const char *name;
+};
+
+static const struct dmi_name dmi_names[] = {
+    { DMI_BIOS_VENDOR, "bios_vendor" },
+    { DMI_BIOS_VERSION, "bios_version" },
+    { DMI_BIOS_DATE, "bios_date" },
+    { DMI_SYS_VENDOR, "sys_vendor" },
+    { DMI_PRODUCT_NAME, "product_name" },
+    { DMI_PRODUCT_VERSION, "product_version" },
+    { DMI_PRODUCT_SERIAL, "product_serial" },
+    { DMI_PRODUCT_UUID, "product_uuid" },
+    { DMI_PRODUCT_SKU, "product_sku" },
+    { DMI_PRODUCT_FAMILY, "product_family" },
+    { DMI_BOARD_VENDOR, "board_vendor" },
+    { DMI_BOARD_NAME, "board_name" },
+    { DMI_BOARD_VERSION, "board_version" },
+    { DMI_BOARD_SERIAL, "board_serial" },
+    { DMI_BOARD_ASSET_TAG, "board_asset_tag" },
+    { DMI_CHASSIS_VENDOR, "chassis_vendor" },
+    { DMI_CHASSIS_TYPE, "chassis_type" },
+    { DMI_CHASSIS_VERSION, "chassis_version" },
+    { DMI_CHASSIS_SERIAL, "chassis_serial" },
+    { DMI_CHASSIS_ASSET_TAG, "chassis_asset_tag" },
+};
+
+static void add_dmi(struct snapshot_buf *b) {
+    size_t i;
+
+    begin_section(b, VMD_SNAP_DMI, sizeof(struct vmd_snap_dmi));
+    for (i = 0; i < ARRAY_SIZE(dmi_names); i++) {
+        const char *value = dmi_get_system_info(dmi_names[i].field);
+        struct vmd_snap_dmi *e;
+
+        if (!value)
+            continue;
+        e = snap_reserve(b, sizeof(*e));
+        if (!e)
+            return;
+        strscpy(e->field, dmi_names[i].name, sizeof(e->field));
+        strscpy(e->value, value, sizeof(e->value));
+    }
+    end_section(b);
+}
+
+static void add_acpi(struct snapshot_buf *b) {
+    begin_section(b, VMD_SNAP_ACPI, sizeof(struct vmd_snap_acpi));
+#ifdef CONFIG_ACPI
+    {
+        struct acpi_table_header *table;
+        u32 i;
+
+        BUILD_BUG_ON(sizeof(struct vmd_snap_acpi) != sizeof(struct acpi_table_header));
+        for (i = 0; ACPI_SUCCESS(acpi_get_table_by_index(i, &table)); i++) {
+            struct vmd_snap_acpi *e = snap_reserve(b, sizeof(*e));
+
+            if (e)
+                memcpy(e, table, sizeof(*e));
+            acpi_put_table(table);
+            if (!e)
+                return;
+        }
+    }
+#endif
+    end_section(b);
+}
+
+static void add_pci(struct snapshot_buf *b) {
+    begin_section(b, VMD_SNAP_PCI, sizeof(struct vmd_snap_pci));
+#ifdef CONFIG_PCI
+    {
+        struct pci_dev *pdev = NULL;
+
+        for_each_pci_dev(pdev) {
+            struct vmd_snap_pci *e = snap_reserve(b, sizeof(*e));
+
+            if (!e) {
+                pci_dev_put(pdev);
+                return;
+            }
+            strscpy(e->slot, pci_name(pdev), sizeof(e->slot));
+            e->vendor = pdev->vendor;
+            e->device = pdev->device;
+            e->subsystem_vendor = pdev->subsystem_vendor;
+            e->subsystem_device = pdev->subsystem_device;
+            e->class_code = pdev->class;
+        }
+    }
+#endif
+    end_section(b);
+}
+
+/*
+ * The module list head is not exported, so walk the ring through our own
+ * entry and skip the one node that is not inside module memory (the head).
+ * Entries are reserved up front because the walk cannot sleep.
+ */
+static void add_modules(struct snapshot_buf *b) {
+    struct vmd_snap_module *entries;
+    struct module *mod;
+    unsigned int count = 0, filled = 0;
+
+    begin_section(b, VMD_SNAP_MODULES, sizeof(struct vmd_snap_module));
+
+    rcu_read_lock_sched();
+    list_for_each_entry_rcu(mod, &THIS_MODULE->list, list)
+        count++;
+    rcu_read_unlock_sched();
+
+    // Slack for modules loaded between the two walks
+    entries = snap_reserve(b, (count + 16) * sizeof(*entries));
+    if (!entries)
+        return;
+
+    rcu_read_lock_sched();
+    // The walk starts after our own entry, so add it explicitly
+    strscpy(entries[filled++].name, THIS_MODULE->name, sizeof(entries->name));
+    list_for_each_entry_rcu(mod, &THIS_MODULE->list, list) {
+        if (filled == count + 16)
+            break;
+        if (!__module_address((unsigned long)&mod->list) || mod->state == MODULE_STATE_UNFORMED)
+            continue;
+        strscpy(entries[filled++].name, mod->name, sizeof(entries->name));
+    }
+    rcu_read_unlock_sched();
+
+    b->used -= (count + 16 - filled) * sizeof(*entries);
+    end_section(b);
+}
+
+static void add_netdevs(struct snapshot_buf *b) {
+    struct net_device *dev;
+
+    begin_section(b, VMD_SNAP_NETDEV, sizeof(struct vmd_snap_netdev));
+    rtnl_lock();
+    for_each_netdev(&init_net, dev) {
+        struct device *parent = dev->dev.parent;
+        struct vmd_snap_netdev *e = snap_reserve(b, sizeof(*e));
+
+        if (!e)
+            break;
+        strscpy(e->name, dev->name, sizeof(e->name));
+        e->type = dev->type;
+        if (dev->addr_len == 6) {
+            memcpy(e->addr, dev->dev_addr, 6);
+            memcpy(e->perm_addr, dev->perm_addr, 6);
+        }
+        if (parent) {
+            strscpy(e->parent_dev, dev_name(parent), sizeof(e->parent_dev));
+            if (parent->bus)
+                strscpy(e->parent_bus, parent->bus->name, sizeof(e->parent_bus));
+        }
+    }
+    rtnl_unlock();
+    end_section(b);
+}
+
+#ifdef CONFIG_X86_64
+static void read_descriptor_tables(void *info) {
+    struct vmd_snap_cpu *e = info;
+    struct desc_ptr gdt, idt;
+
+    native_store_gdt(&gdt);
+    store_idt(&idt);
+    e->gdt_base = gdt.address;
+    e->gdt_limit = gdt.size;
+    e->idt_base = idt.address;
+    e->idt_limit = idt.size;
+}
+#endif
+
+static void add_cpus(struct snapshot_buf *b) {
+    begin_section(b, VMD_SNAP_CPU, sizeof(struct vmd_snap_cpu));
+#ifdef CONFIG_X86_64
+    {
+        unsigned int cpu;
+
+        cpus_read_lock();
+        for_each_online_cpu(cpu) {
+            struct vmd_snap_cpu sample = { .cpu = cpu };
+            struct vmd_snap_cpu *e;
+
+            if (smp_call_function_single(cpu, read_descriptor_tables, &sample, 1))
+                continue;
+            e = snap_reserve(b, sizeof(*e));
+            if (!e)
+                break;
+            *e = sample;
+        }
+        cpus_read_unlock();
+    }
+#endif
+    end_section(b);
+}
+
+#define SNAPSHOT_SECTIONS 6
+
+static int snapshot_open(struct inode *inode, struct file *file) {
+    struct snapshot_buf *b;
+    struct vmd_snapshot_header *header;
+
+    b = kzalloc(sizeof(*b), GFP_KERNEL);
+    if (!b)
+        return -ENOMEM;
+
+    snap_reserve(b, sizeof(*header) + SNAPSHOT_SECTIONS * sizeof(struct vmd_snapshot_section));
+    add_dmi(b);
+    add_acpi(b);
+    add_pci(b);
+    add_modules(b);
+    add_netdevs(b);
+    add_cpus(b);
+    if (b->failed) {
+        kvfree(b->data);
+        kfree(b);
+        return -ENOMEM;
+    }
+
+    header = (struct vmd_snapshot_header *)b->data;
+    header->magic = VMD_SNAPSHOT_MAGIC;
+    header->version = VMD_SNAPSHOT_VERSION;
+    header->header_size = sizeof(*header);
+    header->total_size = b->used;
+    header->section_count = b->sections;
+    header->generation = atomic64_inc_return(&generation);
+    header->timestamp_ns = ktime_get_real_ns();
+
+    file->private_data = b;
+    return 0;
+}
+
+static ssize_t snapshot_read(struct file *file, char __user *buf, size_t count, loff_t *ppos) {
+    struct snapshot_buf *b = file->private_data;
+
+    return simple_read_from_buffer(buf, count, ppos, b->data, b->used);
+}
+
+static int snapshot_release(struct inode *inode, struct file *file) {
+    struct snapshot_buf *b = file->private_data;
+
+    kvfree(b->data);
+    kfree(b);
+    return 0;
+}
+
+static const struct file_operations snapshot_fops = {
+    .owner = THIS_MODULE,
+    .open = snapshot_open,
+    .read = snapshot_read,
+    .release = snapshot_release,
+    .llseek = default_llseek,
+};
+
+// Serials and UUIDs are in the snapshot, so root only like /sys/class/dmi/id
+static struct miscdevice snapshot_device = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name = "vmd_snapshot",
+    .fops = &snapshot_fops,
+    .mode = 0400,
+};
+
+static int __init snapshot_init(void) {
+    int ret = misc_register(&snapshot_device);
+
+    if (ret < 0) {
+        pr_err("snapshot_module: misc_register failed, returned %d\n", ret);
+        return ret;
+    }
+    pr_info("snapshot_module loaded: %s ready.\n", VMD_SNAPSHOT_DEVICE);
+    return 0;
+}
+
+static void __exit snapshot_exit(void) {
+    misc_deregister(&snapshot_device);
+    pr_info("snapshot_module unloaded (%lld snapshots served).\n", atomic64_read(&generation));
+}
+
+module_init(snapshot_init);
+module_exit(snapshot_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Your Name");
+MODULE_DESCRIPTION("Exports a one-read snapshot of virtualization artifacts");
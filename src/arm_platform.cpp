@@ -0,0 +1,169 @@
+#include "arm_platform.h"
+#include "file_reader.h"
+#include "batch_reader.h"
+#include "scan_budget.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+const char* armImplementerName(uint8_t implementer) {
+    switch (implementer) {
+        case 0x00: return "software-defined";
+        case 0x41: return "ARM";
+        case 0x42: return "Broadcom";
+        case 0x43: return "Cavium";
+        case 0x46: return "Fujitsu";
+        case 0x48: return "HiSilicon";
+        case 0x4e: return "NVIDIA";
+        case 0x50: return "Applied Micro";
+        case 0x51: return "Qualcomm";
+        case 0x53: return "Samsung";
+        case 0x61: return "Apple";
+        case 0x6d: return "Microsoft";
+        case 0xc0: return "Ampere";
+        default: return "unknown";
+    }
+}
+
+bool readArmCpuIdentity(std::vector<ArmCpuIdentity>& cpus) {
+    cpus.clear();
+    int cpu_dir = openDirectory("/sys/devices/system/cpu");
+    if (cpu_dir < 0) return false;
+
+    static thread_local BatchReader files;
+    files.clear();
+    DirScanner entries(cpu_dir);
+    const char* name;
+    char path[128];
+    while (entries.next(name)) {
+        uint64_t cpu;
+        if (strncmp(name, "cpu", 3) != 0 || !parseUnsigned(name + 3, cpu)) continue;
+        cpus.emplace_back().cpu = static_cast<int>(cpu);
+        snprintf(path, sizeof(path), "%s/regs/identification/midr_el1", name);
+        files.add(cpu_dir, path);
+        snprintf(path, sizeof(path), "%s/regs/identification/revidr_el1", name);
+        files.add(cpu_dir, path);
+    }
+    files.run();
+    close(cpu_dir);
+
+    // Offline CPUs and non-Arm kernels have no regs directory
+    std::vector<ArmCpuIdentity> found;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        ArmCpuIdentity& id = cpus[i];
+        if (!files.ok(2 * i) || !parseUnsigned(files.data(2 * i), id.midr, 16)) continue;
+        id.has_revidr = files.ok(2 * i + 1) && parseUnsigned(files.data(2 * i + 1), id.revidr, 16);
+        found.push_back(id);
+    }
+    std::sort(found.begin(), found.end(), [](const ArmCpuIdentity& a, const ArmCpuIdentity& b) { return a.cpu < b.cpu; });
+    cpus.swap(found);
+    return !cpus.empty();
+}
+
+// Device tree strings are NUL-separated lists; joins them with ", "
+static std::string deviceTreeString(std::string_view raw) {
+    std::string text;
+    while (!raw.empty() && raw.back() == '\0') raw.remove_suffix(1);
+    for (char c : raw) {
+        if (c == '\0') text += ", ";
+        else text += c;
+    }
+    return text;
+}
+
+void discoverHypervisor(HypervisorDiscovery& discovery) {
+    discovery = HypervisorDiscovery();
+    FileReader file;
+
+    if (file.read("/sys/hypervisor/type")) discovery.xen_type = std::string(trim(file.data()));
+
+    int ptp_dir = openDirectory("/sys/class/ptp");
+    if (ptp_dir >= 0) {
+        DirScanner clocks(ptp_dir);
+        const char* clock;
+        char path[128];
+        while (clocks.next(clock)) {
+            snprintf(path, sizeof(path), "%s/clock_name", clock);
+            if (file.readAt(ptp_dir, path) && trim(file.data()) == "KVM virtual PTP") {
+                discovery.kvm_ptp_clock = clock;
+                break;
+            }
+        }
+        close(ptp_dir);
+    }
+
+    if (file.read("/proc/device-tree/hypervisor/compatible"))
+        discovery.dt_hypervisor = deviceTreeString(file.data());
+    if (file.read("/proc/device-tree/psci/method"))
+        discovery.dt_psci_method = deviceTreeString(file.data());
+
+    // FADT (root only): ARM_BOOT_ARCH is the 16-bit field at offset 129, bit 1 PSCI_USE_HVC
+    if (file.read("/sys/firmware/acpi/tables/FACP")) {
+        std::string_view fadt = file.data();
+        if (fadt.size() >= 131 && fadt.substr(0, 4) == "FACP") {
+            discovery.acpi_fadt_read = true;
+            discovery.acpi_psci_hvc = (static_cast<unsigned char>(fadt[129]) & 0x2) != 0;
+        }
+    }
+}
+
+#if defined(__aarch64__)
+static inline uint64_t readVirtualCounter() {
+    uint64_t value;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(value) :: "memory");
+    return value;
+}
+
+static inline uint64_t counterFrequency() {
+    uint64_t value;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(value));
+    return value;
+}
+#endif
+
+void readArmFeatureRegisters(ArmFeatureRegisters& regs) {
+    regs = ArmFeatureRegisters();
+#if defined(__aarch64__)
+    if (!(getauxval(AT_HWCAP) & HWCAP_CPUID)) return;
+    asm volatile("mrs %0, ID_AA64PFR0_EL1" : "=r"(regs.pfr0));
+    asm volatile("mrs %0, ID_AA64ISAR0_EL1" : "=r"(regs.isar0));
+    asm volatile("mrs %0, ID_AA64MMFR0_EL1" : "=r"(regs.mmfr0));
+    regs.ok = true;
+#endif
+}
+
+bool measureCounterTiming(CounterTiming& timing) {
+    timing = CounterTiming();
+#if defined(__aarch64__)
+    timing.cntfrq = counterFrequency();
+    if (timing.cntfrq == 0) return false;
+
+    // Read cost: best of 200 batches of 1000 back-to-back reads, since one read
+    // is usually shorter than a counter tick
+    const int batches = 200, reads = 1000;
+    double best = 0.0;
+    for (int b = 0; b < batches; b++) {
+        uint64_t first = readVirtualCounter();
+        uint64_t last = first;
+        for (int i = 0; i < reads; i++) last = readVirtualCounter();
+        double ticks = static_cast<double>(last - first) / reads;
+        if (b == 0 || ticks < best) best = ticks;
+        // Reads as slow as the probe's trap threshold were each an exit; native reads cost only CPU time.
+        // The best batch so far decides, so a preempted batch is not charged as trapped
+        bool trapped = best * 1e9 / timing.cntfrq > ARM_COUNTER_READ_THRESHOLD_NS;
+        if (!budgetPace(trapped ? reads + 1 : 0)) break;
+    }
+    timing.read_ticks = best;
+    timing.read_ns = best * 1e9 / timing.cntfrq;
+    timing.ok = true;
+    return true;
+#else
+    return false;
+#endif
+}
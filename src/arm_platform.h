@@ -0,0 +1,79 @@
+#ifndef ARM_PLATFORM_H
+#define ARM_PLATFORM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// MIDR_EL1/REVIDR_EL1 of one CPU, from /sys/devices/system/cpu/cpuN/regs/identification
+struct ArmCpuIdentity {
+    int cpu = -1;
+    uint64_t midr = 0;
+    uint64_t revidr = 0;
+    bool has_revidr = false;
+};
+
+inline uint8_t midrImplementer(uint64_t midr) { return static_cast<uint8_t>(midr >> 24); }
+inline uint8_t midrVariant(uint64_t midr) { return (midr >> 20) & 0xf; }
+inline uint16_t midrPartNum(uint64_t midr) { return (midr >> 4) & 0xfff; }
+inline uint8_t midrRevision(uint64_t midr) { return midr & 0xf; }
+
+// "ARM", "Ampere", ... or "unknown"; implementer 0 is reserved for software (e.g. QEMU's "max" CPU)
+const char* armImplementerName(uint8_t implementer);
+
+// Reads every CPU's identification registers in one sysfs batch, ordered by CPU
+bool readArmCpuIdentity(std::vector<ArmCpuIdentity>& cpus);
+
+/**
+    What the kernel exposes about hypervisor discovery: the Xen type node,
+    the ptp_kvm clock (registered only after the SMCCC KVM vendor service
+    answered), the device tree hypervisor node and the PSCI conduit from the
+    device tree or the ACPI FADT. An "hvc" conduit means firmware calls go to
+    a hypervisor at EL2.
+ */
+struct HypervisorDiscovery {
+    std::string xen_type;          // /sys/hypervisor/type
+    std::string kvm_ptp_clock;     // /sys/class/ptp/ptpN/clock_name == "KVM virtual PTP"
+    std::string dt_hypervisor;     // /proc/device-tree/hypervisor/compatible
+    std::string dt_psci_method;    // /proc/device-tree/psci/method, "hvc" or "smc"
+    bool acpi_fadt_read = false;
+    bool acpi_psci_hvc = false;    // FADT ARM_BOOT_ARCH PSCI_USE_HVC
+};
+
+void discoverHypervisor(HypervisorDiscovery& discovery);
+
+/**
+    System-wide ID_AA64* values as the kernel presents them to user space
+    (MRS from EL0 is emulated when HWCAP_CPUID is set). Sysfs only has MIDR
+    and REVIDR. aarch64 only; ok is false elsewhere.
+ */
+struct ArmFeatureRegisters {
+    bool ok = false;
+    uint64_t pfr0 = 0;
+    uint64_t isar0 = 0;
+    uint64_t mmfr0 = 0;
+};
+
+void readArmFeatureRegisters(ArmFeatureRegisters& regs);
+
+/**
+    Generic timer measurements. The cost of a cntvct_el0 read is taken as
+    the best of many batches so preemption does not count. A hypervisor that
+    traps the virtual counter turns a read of a few nanoseconds into a round
+    trip to EL2. The counter's rate is not checked: every clock a guest can
+    read (CLOCK_MONOTONIC_RAW included) is driven by this same counter.
+ */
+struct CounterTiming {
+    bool ok = false;
+    uint64_t cntfrq = 0;
+    double read_ns = 0.0;
+    double read_ticks = 0.0;
+};
+
+// Decision threshold for the counter measurements
+#define ARM_COUNTER_READ_THRESHOLD_NS 200.0
+
+// aarch64 only; false elsewhere
+bool measureCounterTiming(CounterTiming& timing);
+
+#endif // ARM_PLATFORM_H
@@ -0,0 +1,226 @@
+#include "batch_reader.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+bool use_io_uring = false;
+
+// Files per submission: three SQEs each, one registered file slot each
+static constexpr unsigned kRingEntries = 256;
+static constexpr unsigned kFilesPerBatch = 64;
+
+enum BatchOp : uint64_t { OP_OPEN = 0, OP_READ = 1, OP_CLOSE = 2 };
+
+BatchReader::BatchReader() {}
+
+BatchReader::~BatchReader() {
+    closeRing();
+}
+
+size_t BatchReader::add(int dirfd, const char* name) {
+    Entry entry;
+    entry.dirfd = dirfd;
+    entry.result = -ENOENT;
+    strncpy(entry.name, name, sizeof(entry.name) - 1);
+    entry.name[sizeof(entry.name) - 1] = '\0';
+    entries_.push_back(entry);
+    return entries_.size() - 1;
+}
+
+void BatchReader::clear() {
+    entries_.clear();
+}
+
+std::string_view BatchReader::data(size_t i) const {
+    if (entries_[i].result < 0) return std::string_view();
+    return std::string_view(data_.data() + i * kSlotSize, entries_[i].result);
+}
+
+void BatchReader::run() {
+    if (data_.size() < entries_.size() * kSlotSize) data_.resize(entries_.size() * kSlotSize);
+
+    for (size_t first = 0; first < entries_.size(); first += kFilesPerBatch) {
+        size_t count = std::min<size_t>(kFilesPerBatch, entries_.size() - first);
+        if (use_io_uring && setupRing() && runRing(first, count)) continue;
+        runSyscalls(first, count);
+    }
+}
+
+void BatchReader::runSyscalls(size_t first, size_t count) {
+    for (size_t i = first; i < first + count; i++) {
+        Entry& entry = entries_[i];
+        char* buf = data_.data() + i * kSlotSize;
+
+        int fd = openat(entry.dirfd, entry.name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            entry.result = -errno;
+            continue;
+        }
+        ssize_t n = pread(fd, buf, kSlotSize - 1, 0);
+        entry.result = n < 0 ? -errno : static_cast<int>(n);
+        if (n >= 0) buf[n] = '\0';
+        close(fd);
+    }
+}
+
+bool BatchReader::setupRing() {
+    if (ring_fd_ >= 0) return true;
+    if (ring_failed_) return false;
+    ring_failed_ = true;
+
+    struct io_uring_params params = {};
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, kRingEntries, &params));
+    if (ring_fd_ < 0) return false;
+
+    sq_len_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_len_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+    sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; closeRing(); return false; }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr_ = sq_ptr_;
+    } else {
+        cq_ptr_ = mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; closeRing(); return false; }
+    }
+
+    sqes_len_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ptr_ = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes_ptr_ == MAP_FAILED) { sqes_ptr_ = nullptr; closeRing(); return false; }
+
+    char* sq = static_cast<char*>(sq_ptr_);
+    char* cq = static_cast<char*>(cq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+
+    // Empty direct-descriptor table that the openat requests install into
+    int files[kFilesPerBatch];
+    for (int& fd : files) fd = -1;
+    if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES, files, kFilesPerBatch) != 0) {
+        closeRing();
+        return false;
+    }
+
+    ring_failed_ = false;
+    return true;
+}
+
+void BatchReader::closeRing() {
+    if (sqes_ptr_) munmap(sqes_ptr_, sqes_len_);
+    if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_len_);
+    if (sq_ptr_) munmap(sq_ptr_, sq_len_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+    sqes_ptr_ = cq_ptr_ = sq_ptr_ = nullptr;
+    ring_fd_ = -1;
+}
+
+bool BatchReader::runRing(size_t first, size_t count) {
+    struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(sqes_ptr_);
+    struct io_uring_cqe* cqes = static_cast<struct io_uring_cqe*>(cqes_);
+    const unsigned start = *sq_tail_;
+    unsigned tail = start;
+    unsigned mask = *sq_mask_;
+
+    auto nextSqe = [&](size_t index, BatchOp op) {
+        unsigned idx = tail & mask;
+        struct io_uring_sqe* sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = (static_cast<uint64_t>(index) << 2) | op;
+        sq_array_[idx] = idx;
+        tail++;
+        return sqe;
+    };
+
+    // Hard links keep the chain going after a failed open or short read,
+    // so the close always runs and the descriptor slot is released
+    for (size_t i = first; i < first + count; i++) {
+        unsigned slot = static_cast<unsigned>(i - first);
+        entries_[i].result = -ECANCELED;
+
+        struct io_uring_sqe* open_sqe = nextSqe(i, OP_OPEN);
+        open_sqe->opcode = IORING_OP_OPENAT;
+        open_sqe->fd = entries_[i].dirfd;
+        open_sqe->addr = reinterpret_cast<uint64_t>(entries_[i].name);
+        open_sqe->open_flags = O_RDONLY;
+        open_sqe->file_index = slot + 1;
+        open_sqe->flags = IOSQE_IO_HARDLINK;
+
+        struct io_uring_sqe* read_sqe = nextSqe(i, OP_READ);
+        read_sqe->opcode = IORING_OP_READ;
+        read_sqe->fd = slot;
+        read_sqe->addr = reinterpret_cast<uint64_t>(data_.data() + i * kSlotSize);
+        read_sqe->len = kSlotSize - 1;
+        read_sqe->off = 0;
+        read_sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+        struct io_uring_sqe* close_sqe = nextSqe(i, OP_CLOSE);
+        close_sqe->opcode = IORING_OP_CLOSE;
+        close_sqe->file_index = slot + 1;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    unsigned total = static_cast<unsigned>(count * 3);
+    long submitted = syscall(__NR_io_uring_enter, ring_fd_, total, total, IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (submitted < 0) submitted = 0;
+    // SQEs the kernel did not consume would go out with the next batch, pointing at this one's
+    // buffers: drop them from the ring, and their entries stay -ECANCELED for the slow path
+    if (static_cast<unsigned>(submitted) < total) __atomic_store_n(sq_tail_, start + static_cast<unsigned>(submitted), __ATOMIC_RELEASE);
+
+    bool unsupported = false;
+    bool wait_failed = false;
+    unsigned reaped = 0;
+    while (reaped < static_cast<unsigned>(submitted)) {
+        unsigned head = *cq_head_;
+        unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == cq_tail) {
+            if (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                // Submitted reads still write into data_, which the slow path reuses: keep
+                // draining, waiting on the ring descriptor instead of the failing syscall
+                wait_failed = true;
+                struct pollfd pfd = {ring_fd_, POLLIN, 0};
+                poll(&pfd, 1, 10);
+            }
+            continue;
+        }
+        for (; head != cq_tail; head++, reaped++) {
+            const struct io_uring_cqe& cqe = cqes[head & *cq_mask_];
+            size_t index = cqe.user_data >> 2;
+            BatchOp op = static_cast<BatchOp>(cqe.user_data & 3);
+
+            // Kernels without direct descriptors reject file_index with EINVAL
+            if (op == OP_OPEN && cqe.res == -EINVAL) unsupported = true;
+            if (op == OP_OPEN && cqe.res < 0) entries_[index].result = cqe.res;
+            if (op == OP_READ && entries_[index].result == -ECANCELED) {
+                entries_[index].result = cqe.res;
+                if (cqe.res >= 0) data_[index * kSlotSize + cqe.res] = '\0';
+            }
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    if (unsupported || wait_failed) {
+        closeRing();
+        ring_failed_ = true;
+        return false;
+    }
+
+    // Anything the kernel did not take is read the slow way
+    for (size_t i = first; i < first + count; i++) {
+        if (entries_[i].result == -ECANCELED) runSyscalls(i, 1);
+    }
+    return true;
+}
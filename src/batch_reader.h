@@ -0,0 +1,72 @@
+#ifndef BATCH_READER_H
+#define BATCH_READER_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Set by -u: use io_uring for batched sysfs reads when the kernel supports it
+extern bool use_io_uring;
+
+/**
+    Reads many small files (sysfs attributes, at most one page each) in one
+    batch. With io_uring every file is an openat -> read -> close chain using
+    a direct descriptor, and the whole batch is submitted and reaped with a
+    single io_uring_enter. Without io_uring, or on kernels that lack direct
+    descriptors (< 5.15), it falls back to openat/pread/close per file.
+ */
+class BatchReader {
+public:
+    static constexpr size_t kSlotSize = 4096;
+
+    BatchReader();
+    ~BatchReader();
+    BatchReader(const BatchReader&) = delete;
+    BatchReader& operator=(const BatchReader&) = delete;
+
+    // Queues name, relative to dirfd (or AT_FDCWD), and returns its index
+    size_t add(int dirfd, const char* name);
+    // Reads every queued file
+    void run();
+    // Drops the queue; buffers are kept for reuse
+    void clear();
+
+    size_t size() const { return entries_.size(); }
+    bool ok(size_t i) const { return entries_[i].result >= 0; }
+    std::string_view data(size_t i) const;
+    const char* name(size_t i) const { return entries_[i].name; }
+
+private:
+    struct Entry {
+        int dirfd;
+        int result;          // bytes read, or -errno
+        char name[256];
+    };
+
+    bool setupRing();
+    void closeRing();
+    bool runRing(size_t first, size_t count);
+    void runSyscalls(size_t first, size_t count);
+
+    std::vector<Entry> entries_;
+    std::vector<char> data_;
+
+    // io_uring state, set up lazily on first use
+    bool ring_failed_ = false;
+    int ring_fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    size_t sq_len_ = 0;
+    void* cq_ptr_ = nullptr;
+    size_t cq_len_ = 0;
+    void* sqes_ptr_ = nullptr;
+    size_t sqes_len_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+};
+
+#endif // BATCH_READER_H
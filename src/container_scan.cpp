@@ -0,0 +1,319 @@
+#include "container_scan.h"
+#include "file_reader.h"
+#include "batch_reader.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <algorithm>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+unsigned int container_scan_threads = 16;
+
+// Set on pool workers: std::cout is dropped and std::cerr goes to the current result
+static thread_local bool scan_worker = false;
+static thread_local std::string* scan_errors = nullptr;
+
+/**
+    Stands in for std::cout's or std::cerr's buffer while the pool runs.
+    Probe narration from hundreds of workers is noise, but the process-wide
+    descriptors stay untouched, so the main thread, the watchdog and
+    anything writing to fd 2 directly still reach the terminal.
+ */
+class WorkerStreamRouter : public std::streambuf {
+public:
+    WorkerStreamRouter(std::streambuf* passthrough, bool capture) : passthrough_(passthrough), capture_(capture) {}
+
+protected:
+    int overflow(int c) override {
+        if (c == traits_type::eof()) return traits_type::not_eof(c);
+        char ch = static_cast<char>(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (!scan_worker) return passthrough_->sputn(s, n);
+        if (capture_ && scan_errors) scan_errors->append(s, static_cast<size_t>(n));
+        return n;
+    }
+    int sync() override { return scan_worker ? 0 : passthrough_->pubsync(); }
+
+private:
+    std::streambuf* passthrough_;
+    bool capture_;
+};
+
+// Container id from a cgroup name such as "docker-<64 hex>.scope"
+static std::string containerName(std::string_view cgroup)
+{
+    size_t slash = cgroup.rfind('/');
+    std::string_view name = slash == std::string_view::npos ? cgroup : cgroup.substr(slash + 1);
+    if (name.size() > 6 && name.substr(name.size() - 6) == ".scope") name.remove_suffix(6);
+    for (std::string_view prefix : {"docker-", "cri-containerd-", "crio-", "libpod-"}) {
+        if (name.substr(0, prefix.size()) == prefix) {
+            name.remove_prefix(prefix.size());
+            // Full ids are 64 hex digits; the short form is what the runtimes print
+            if (name.size() == 64) name = name.substr(0, 12);
+            break;
+        }
+    }
+    return std::string(name);
+}
+
+// Label for a target: its cgroup v2 path's container id, else its command name
+static std::string targetLabel(int pid)
+{
+    static thread_local FileReader reader;
+    std::string proc = "/proc/" + std::to_string(pid);
+    if (reader.read((proc + "/cgroup").c_str())) {
+        LineScanner lines(reader.data());
+        std::string_view line;
+        while (lines.next(line)) {
+            if (line.substr(0, 3) != "0::") continue;
+            std::string_view path = line.substr(3);
+            if (path.size() > 1) return containerName(path);
+        }
+    }
+    if (reader.read((proc + "/comm").c_str())) return std::string(trim(reader.data()));
+    return "pid " + std::to_string(pid);
+}
+
+// Namespace identity of a process: the inodes behind /proc/<pid>/ns/{mnt,net}
+static bool namespaceIds(const std::string& proc, std::pair<ino_t, ino_t>& ids)
+{
+    struct stat mnt, net;
+    if (stat((proc + "/ns/mnt").c_str(), &mnt) != 0 || stat((proc + "/ns/net").c_str(), &net) != 0) return false;
+    ids = {mnt.st_ino, net.st_ino};
+    return true;
+}
+
+static bool findAllTargets(std::vector<ContainerTarget>& targets, std::string& error)
+{
+    std::pair<ino_t, ino_t> own;
+    if (!namespaceIds("/proc/self", own)) {
+        error = std::string("cannot read /proc/self/ns: ") + strerror(errno);
+        return false;
+    }
+    int proc_dir = openDirectory("/proc");
+    if (proc_dir < 0) {
+        error = std::string("cannot open /proc: ") + strerror(errno);
+        return false;
+    }
+
+    // Lowest PID per namespace pair, i.e. the container's init
+    std::map<std::pair<ino_t, ino_t>, int> first;
+    FileReader cmdline;
+    DirScanner entries(proc_dir);
+    const char* name;
+    while (entries.next(name)) {
+        uint64_t pid;
+        std::pair<ino_t, ino_t> ids;
+        std::string proc = std::string("/proc/") + name;
+        if (!parseUnsigned(name, pid) || !namespaceIds(proc, ids) || ids == own) continue;
+        // Kernel threads (devtmpfs has its own mount namespace) have no command line
+        if (!cmdline.read((proc + "/cmdline").c_str()) || cmdline.data().empty()) continue;
+        auto [it, inserted] = first.emplace(ids, static_cast<int>(pid));
+        if (!inserted) it->second = std::min(it->second, static_cast<int>(pid));
+    }
+    close(proc_dir);
+
+    std::vector<int> pids;
+    for (const auto& [ids, pid] : first) pids.push_back(pid);
+    std::sort(pids.begin(), pids.end());
+    for (int pid : pids) targets.push_back({pid, targetLabel(pid)});
+    return true;
+}
+
+static bool findCgroupTarget(std::string_view cgroup, std::vector<ContainerTarget>& targets, std::string& error)
+{
+    std::string dir(cgroup);
+    if (dir.empty() || dir[0] != '/') dir = "/sys/fs/cgroup/" + dir;
+    FileReader procs;
+    if (!procs.read((dir + "/cgroup.procs").c_str())) {
+        error = "cannot read " + dir + "/cgroup.procs: " + strerror(errno);
+        return false;
+    }
+    LineScanner lines(procs.data());
+    std::string_view line;
+    uint64_t pid;
+    if (!lines.next(line) || !parseUnsigned(trim(line), pid)) {
+        error = "no processes in cgroup " + dir;
+        return false;
+    }
+    targets.push_back({static_cast<int>(pid), containerName(dir)});
+    return true;
+}
+
+bool findContainerTargets(const std::string& spec, std::vector<ContainerTarget>& targets, std::string& error)
+{
+    FieldScanner items(spec, ",");
+    std::string_view item;
+    while (items.next(item)) {
+        uint64_t pid;
+        if (item == "all") {
+            if (!findAllTargets(targets, error)) return false;
+        } else if (item.substr(0, 7) == "cgroup:") {
+            if (!findCgroupTarget(item.substr(7), targets, error)) return false;
+        } else if (parseUnsigned(item, pid) && pid > 0) {
+            targets.push_back({static_cast<int>(pid), targetLabel(static_cast<int>(pid))});
+        } else {
+            error = "bad target \"" + std::string(item) + "\" (expected a PID, cgroup:<path> or all)";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Opens one of a process's namespace files, -1 on failure
+static int openNamespace(const std::string& proc, const char* type)
+{
+    return open((proc + "/ns/" + type).c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+/**
+    Scans one target from a worker that has already unshared CLONE_FS.
+    Returns false only when the worker could not get back into our own
+    namespaces and must not take further targets.
+ */
+static bool scanTarget(ContainerResult& result, int own_mnt, int own_net)
+{
+    std::string proc = "/proc/" + std::to_string(result.target.pid);
+    auto start = std::chrono::steady_clock::now();
+
+    // Everything under /proc/<pid> is read first: the target's /proc has other PIDs
+    NamespaceScan scan;
+    static thread_local FileReader environ_file(16 * 1024);
+    int mnt = openNamespace(proc, "mnt");
+    int net = openNamespace(proc, "net");
+    if (mnt < 0 || net < 0) {
+        result.error = errno == ENOENT ? "process exited" : std::string("cannot open namespaces: ") + strerror(errno);
+        if (mnt >= 0) close(mnt);
+        if (net >= 0) close(net);
+        return true;
+    }
+    if (environ_file.read((proc + "/environ").c_str())) scan.environment = std::string(environ_file.data());
+
+    bool joined_net = setns(net, CLONE_NEWNET) == 0;
+    bool joined_mnt = joined_net && setns(mnt, CLONE_NEWNS) == 0;
+    if (joined_mnt) {
+        scan_errors = &result.errors;
+        runNamespaceTests(scan, result.probes);
+        scan_errors = nullptr;
+    } else result.error = std::string("setns: ") + strerror(errno);
+    close(mnt);
+    close(net);
+
+    bool back = (!joined_mnt || setns(own_mnt, CLONE_NEWNS) == 0) && (!joined_net || setns(own_net, CLONE_NEWNET) == 0);
+    result.elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return back;
+}
+
+void scanContainers(const std::vector<ContainerTarget>& targets, std::vector<ContainerResult>& results)
+{
+    results.assign(targets.size(), ContainerResult());
+    for (size_t i = 0; i < targets.size(); i++) results[i].target = targets[i];
+    if (targets.empty()) return;
+
+    int own_mnt = openNamespace("/proc/self", "mnt");
+    int own_net = openNamespace("/proc/self", "net");
+    if (own_mnt < 0 || own_net < 0) {
+        std::string error = std::string("cannot open our namespaces: ") + strerror(errno);
+        for (auto& result : results) result.error = error;
+        if (own_mnt >= 0) close(own_mnt);
+        if (own_net >= 0) close(own_net);
+        return;
+    }
+
+    // io-wq threads would share a worker's fs context, and setns(CLONE_NEWNS) needs it unshared
+    bool saved_io_uring = use_io_uring;
+    use_io_uring = false;
+
+    std::cout.flush();
+    std::cerr.flush();
+    WorkerStreamRouter out(std::cout.rdbuf(), false);
+    WorkerStreamRouter err(std::cerr.rdbuf(), true);
+    std::streambuf* saved_out = std::cout.rdbuf(&out);
+    std::streambuf* saved_err = std::cerr.rdbuf(&err);
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        scan_worker = true;
+        // setns into a mount namespace needs a filesystem context no other thread shares
+        if (unshare(CLONE_FS) != 0) {
+            std::string error = std::string("unshare(CLONE_FS): ") + strerror(errno);
+            for (size_t i = next++; i < results.size(); i = next++) results[i].error = error;
+            return;
+        }
+        for (size_t i = next++; i < results.size(); i = next++) {
+            if (!scanTarget(results[i], own_mnt, own_net)) return;
+        }
+    };
+    std::vector<std::thread> pool;
+    size_t threads = std::min<size_t>(std::max(1u, container_scan_threads), targets.size());
+    for (size_t t = 0; t < threads; t++) pool.emplace_back(worker);
+    for (auto& thread : pool) thread.join();
+
+    std::cout.rdbuf(saved_out);
+    std::cerr.rdbuf(saved_err);
+    use_io_uring = saved_io_uring;
+    close(own_mnt);
+    close(own_net);
+
+    // Workers that could not rejoin our namespaces stopped early
+    for (auto& result : results) {
+        if (result.error.empty() && result.probes.empty()) result.error = "not scanned (a worker could not leave a container)";
+    }
+}
+
+void printContainerReport(const std::vector<ContainerResult>& results)
+{
+    std::cout << "\n===== Container Scan =====" << std::endl;
+
+    size_t flagged = 0, failed = 0;
+    std::map<std::string, size_t> seen;     // evidence item -> containers showing it
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(8) << result.target.pid << std::setw(20) << result.target.label << std::right;
+        if (!result.error.empty()) {
+            std::cout << "error: " << result.error << std::endl;
+            failed++;
+            continue;
+        }
+
+        size_t detected = 0;
+        std::set<std::string> evidence;
+        for (const auto& [name, probe] : result.probes) {
+            if (probe.detected) detected++;
+            evidence.insert(probe.evidence.begin(), probe.evidence.end());
+        }
+        for (const auto& item : evidence) seen[item]++;
+        if (detected > 0) flagged++;
+
+        std::cout << detected << "/" << result.probes.size() << " tests, "
+                  << std::fixed << std::setprecision(1) << result.elapsed_ns / 1e6 << " ms";
+        std::cout.unsetf(std::ios::floatfield);
+        if (!evidence.empty()) {
+            std::cout << ":";
+            for (const auto& item : evidence) std::cout << " " << item;
+        }
+        std::cout << std::endl;
+
+        LineScanner lines(result.errors);
+        std::string_view line;
+        while (lines.next(line)) std::cout << "        stderr: " << line << std::endl;
+    }
+
+    std::cout << "\n" << results.size() << " containers scanned: " << flagged << " with virtualization artifacts, "
+              << failed << " failed." << std::endl;
+    if (!seen.empty()) {
+        std::cout << "Evidence across containers:" << std::endl;
+        for (const auto& [item, count] : seen)
+            std::cout << "  " << item << ": " << count << " of " << results.size() - failed << std::endl;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef CONTAINER_SCAN_H
+#define CONTAINER_SCAN_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "vm_detection.h"
+
+// A process whose namespaces are scanned, normally a container's init
+struct ContainerTarget {
+    int pid = 0;
+    std::string label;      // container id from the cgroup path, else the command name
+};
+
+struct ContainerResult {
+    ContainerTarget target;
+    std::string error;                          // empty when the probes ran
+    std::map<std::string, ProbeResult> probes;  // namespace_tests, by name
+    std::string errors;                         // what the probes wrote to std::cerr
+    uint64_t elapsed_ns = 0;
+};
+
+// Worker threads used by scanContainers, settable with -j
+extern unsigned int container_scan_threads;
+
+/**
+    Resolves a comma-separated target list. Each item is a PID, a cgroup
+    ("cgroup:system.slice/docker-<id>.scope", relative to /sys/fs/cgroup
+    unless absolute; its first process is used) or "all": the lowest PID of
+    every mount/network namespace pair other than our own.
+ */
+bool findContainerTargets(const std::string& spec, std::vector<ContainerTarget>& targets, std::string& error);
+
+/**
+    Scans every target from a pool of threads in this process, so nothing is
+    deployed into the containers and nothing is forked. Each worker unshares
+    its filesystem context once, then per target reads /proc/<pid>/environ,
+    joins the target's network and mount namespaces with setns(), runs
+    namespace_tests and rejoins ours. While the pool runs, what the workers
+    write to std::cout is dropped and what they write to std::cerr lands in
+    their result's errors; other threads print as usual. Results come back
+    in target order.
+ */
+void scanContainers(const std::vector<ContainerTarget>& targets, std::vector<ContainerResult>& results);
+
+// One line per container, then how many containers showed each evidence item
+void printContainerReport(const std::vector<ContainerResult>& results);
+
+#endif // CONTAINER_SCAN_H
@@ -0,0 +1,127 @@
+#include "descriptor_tables.h"
+#include "file_reader.h"
+#include <thread>
+#include <system_error>
+#include <mutex>
+#include <csignal>
+#include <csetjmp>
+#include <sched.h>
+#include <pthread.h>
+
+namespace {
+
+#if defined(__x86_64__)
+// Jump buffer of the thread currently executing SGDT/SIDT, null everywhere else
+thread_local sigjmp_buf* fault_jump = nullptr;
+
+std::mutex handler_mutex;
+int handler_users = 0;
+struct sigaction previous_segv;
+
+/**
+    Only async-signal-safe work here: jump back into the sampling thread, or
+    hand a fault that is not ours back to the previous disposition. Returning
+    re-executes the faulting instruction under that disposition.
+ */
+void faultHandler(int) {
+    if (fault_jump) siglongjmp(*fault_jump, 1);
+    sigaction(SIGSEGV, &previous_segv, nullptr);
+}
+
+// The handler stays installed while any sampler runs; the last one restores the old one
+void acquireHandler() {
+    std::lock_guard<std::mutex> lock(handler_mutex);
+    if (handler_users++ > 0) return;
+    struct sigaction action = {};
+    action.sa_handler = faultHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_NODEFER;
+    sigaction(SIGSEGV, &action, &previous_segv);
+}
+
+void releaseHandler() {
+    std::lock_guard<std::mutex> lock(handler_mutex);
+    if (--handler_users == 0) sigaction(SIGSEGV, &previous_segv, nullptr);
+}
+
+bool cpuHasUmip() {
+    FileReader cpuinfo;
+    if (!cpuinfo.read("/proc/cpuinfo")) return false;
+
+    LineScanner lines(cpuinfo.data());
+    std::string_view line;
+    while (lines.next(line)) {
+        if (line.substr(0, 5) != "flags") continue;
+        FieldScanner flags(line.substr(line.find(':') + 1));
+        std::string_view flag;
+        while (flags.next(flag)) {
+            if (flag == "umip") return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+struct __attribute__((packed)) TableRegister {
+    uint16_t limit;
+    uint64_t base;
+};
+
+void sampleCpu(CpuDescriptorTables& result) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(result.cpu, &set);
+    result.pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+
+    TableRegister gdtr = {}, idtr = {};
+    sigjmp_buf jump;
+    // Saving the mask lets siglongjmp unblock SIGSEGV on the way out
+    if (sigsetjmp(jump, 1) == 0) {
+        fault_jump = &jump;
+        asm volatile("sgdt %0" : "=m"(gdtr));
+        asm volatile("sidt %0" : "=m"(idtr));
+    } else {
+        result.faulted = true;
+    }
+    fault_jump = nullptr;
+
+    result.gdt_limit = gdtr.limit;
+    result.gdt_base = gdtr.base;
+    result.idt_limit = idtr.limit;
+    result.idt_base = idtr.base;
+}
+#endif
+
+} // namespace
+
+bool sampleDescriptorTables(DescriptorTableReport& report) {
+    report = DescriptorTableReport();
+#if defined(__x86_64__)
+    report.umip = cpuHasUmip();
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) report.cpus.emplace_back().cpu = cpu;
+    }
+
+    acquireHandler();
+    std::vector<std::thread> threads;
+    threads.reserve(report.cpus.size());
+    bool started = true;
+    try {
+        for (auto& cpu : report.cpus) threads.emplace_back(sampleCpu, std::ref(cpu));
+    } catch (const std::system_error&) {
+        // Out of threads: the ones already running still need the handler until they are joined
+        started = false;
+    }
+    for (auto& thread : threads) thread.join();
+    releaseHandler();
+    if (!started) return false;
+
+    report.ok = !report.cpus.empty();
+    return report.ok;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef DESCRIPTOR_TABLES_H
+#define DESCRIPTOR_TABLES_H
+
+#include <cstdint>
+#include <vector>
+
+// GDTR/IDTR as read by SGDT/SIDT on one CPU
+struct CpuDescriptorTables {
+    int cpu = -1;
+    bool pinned = false;         // the sampling thread ran on this CPU
+    bool faulted = false;        // SGDT/SIDT raised SIGSEGV (UMIP without emulation)
+    uint16_t gdt_limit = 0;
+    uint64_t gdt_base = 0;
+    uint16_t idt_limit = 0;
+    uint64_t idt_base = 0;
+};
+
+struct DescriptorTableReport {
+    bool ok = false;
+    bool umip = false;           // "umip" in /proc/cpuinfo: user-mode SGDT/SIDT trap to the kernel
+    std::vector<CpuDescriptorTables> cpus;
+};
+
+// Values the kernel's UMIP emulation returns instead of the real bases
+#define UMIP_DUMMY_GDT_BASE 0xfffffffffffe0000ull
+#define UMIP_DUMMY_IDT_BASE 0xffffffffffff0000ull
+
+/**
+    Runs SGDT/SIDT on every CPU in the affinity mask, one pinned thread per
+    CPU, all in parallel. Faults are recovered with siglongjmp into the
+    faulting thread's own jump buffer, so the probe is safe next to other
+    threads. x86-64 only; returns false elsewhere.
+ */
+bool sampleDescriptorTables(DescriptorTableReport& report);
+
+#endif // DESCRIPTOR_TABLES_H
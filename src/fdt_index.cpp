@@ -0,0 +1,101 @@
+#include "fdt_index.h"
+#include <cstring>
+
+namespace {
+
+const uint32_t FDT_MAGIC = 0xd00dfeed;
+const uint32_t FDT_BEGIN_NODE = 1;
+const uint32_t FDT_END_NODE = 2;
+const uint32_t FDT_PROP = 3;
+const uint32_t FDT_NOP = 4;
+const uint32_t FDT_END = 9;
+
+// The blob is big-endian and only 4-byte aligned within itself
+uint32_t be32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | b[3];
+}
+
+size_t align4(size_t offset) {
+    return (offset + 3) & ~size_t(3);
+}
+
+} // namespace
+
+std::string FdtIndex::path(int node) const {
+    if (node <= 0) return "/";
+    std::string result;
+    for (int n = node; n > 0; n = nodes[n].parent) result.insert(0, "/" + std::string(nodes[n].name));
+    return result;
+}
+
+bool indexFdt(std::string_view blob, FdtIndex& index) {
+    index = FdtIndex();
+    // magic totalsize off_dt_struct off_dt_strings off_mem_rsvmap version
+    // last_comp_version boot_cpuid_phys size_dt_strings size_dt_struct
+    if (blob.size() < 40 || be32(blob.data()) != FDT_MAGIC) return false;
+    uint32_t total = be32(blob.data() + 4);
+    uint32_t struct_off = be32(blob.data() + 8);
+    uint32_t strings_off = be32(blob.data() + 12);
+    index.version = be32(blob.data() + 20);
+    uint32_t strings_size = be32(blob.data() + 32);
+    uint32_t struct_size = be32(blob.data() + 36);
+    if (total > blob.size() || struct_off > total || strings_off > total ||
+        struct_size > total - struct_off || strings_size > total - strings_off)
+        return false;
+
+    const char* base = blob.data() + struct_off;
+    std::string_view strings(blob.data() + strings_off, strings_size);
+    size_t pos = 0;
+    int current = -1;
+
+    while (pos + 4 <= struct_size) {
+        uint32_t token = be32(base + pos);
+        pos += 4;
+        switch (token) {
+            case FDT_BEGIN_NODE: {
+                const char* name = base + pos;
+                size_t len = strnlen(name, struct_size - pos);
+                if (len == struct_size - pos) return false;
+                FdtNode& node = index.nodes.emplace_back();
+                node.name = std::string_view(name, len);
+                node.parent = current;
+                current = static_cast<int>(index.nodes.size()) - 1;
+                pos = align4(pos + len + 1);
+                break;
+            }
+            case FDT_END_NODE:
+                if (current < 0) return false;
+                current = index.nodes[current].parent;
+                break;
+            case FDT_PROP: {
+                if (pos + 8 > struct_size || current < 0) return false;
+                uint32_t len = be32(base + pos);
+                uint32_t name_off = be32(base + pos + 4);
+                pos += 8;
+                if (len > struct_size - pos || name_off >= strings.size()) return false;
+                std::string_view value(base + pos, len);
+                pos = align4(pos + len);
+
+                const char* prop = strings.data() + name_off;
+                if (strncmp(prop, "compatible", strings.size() - name_off) != 0) break;
+                // NUL-separated list, most specific first
+                while (!value.empty()) {
+                    size_t end = value.find('\0');
+                    std::string_view entry = value.substr(0, end);
+                    if (!entry.empty()) index.compatibles.push_back({current, entry});
+                    if (end == std::string_view::npos) break;
+                    value.remove_prefix(end + 1);
+                }
+                break;
+            }
+            case FDT_NOP:
+                break;
+            case FDT_END:
+                return current == -1;
+            default:
+                return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,38 @@
+#ifndef FDT_INDEX_H
+#define FDT_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+    Index over a flattened device tree blob (the /sys/firmware/fdt format),
+    built in one pass over the structure block. Every view points into the
+    blob, so the blob must outlive the index.
+ */
+struct FdtNode {
+    std::string_view name;         // "virtio_mmio@a000000"; empty for the root
+    int parent = -1;
+};
+
+struct FdtCompatible {
+    int node = -1;
+    std::string_view value;        // one entry of the node's compatible list
+};
+
+struct FdtIndex {
+    uint32_t version = 0;
+    std::vector<FdtNode> nodes;
+    std::vector<FdtCompatible> compatibles;
+
+    // "/smb/virtio_mmio@a000000"
+    std::string path(int node) const;
+};
+
+#define FDT_BLOB_PATH "/sys/firmware/fdt"
+
+// Parses the blob into index; false if it is not a valid FDT
+bool indexFdt(std::string_view blob, FdtIndex& index);
+
+#endif // FDT_INDEX_H
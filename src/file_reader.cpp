@@ -0,0 +1,133 @@
+#include "file_reader.h"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+FileReader::FileReader(size_t initial_size) : buf_(initial_size) {}
+
+bool FileReader::read(const char* path) {
+    return readAt(AT_FDCWD, path);
+}
+
+bool FileReader::readAt(int dirfd, const char* name) {
+    len_ = 0;
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = readWhole(fd);
+    close(fd);
+    return ok;
+}
+
+bool FileReader::readFd(int fd) {
+    len_ = 0;
+    return readWhole(fd);
+}
+
+// Reads from offset 0 until a read returns 0. seq_file-backed procfs files
+// (cpuinfo, stat, schedstat) return about a page per read whatever the
+// buffer size, so a short read does not mean the end of the file.
+bool FileReader::readWhole(int fd) {
+    len_ = 0;
+    while (true) {
+        if (len_ == buf_.size() - 1) buf_.resize(buf_.size() * 2);
+        ssize_t n = pread(fd, buf_.data() + len_, buf_.size() - 1 - len_, static_cast<off_t>(len_));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            len_ = 0;
+            buf_[0] = '\0';
+            return false;
+        }
+        if (n == 0) break;
+        len_ += n;
+    }
+    buf_[len_] = '\0';
+    return true;
+}
+
+bool FileReader::readStream(int fd) {
+    len_ = 0;
+    while (true) {
+        if (len_ == buf_.size() - 1) buf_.resize(buf_.size() * 2);
+        ssize_t n = ::read(fd, buf_.data() + len_, buf_.size() - 1 - len_);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            buf_[len_] = '\0';
+            return false;
+        }
+        if (n == 0) break;
+        len_ += n;
+    }
+    buf_[len_] = '\0';
+    return true;
+}
+
+bool DirScanner::next(const char*& name) {
+    while (true) {
+        if (pos_ >= len_) {
+            len_ = syscall(SYS_getdents64, fd_, buf_, sizeof(buf_));
+            pos_ = 0;
+            if (len_ <= 0) return false;
+        }
+        // struct linux_dirent64: d_ino, d_off, d_reclen, d_type, d_name[]
+        const char* entry = buf_ + pos_;
+        unsigned short reclen;
+        memcpy(&reclen, entry + 16, sizeof(reclen));
+        pos_ += reclen;
+
+        name = entry + 19;
+        if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0) return true;
+    }
+}
+
+int openDirectory(const char* path) {
+    return openDirectoryAt(AT_FDCWD, path);
+}
+
+int openDirectoryAt(int dirfd, const char* name) {
+    return openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) return std::string_view();
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    if (needle.empty()) return true;
+    if (needle.size() > haystack.size()) return false;
+    for (size_t i = 0; i + needle.size() <= haystack.size(); i++) {
+        if (strncasecmp(haystack.data() + i, needle.data(), needle.size()) == 0) return true;
+    }
+    return false;
+}
+
+bool parseUnsigned(std::string_view text, uint64_t& value, int base) {
+    char tmp[32];
+    text = trim(text);
+    if (text.empty() || text.size() >= sizeof(tmp)) return false;
+    memcpy(tmp, text.data(), text.size());
+    tmp[text.size()] = '\0';
+
+    char* end;
+    errno = 0;
+    value = strtoull(tmp, &end, base);
+    return errno == 0 && *end == '\0';
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    char tmp[64];
+    text = trim(text);
+    if (text.empty() || text.size() >= sizeof(tmp)) return false;
+    memcpy(tmp, text.data(), text.size());
+    tmp[text.size()] = '\0';
+
+    char* end;
+    value = strtod(tmp, &end);
+    return *end == '\0';
+}
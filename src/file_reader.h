@@ -0,0 +1,104 @@
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+    Reads small procfs/sysfs files to EOF into a buffer that is reused
+    across calls, so repeated scans do not touch the heap once the
+    buffer has grown to fit. Views returned by data() stay valid until the
+    next read on the same reader.
+ */
+class FileReader {
+public:
+    explicit FileReader(size_t initial_size = 4096);
+
+    bool read(const char* path);
+    // Reads name relative to an open directory fd (see openDirectory)
+    bool readAt(int dirfd, const char* name);
+    // Re-reads an already open file from offset 0 with pread
+    bool readFd(int fd);
+    // Reads a pipe or other stream until EOF
+    bool readStream(int fd);
+
+    std::string_view data() const { return std::string_view(buf_.data(), len_); }
+
+private:
+    bool readWhole(int fd);
+
+    std::vector<char> buf_;
+    size_t len_ = 0;
+};
+
+// Splits text into lines without copying; the trailing '\n' is dropped
+class LineScanner {
+public:
+    explicit LineScanner(std::string_view text) : rest_(text) {}
+
+    bool next(std::string_view& line) {
+        if (rest_.empty()) return false;
+        size_t end = rest_.find('\n');
+        line = rest_.substr(0, end);
+        rest_ = (end == std::string_view::npos) ? std::string_view() : rest_.substr(end + 1);
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+};
+
+// Splits a line into fields separated by any of the delimiter characters
+class FieldScanner {
+public:
+    explicit FieldScanner(std::string_view line, std::string_view delims = " \t")
+        : rest_(line), delims_(delims) {}
+
+    bool next(std::string_view& field) {
+        size_t start = rest_.find_first_not_of(delims_);
+        if (start == std::string_view::npos) return false;
+        rest_ = rest_.substr(start);
+        size_t end = rest_.find_first_of(delims_);
+        field = rest_.substr(0, end);
+        rest_ = (end == std::string_view::npos) ? std::string_view() : rest_.substr(end);
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+    std::string_view delims_;
+};
+
+/**
+    Iterates directory entries with getdents64 into a fixed buffer, skipping
+    "." and "..". Names are NUL-terminated and valid until the next call.
+ */
+class DirScanner {
+public:
+    explicit DirScanner(int dirfd) : fd_(dirfd) {}
+    bool next(const char*& name);
+
+private:
+    int fd_;
+    alignas(8) char buf_[4096];
+    long len_ = 0;
+    long pos_ = 0;
+};
+
+// Opens a directory for use with FileReader::readAt and DirScanner, -1 on failure
+int openDirectory(const char* path);
+int openDirectoryAt(int dirfd, const char* name);
+
+// Removes leading and trailing whitespace
+std::string_view trim(std::string_view text);
+
+// Case-insensitive substring search (ASCII)
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle);
+
+// Parse a number with strtoull/strtod semantics (base 0 accepts 0x prefixes)
+bool parseUnsigned(std::string_view text, uint64_t& value, int base = 10);
+bool parseDouble(std::string_view text, double& value);
+
+#endif // FILE_READER_H
@@ -0,0 +1,321 @@
+#include "hw_fingerprint.h"
+#include "arm_platform.h"
+#include "batch_reader.h"
+#include "file_reader.h"
+#include "kernel_snapshot.h"
+#include "netlink_links.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <net/if_arp.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+const char* const fingerprint_component_names[FP_COMPONENTS] = {"cpuid", "dmi", "acpi", "pci", "nic"};
+
+HardwareFingerprint hardware_fingerprint;
+
+namespace {
+
+// DMI fields that name the platform; serials, UUIDs, asset tags and BIOS versions/dates change per host or update
+const char* const dmi_model_fields[] = {
+    "sys_vendor", "product_name", "product_version", "product_family",
+    "board_vendor", "board_name", "chassis_vendor", "chassis_type", "bios_vendor",
+};
+
+// The snapshot truncates DMI values to this; sysfs values are cut the same way so both sources agree
+const size_t dmi_value_max = sizeof(vmd_snap_dmi::value) - 1;
+
+// FNV-1a 128 (offset basis and prime from the FNV reference)
+class Fnv128 {
+public:
+    void add(std::string_view bytes) {
+        for (unsigned char c : bytes) {
+            state_ ^= c;
+            state_ *= prime();
+        }
+    }
+    void add(const Hash128& hash) {
+        unsigned char bytes[16];
+        for (int i = 0; i < 8; i++) {
+            bytes[i] = static_cast<unsigned char>(hash.hi >> (56 - 8 * i));
+            bytes[8 + i] = static_cast<unsigned char>(hash.lo >> (56 - 8 * i));
+        }
+        add(std::string_view(reinterpret_cast<const char*>(bytes), sizeof(bytes)));
+    }
+    Hash128 digest() const {
+        Hash128 hash;
+        hash.hi = static_cast<uint64_t>(state_ >> 64);
+        hash.lo = static_cast<uint64_t>(state_);
+        return hash;
+    }
+
+private:
+    static unsigned __int128 prime() { return static_cast<unsigned __int128>(0x0000000001000000ull) << 64 | 0x000000000000013bull; }
+
+    unsigned __int128 state_ = static_cast<unsigned __int128>(0x6c62272e07bb0142ull) << 64 | 0x62b821756295c58dull;
+};
+
+// Printable ASCII only, trimmed, so entries stay one line and hash the same everywhere
+std::string canonicalValue(std::string_view text, size_t max_len = std::string::npos) {
+    text = trim(text.substr(0, text.find('\0')));
+    if (text.size() > max_len) text = trim(text.substr(0, max_len));
+    std::string value(text);
+    for (char& c : value) {
+        if (c < 0x20 || c > 0x7e) c = '?';
+    }
+    return value;
+}
+
+std::string hexEntry(const char* key, uint32_t value) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s=0x%x", key, value);
+    return buf;
+}
+
+void addCpuid(std::vector<std::string>& entries) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    char vendor[13] = {};
+    __cpuid(0, eax, ebx, ecx, edx);
+    memcpy(vendor + 0, &ebx, 4);
+    memcpy(vendor + 4, &edx, 4);
+    memcpy(vendor + 8, &ecx, 4);
+    entries.push_back("cpu-vendor=" + canonicalValue(vendor));
+
+    __cpuid(1, eax, ebx, ecx, edx);
+    bool hypervisor = ecx & (1u << 31);
+    entries.push_back(std::string("hypervisor-bit=") + (hypervisor ? "1" : "0"));
+    // Without the bit, leaf 0x40000000 is the highest basic leaf's data, not a hypervisor's
+    if (!hypervisor) return;
+
+    __cpuid(0x40000000, eax, ebx, ecx, edx);
+    char signature[13] = {};
+    memcpy(signature + 0, &ebx, 4);
+    memcpy(signature + 4, &ecx, 4);
+    memcpy(signature + 8, &edx, 4);
+    entries.push_back("hypervisor-vendor=" + canonicalValue(signature));
+    entries.push_back(hexEntry("hypervisor-max-leaf", eax));
+    if (eax >= 0x40000001) {
+        __cpuid(0x40000001, eax, ebx, ecx, edx);
+        // KVM feature bits, Hyper-V's "Hv#1" interface signature
+        entries.push_back(hexEntry("hypervisor-leaf1-eax", eax));
+    }
+#elif defined(__aarch64__)
+    std::vector<ArmCpuIdentity> cpus;
+    if (readArmCpuIdentity(cpus)) {
+        for (const auto& cpu : cpus) {
+            char buf[48];
+            snprintf(buf, sizeof(buf), "midr=0x%02x:0x%03x", midrImplementer(cpu.midr), midrPartNum(cpu.midr));
+            entries.push_back(buf);
+        }
+    }
+    HypervisorDiscovery discovery;
+    discoverHypervisor(discovery);
+    if (!discovery.xen_type.empty()) entries.push_back("xen-type=" + canonicalValue(discovery.xen_type));
+    if (!discovery.kvm_ptp_clock.empty()) entries.push_back("kvm-ptp=1");
+    if (!discovery.dt_hypervisor.empty()) entries.push_back("dt-hypervisor=" + canonicalValue(discovery.dt_hypervisor));
+    if (!discovery.dt_psci_method.empty()) entries.push_back("psci=" + canonicalValue(discovery.dt_psci_method));
+    else if (discovery.acpi_fadt_read) entries.push_back(std::string("psci=") + (discovery.acpi_psci_hvc ? "hvc" : "smc"));
+#else
+    (void)entries;
+#endif
+}
+
+void addDmi(const KernelSnapshot* snapshot, std::vector<std::string>& entries) {
+    if (snapshot && snapshot->has(VMD_SNAP_DMI)) {
+        auto fields = snapshot->dmi();
+        for (size_t i = 0; i < fields.size(); i++) {
+            std::string field = snapshotString(fields[i].field);
+            if (std::find(std::begin(dmi_model_fields), std::end(dmi_model_fields), field) == std::end(dmi_model_fields)) continue;
+            std::string value = canonicalValue(snapshotString(fields[i].value), dmi_value_max);
+            if (!value.empty()) entries.push_back(field + "=" + value);
+        }
+        return;
+    }
+
+    int dmi_dir = openDirectory("/sys/class/dmi/id");
+    if (dmi_dir < 0) return;
+    static thread_local BatchReader files;
+    files.clear();
+    for (const char* field : dmi_model_fields) files.add(dmi_dir, field);
+    files.run();
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!files.ok(i)) continue;
+        std::string value = canonicalValue(files.data(i), dmi_value_max);
+        if (!value.empty()) entries.push_back(std::string(files.name(i)) + "=" + value);
+    }
+    close(dmi_dir);
+}
+
+std::string acpiEntry(const char* signature, const char* oem_id, const char* oem_table_id, const char* creator_id) {
+    return "table=" + canonicalValue(std::string_view(signature, 4)) + " " + canonicalValue(std::string_view(oem_id, 6)) +
+           " " + canonicalValue(std::string_view(oem_table_id, 8)) + " " + canonicalValue(std::string_view(creator_id, 4));
+}
+
+void addAcpi(const KernelSnapshot* snapshot, std::vector<std::string>& entries) {
+    if (snapshot && snapshot->has(VMD_SNAP_ACPI)) {
+        auto tables = snapshot->acpi();
+        for (size_t i = 0; i < tables.size(); i++)
+            entries.push_back(acpiEntry(tables[i].signature, tables[i].oem_id, tables[i].oem_table_id, tables[i].creator_id));
+        return;
+    }
+
+    // Only the 36-byte common header of each installed table; the tables/dynamic subdirectory is runtime-loaded
+    int tables_dir = openDirectory("/sys/firmware/acpi/tables");
+    if (tables_dir < 0) return;
+    DirScanner names(tables_dir);
+    const char* name;
+    while (names.next(name)) {
+        int fd = openat(tables_dir, name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        vmd_snap_acpi header;
+        if (pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)))
+            entries.push_back(acpiEntry(header.signature, header.oem_id, header.oem_table_id, header.creator_id));
+        close(fd);
+    }
+    close(tables_dir);
+}
+
+std::string pciEntry(uint32_t vendor, uint32_t device, uint32_t subsys_vendor, uint32_t subsys_device, uint32_t class_code) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "device=%04x:%04x %04x:%04x %06x", vendor, device, subsys_vendor, subsys_device, class_code);
+    return buf;
+}
+
+void addPci(const KernelSnapshot* snapshot, std::vector<std::string>& entries) {
+    if (snapshot && snapshot->has(VMD_SNAP_PCI)) {
+        auto devices = snapshot->pci();
+        for (size_t i = 0; i < devices.size(); i++) {
+            const vmd_snap_pci& d = devices[i];
+            entries.push_back(pciEntry(d.vendor, d.device, d.subsystem_vendor, d.subsystem_device, d.class_code));
+        }
+        return;
+    }
+
+    int pci_dir = openDirectory("/sys/bus/pci/devices");
+    if (pci_dir < 0) return;
+    static const char* const attributes[] = {"vendor", "device", "subsystem_vendor", "subsystem_device", "class"};
+    const size_t count = sizeof(attributes) / sizeof(attributes[0]);
+    static thread_local BatchReader batch;
+    batch.clear();
+    DirScanner functions(pci_dir);
+    const char* function;
+    char path[300];
+    while (functions.next(function)) {
+        for (const char* attribute : attributes) {
+            snprintf(path, sizeof(path), "%s/%s", function, attribute);
+            batch.add(pci_dir, path);
+        }
+    }
+    batch.run();
+
+    for (size_t i = 0; i + count <= batch.size(); i += count) {
+        uint64_t values[count] = {};
+        bool ok = true;
+        for (size_t j = 0; j < count && ok; j++)
+            ok = batch.ok(i + j) && parseUnsigned(trim(batch.data(i + j)), values[j], 16);
+        if (!ok) continue;
+        entries.push_back(pciEntry(static_cast<uint32_t>(values[0]), static_cast<uint32_t>(values[1]), static_cast<uint32_t>(values[2]),
+                                   static_cast<uint32_t>(values[3]), static_cast<uint32_t>(values[4])));
+    }
+    close(pci_dir);
+}
+
+void addOui(const uint8_t* mac, std::vector<std::string>& entries) {
+    static const uint8_t zero[6] = {};
+    if (memcmp(mac, zero, 6) == 0) return;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "oui=%02x:%02x:%02x", mac[0], mac[1], mac[2]);
+    entries.push_back(buf);
+}
+
+// The burned-in address when the link has one, so a MAC override does not move the fingerprint
+void addNics(const KernelSnapshot* snapshot, std::vector<std::string>& entries) {
+    static const uint8_t zero[6] = {};
+    if (snapshot && snapshot->has(VMD_SNAP_NETDEV)) {
+        auto links = snapshot->netdevs();
+        for (size_t i = 0; i < links.size(); i++) {
+            const vmd_snap_netdev& link = links[i];
+            if (!link.parent_bus[0] || link.type != ARPHRD_ETHER) continue;
+            addOui(memcmp(link.perm_addr, zero, 6) != 0 ? link.perm_addr : link.addr, entries);
+        }
+        return;
+    }
+
+    static thread_local std::vector<LinkInfo> links;
+    if (!dumpLinks(links)) return;
+    for (const auto& link : links) {
+        if (link.type != ARPHRD_ETHER || isVirtualLinkKind(link.kind)) continue;
+        if (link.has_perm_addr) addOui(link.perm_addr, entries);
+        else if (link.has_addr) addOui(link.addr, entries);
+    }
+}
+
+Hash128 hashComponent(int component, const std::vector<std::string>& entries) {
+    Fnv128 fnv;
+    fnv.add("vmd-hwfp/" + std::to_string(HW_FINGERPRINT_VERSION) + "/" + fingerprint_component_names[component] + "\n");
+    for (const auto& entry : entries) {
+        fnv.add(entry);
+        fnv.add("\n");
+    }
+    return fnv.digest();
+}
+
+} // namespace
+
+void computeHardwareFingerprint(HardwareFingerprint& fingerprint) {
+    for (auto& entries : fingerprint.entries) entries.clear();
+    const KernelSnapshot* snapshot = kernelSnapshot();
+    addCpuid(fingerprint.entries[FP_CPUID]);
+    addDmi(snapshot, fingerprint.entries[FP_DMI]);
+    addAcpi(snapshot, fingerprint.entries[FP_ACPI]);
+    addPci(snapshot, fingerprint.entries[FP_PCI]);
+    addNics(snapshot, fingerprint.entries[FP_NIC]);
+
+    Fnv128 id;
+    id.add("vmd-hwfp/" + std::to_string(HW_FINGERPRINT_VERSION) + "\n");
+    for (int component = 0; component < FP_COMPONENTS; component++) {
+        // Sets, not lists: enumeration order and duplicate devices do not change the model
+        auto& entries = fingerprint.entries[component];
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+        fingerprint.components[component] = hashComponent(component, entries);
+        id.add(fingerprint.components[component]);
+    }
+    fingerprint.id = id.digest();
+    fingerprint.version = HW_FINGERPRINT_VERSION;
+}
+
+uint32_t diffFingerprints(const HardwareFingerprint& a, const HardwareFingerprint& b) {
+    uint32_t differs = a.version != b.version ? (1u << FP_COMPONENTS) - 1 : 0;
+    for (int component = 0; component < FP_COMPONENTS; component++)
+        differs |= static_cast<uint32_t>(a.components[component] != b.components[component]) << component;
+    return differs;
+}
+
+std::string formatHash128(const Hash128& hash) {
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(hash.hi), static_cast<unsigned long long>(hash.lo));
+    return buf;
+}
+
+std::string formatFingerprint(const HardwareFingerprint& fingerprint) {
+    return "v" + std::to_string(fingerprint.version) + ":" + formatHash128(fingerprint.id);
+}
+
+void printHardwareFingerprint(const HardwareFingerprint& fingerprint) {
+    std::cout << "Hardware fingerprint: " << formatFingerprint(fingerprint) << std::endl;
+    for (int component = 0; component < FP_COMPONENTS; component++) {
+        const auto& entries = fingerprint.entries[component];
+        std::cout << "  " << fingerprint_component_names[component] << ": " << formatHash128(fingerprint.components[component])
+                  << " (" << entries.size() << (entries.size() == 1 ? " entry" : " entries") << ")" << std::endl;
+        for (const auto& entry : entries) std::cout << "    " << entry << std::endl;
+    }
+    if (fingerprint.entries[FP_ACPI].empty() && geteuid() != 0)
+        std::cout << "  (ACPI tables need root or snapshot_module; compare only with fingerprints taken the same way)" << std::endl;
+}
@@ -0,0 +1,77 @@
+#ifndef HW_FINGERPRINT_H
+#define HW_FINGERPRINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Bumped whenever a component's canonical form changes; fingerprints of different versions never compare equal
+#define HW_FINGERPRINT_VERSION 1
+
+enum FingerprintComponent {
+    FP_CPUID,   // CPU vendor and hypervisor leaves (MIDR and hypervisor discovery on ARM)
+    FP_DMI,     // model strings; serials, UUIDs and BIOS versions left out
+    FP_ACPI,    // signature, OEM ID, OEM table ID and creator of each table; revisions left out
+    FP_PCI,     // set of vendor:device, subsystem and class triples; slots left out
+    FP_NIC,     // set of NIC OUIs; the rest of each MAC left out
+    FP_COMPONENTS
+};
+
+extern const char* const fingerprint_component_names[FP_COMPONENTS];
+
+struct Hash128 {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+};
+
+// Constant time: no early exit on the first differing word
+inline bool operator==(const Hash128& a, const Hash128& b) { return ((a.hi ^ b.hi) | (a.lo ^ b.lo)) == 0; }
+inline bool operator!=(const Hash128& a, const Hash128& b) { return !(a == b); }
+
+/**
+    Canonical identity of the virtual hardware model a guest sees. Each
+    component is a sorted, de-duplicated set of "key=value" entries with
+    volatile fields (serials, MACs, revisions, bus addresses) left out, hashed
+    with FNV-1a 128; id hashes the version and every component hash. Equal
+    ids mean the same platform, and diffFingerprints says which components
+    moved. A component that could not be read (ACPI tables need root without
+    snapshot_module) hashes as empty, so compare scans taken the same way.
+ */
+struct HardwareFingerprint {
+    uint32_t version = 0;                   // 0 until computed
+    Hash128 id;
+    Hash128 components[FP_COMPONENTS];
+    std::vector<std::string> entries[FP_COMPONENTS];
+};
+
+// Fingerprint of the last scan
+extern HardwareFingerprint hardware_fingerprint;
+
+/**
+    Computes the fingerprint from the kernel snapshot when one is loaded,
+    otherwise from sysfs, one rtnetlink dump and CPUID: a few dozen small
+    reads, cheap enough to run after every scan.
+ */
+void computeHardwareFingerprint(HardwareFingerprint& fingerprint);
+
+// Bit n set when component n differs; always compares every component
+uint32_t diffFingerprints(const HardwareFingerprint& a, const HardwareFingerprint& b);
+
+// "v1:" followed by 32 hex digits
+std::string formatFingerprint(const HardwareFingerprint& fingerprint);
+std::string formatHash128(const Hash128& hash);
+
+// The id, each component's hash and its canonical entries
+void printHardwareFingerprint(const HardwareFingerprint& fingerprint);
+
+// The id is already uniformly distributed, so either half is a good bucket hash
+namespace std {
+template <>
+struct hash<Hash128> {
+    size_t operator()(const Hash128& h) const noexcept { return static_cast<size_t>(h.lo); }
+};
+}
+
+#endif // HW_FINGERPRINT_H
@@ -0,0 +1,287 @@
+/**
+    Scans installer and live images for virtualization artifacts without
+    mounting or extracting them: ISO9660 and SquashFS are read straight from
+    an mmap of the image file, and only the inodes and blocks of the
+    configured paths are decompressed. Matching uses the same signature pack
+    as vm_detection.
+
+    Usage: image_scan [-j threads] [-c targets] [-p pack] image...
+
+    A targets file has one "<scan|exists> <path>" per line (# comments).
+    "scan" runs the signatures over a file, or every file of a directory;
+    "exists" reports the path itself, e.g. a guest agent binary. Paths are
+    inside the root filesystem (every SquashFS layer of an ISO, or a bare
+    SquashFS image); an "iso:" prefix addresses the ISO9660 tree instead.
+
+    Exit status: 0 clean, 1 artifacts found, 2 an image could not be read.
+ */
+#include "mapped_file.h"
+#include "iso9660.h"
+#include "squashfs.h"
+#include "sigpack.h"
+#include "file_reader.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+
+// Larger files are scanned up to this size
+static const size_t MAX_SCAN_BYTES = 16 << 20;
+
+struct ScanTarget {
+    bool exists_only = false;
+    bool iso_tree = false;       // "iso:" prefix
+    std::string path;
+};
+
+static const char* const default_targets =
+    "# Guest agents and tools\n"
+    "exists usr/bin/vmtoolsd\n"
+    "exists usr/bin/vmware-toolbox-cmd\n"
+    "exists usr/sbin/VBoxService\n"
+    "exists usr/bin/VBoxClient\n"
+    "exists usr/bin/qemu-ga\n"
+    "exists usr/sbin/qemu-ga\n"
+    "exists usr/sbin/hv_kvp_daemon\n"
+    "exists usr/sbin/spice-vdagentd\n"
+    "exists usr/sbin/xe-daemon\n"
+    "# Module lists\n"
+    "scan etc/modules\n"
+    "scan etc/modules-load.d\n"
+    "scan etc/initramfs-tools/modules\n"
+    "# udev rules\n"
+    "scan etc/udev/rules.d\n"
+    "scan usr/lib/udev/rules.d\n"
+    "# DMI-dependent configuration\n"
+    "scan etc/X11/xorg.conf.d\n"
+    "scan etc/cloud/cloud.cfg\n"
+    "scan etc/default/grub\n"
+    "# Boot configuration on the ISO itself\n"
+    "scan iso:boot/grub/grub.cfg\n"
+    "scan iso:isolinux/txt.cfg\n";
+
+static bool parseTargets(std::string_view text, std::vector<ScanTarget>& targets, std::string& error) {
+    LineScanner lines(text);
+    std::string_view line;
+    int number = 0;
+    while (lines.next(line)) {
+        number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        FieldScanner fields(line);
+        std::string_view mode, path;
+        if (!fields.next(mode) || !fields.next(path) || (mode != "scan" && mode != "exists")) {
+            error = "line " + std::to_string(number) + ": expected \"scan <path>\" or \"exists <path>\"";
+            return false;
+        }
+        ScanTarget& target = targets.emplace_back();
+        target.exists_only = mode == "exists";
+        if (path.substr(0, 4) == "iso:") {
+            target.iso_tree = true;
+            path.remove_prefix(4);
+        }
+        while (!path.empty() && path[0] == '/') path.remove_prefix(1);
+        target.path = std::string(path);
+    }
+    return true;
+}
+
+// Per-image scan; all output goes to out so parallel images do not interleave
+class ImageScanner {
+public:
+    ImageScanner(const std::vector<ScanTarget>& targets, std::ostringstream& out) : targets_(targets), out_(out) {}
+
+    bool run(const std::string& path);
+    size_t findings() const { return findings_; }
+
+private:
+    void scanLayer(const std::string& label, std::string_view image);
+    void scanIsoTargets();
+    void scanContents(const std::string& where, std::string_view data);
+    void report(const std::string& where, const std::string& what);
+
+    const std::vector<ScanTarget>& targets_;
+    std::ostringstream& out_;
+    std::shared_ptr<const SignaturePack> signatures_ = currentSignatures();
+    IsoImage iso_;
+    size_t findings_ = 0;
+};
+
+void ImageScanner::report(const std::string& where, const std::string& what) {
+    out_ << "  " << where << ": " << what << "\n";
+    findings_++;
+}
+
+void ImageScanner::scanContents(const std::string& where, std::string_view data) {
+    std::set<const char*> found;
+    signatures_->scan(SIG_GENERAL_ICASE, data, [&found](const char* signature) { found.insert(signature); });
+    for (const char* signature : found) report(where, std::string("signature \"") + signature + "\"");
+}
+
+void ImageScanner::scanLayer(const std::string& label, std::string_view image) {
+    SquashImage squash;
+    std::string error;
+    if (!squash.open(image, error)) {
+        out_ << label << ": skipped (" << error << ")\n";
+        return;
+    }
+    out_ << label << " (SquashFS " << squash.compressionName() << ", " << squash.superblock().inode_count << " inodes)\n";
+
+    std::string contents;
+    std::vector<SquashDirEntry> entries;
+    for (const auto& target : targets_) {
+        if (target.iso_tree) continue;
+        SquashInode inode;
+        if (!squash.lookup(target.path, inode)) continue;
+
+        std::string where = label + ":/" + target.path;
+        if (target.exists_only) {
+            report(where, "present");
+            continue;
+        }
+        if (inode.isFile()) {
+            if (squash.readFile(inode, MAX_SCAN_BYTES, contents)) scanContents(where, contents);
+            else out_ << "  " << where << ": " << squash.error() << "\n";
+            continue;
+        }
+        if (!inode.isDirectory() || !squash.listDirectory(inode, entries)) continue;
+        // Copy: reading files reuses the reader's buffers
+        std::vector<SquashDirEntry> files = entries;
+        for (const auto& entry : files) {
+            SquashInode file;
+            if (!squash.readInode(entry.inode_ref, file) || !file.isFile()) continue;
+            if (squash.readFile(file, MAX_SCAN_BYTES, contents)) scanContents(where + "/" + entry.name, contents);
+        }
+    }
+}
+
+void ImageScanner::scanIsoTargets() {
+    std::vector<IsoEntry> entries;
+    for (const auto& target : targets_) {
+        if (!target.iso_tree) continue;
+        IsoEntry entry;
+        if (!iso_.find(target.path, entry)) continue;
+
+        std::string where = "iso:/" + target.path;
+        if (target.exists_only) report(where, "present");
+        else if (!entry.directory) scanContents(where, iso_.contents(entry).substr(0, MAX_SCAN_BYTES));
+        else if (iso_.list(entry, entries)) {
+            for (const auto& file : entries) {
+                if (!file.directory) scanContents(where + "/" + file.name, iso_.contents(file).substr(0, MAX_SCAN_BYTES));
+            }
+        }
+    }
+}
+
+bool ImageScanner::run(const std::string& path) {
+    MappedFile file;
+    std::string error;
+    if (!file.open(path.c_str(), error)) {
+        out_ << "===== " << path << " =====\n" << "error: " << error << "\n";
+        return false;
+    }
+    std::string_view image = file.data();
+
+    // A bare SquashFS image is the root filesystem itself
+    if (image.size() >= 4 && memcmp(image.data(), "hsqs", 4) == 0) {
+        out_ << "===== " << path << " =====\n";
+        scanLayer("squashfs", image);
+        return true;
+    }
+    if (!iso_.open(image, error)) {
+        out_ << "===== " << path << " =====\n" << "error: " << error << "\n";
+        return false;
+    }
+    out_ << "===== " << path << " (ISO9660 \"" << iso_.volumeId() << "\""
+         << (iso_.hasRockRidge() ? ", Rock Ridge" : "") << ") =====\n";
+
+    scanIsoTargets();
+    // Every SquashFS layer on the medium (casper, live, LiveOS, ...)
+    iso_.walk([&](const std::string& entry_path, const IsoEntry& entry) {
+        if (entry.directory || entry.size < SQUASHFS_SUPERBLOCK_SIZE) return;
+        std::string_view data = iso_.contents(entry);
+        if (data.size() >= 4 && memcmp(data.data(), "hsqs", 4) == 0) scanLayer(entry_path, data);
+    });
+    return true;
+}
+
+static void usage() {
+    std::cerr << "Usage: image_scan [-j threads] [-c targets] [-p pack] image..." << std::endl;
+    std::cerr << "       image_scan -l    print the default targets as a starting point" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* targets_path = nullptr;
+    int option;
+    while ((option = getopt(argc, argv, "j:c:p:l")) != -1) {
+        switch (option) {
+            case 'j': threads = std::max(1, atoi(optarg)); break;
+            case 'c': targets_path = optarg; break;
+            case 'p': signature_pack_path = optarg; break;
+            case 'l':
+                std::cout << default_targets;
+                return 0;
+            default:
+                usage();
+                return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 2;
+    }
+
+    std::vector<ScanTarget> targets;
+    std::string error;
+    FileReader targets_file;
+    if (targets_path && !targets_file.read(targets_path)) {
+        std::cerr << "Cannot read " << targets_path << std::endl;
+        return 2;
+    }
+    if (!parseTargets(targets_path ? targets_file.data() : std::string_view(default_targets), targets, error)) {
+        std::cerr << (targets_path ? targets_path : "default targets") << ": " << error << std::endl;
+        return 2;
+    }
+    loadSignatures();
+
+    // One image per worker; reports are printed in argument order
+    std::vector<std::string> images(argv + optind, argv + argc);
+    std::vector<std::ostringstream> reports(images.size());
+    std::vector<size_t> findings(images.size());
+    std::vector<char> failed(images.size());
+    std::atomic<size_t> next{0};
+
+    auto start = std::chrono::steady_clock::now();
+    auto worker = [&]() {
+        for (size_t i = next++; i < images.size(); i = next++) {
+            ImageScanner scanner(targets, reports[i]);
+            failed[i] = !scanner.run(images[i]);
+            findings[i] = scanner.findings();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < std::min<size_t>(threads, images.size()); t++) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    size_t total = 0;
+    bool any_failed = false;
+    for (size_t i = 0; i < images.size(); i++) {
+        std::cout << reports[i].str();
+        total += findings[i];
+        any_failed = any_failed || failed[i];
+    }
+    std::cout << "\nScanned " << images.size() << " images in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms: "
+              << total << " artifacts found." << std::endl;
+    if (any_failed) return 2;
+    return total > 0 ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+#include "iso9660.h"
+#include <cstring>
+#include <strings.h>
+
+static const unsigned char* bytes(std::string_view image, uint64_t offset) {
+    return reinterpret_cast<const unsigned char*>(image.data()) + offset;
+}
+
+bool IsoImage::open(std::string_view image, std::string& error) {
+    image_ = image;
+    rock_ridge_ = false;
+    susp_skip_ = 0;
+
+    // Volume descriptors are 2048-byte sectors from 16 up to the terminator (type 255)
+    for (uint64_t sector = ISO_DESCRIPTOR_START;; sector++) {
+        uint64_t offset = sector * ISO_SECTOR_SIZE;
+        if (offset + ISO_SECTOR_SIZE > image.size()) {
+            error = "no primary volume descriptor";
+            return false;
+        }
+        const unsigned char* vd = bytes(image, offset);
+        if (memcmp(vd + 1, "CD001", 5) != 0) {
+            error = "not an ISO9660 image";
+            return false;
+        }
+        if (vd[0] == 255) {
+            error = "no primary volume descriptor";
+            return false;
+        }
+        if (vd[0] != 1) continue;
+
+        pvd_offset_ = offset;
+        block_size_ = uint32_t(vd[128]) | (uint32_t(vd[129]) << 8);
+        volume_id_.assign(reinterpret_cast<const char*>(vd + 40), 32);
+        volume_id_.erase(volume_id_.find_last_not_of(' ') + 1);
+        if (block_size_ != 512 && block_size_ != 1024 && block_size_ != 2048) {
+            error = "unsupported logical block size";
+            return false;
+        }
+        // The root record is embedded at offset 156; its name is a single 0x00
+        if (!parseRecord(vd + 156, offset + 156, root_) || !root_.directory) {
+            error = "bad root directory record";
+            return false;
+        }
+        break;
+    }
+
+    // SUSP is announced by an SP entry in the root's "." record
+    std::string_view root_dir = contents(root_);
+    if (root_dir.size() >= 34) {
+        const unsigned char* dot = reinterpret_cast<const unsigned char*>(root_dir.data());
+        size_t use = 33 + dot[ISO_DR_NAME_LEN] + ((dot[ISO_DR_NAME_LEN] & 1) ? 0 : 1);
+        if (dot[0] >= use + 7 && dot[0] <= root_dir.size() && dot[use] == 'S' && dot[use + 1] == 'P' && dot[use + 4] == 0xbe && dot[use + 5] == 0xef) {
+            rock_ridge_ = true;
+            susp_skip_ = dot[use + 6];
+        }
+    }
+    return true;
+}
+
+bool IsoImage::parseRecord(const unsigned char* record, uint64_t offset, IsoEntry& entry) const {
+    uint8_t length = record[ISO_DR_LENGTH];
+    if (length < 34) return false;
+    uint8_t name_len = record[ISO_DR_NAME_LEN];
+    if (ISO_DR_NAME + name_len > length) return false;
+
+    entry = IsoEntry();
+    entry.extent = isoLe32(record + ISO_DR_EXTENT);
+    entry.size = isoLe32(record + ISO_DR_SIZE);
+    entry.directory = (record[ISO_DR_FLAGS] & ISO_FLAG_DIRECTORY) != 0;
+    entry.record_offset = offset;
+    entry.record_length = length;
+
+    std::string_view iso_name(reinterpret_cast<const char*>(record + ISO_DR_NAME), name_len);
+    // Rock Ridge NM entries, possibly split with the CONTINUE flag
+    if (rock_ridge_) {
+        size_t pos = ISO_DR_NAME + name_len + ((name_len & 1) ? 0 : 1) + susp_skip_;
+        std::string rr_name;
+        bool found = false;
+        while (pos + 4 <= length) {
+            uint8_t entry_len = record[pos + 2];
+            if (entry_len < 4 || pos + entry_len > length) break;
+            if (record[pos] == 'N' && record[pos + 1] == 'M' && entry_len >= 5) {
+                rr_name.append(reinterpret_cast<const char*>(record + pos + 5), entry_len - 5);
+                found = true;
+            }
+            pos += entry_len;
+        }
+        if (found) {
+            entry.name = rr_name;
+            return true;
+        }
+    }
+    size_t version = iso_name.find(';');
+    if (version != std::string_view::npos) iso_name = iso_name.substr(0, version);
+    if (!iso_name.empty() && iso_name.back() == '.') iso_name.remove_suffix(1);
+    entry.name = std::string(iso_name);
+    return true;
+}
+
+bool IsoImage::list(const IsoEntry& dir, std::vector<IsoEntry>& entries) const {
+    entries.clear();
+    std::string_view data = contents(dir);
+    if (!dir.directory || data.empty()) return false;
+    uint64_t base = static_cast<uint64_t>(dir.extent) * block_size_;
+
+    size_t pos = 0;
+    bool continuing = false;
+    while (pos < data.size()) {
+        const unsigned char* record = reinterpret_cast<const unsigned char*>(data.data()) + pos;
+        // Records never cross a sector; a zero length pads to the next one
+        if (record[0] == 0) {
+            pos = (pos / ISO_SECTOR_SIZE + 1) * ISO_SECTOR_SIZE;
+            continue;
+        }
+        // The fixed part, up to the name length byte and the first name byte, must be inside the record
+        if (record[0] < 34 || pos + record[0] > data.size()) return false;
+        uint8_t name_len = record[ISO_DR_NAME_LEN];
+        bool self_or_parent = name_len == 1 && (record[ISO_DR_NAME] == 0 || record[ISO_DR_NAME] == 1);
+
+        IsoEntry entry;
+        if (!self_or_parent && parseRecord(record, base + pos, entry)) {
+            // Files over 4 GiB are split into sections that follow each other
+            if (continuing && !entries.empty()) entries.back().size += entry.size;
+            else entries.push_back(std::move(entry));
+        }
+        continuing = (record[ISO_DR_FLAGS] & ISO_FLAG_MULTI_EXTENT) != 0;
+        pos += record[0];
+    }
+    return true;
+}
+
+bool IsoImage::find(std::string_view path, IsoEntry& entry) const {
+    IsoEntry current = root_;
+    std::vector<IsoEntry> entries;
+    while (!path.empty()) {
+        size_t slash = path.find('/');
+        std::string_view part = path.substr(0, slash);
+        path = slash == std::string_view::npos ? std::string_view() : path.substr(slash + 1);
+        if (part.empty() || part == ".") continue;
+        if (!list(current, entries)) return false;
+
+        const IsoEntry* match = nullptr;
+        for (const auto& candidate : entries) {
+            if (candidate.name == part) {
+                match = &candidate;
+                break;
+            }
+        }
+        for (size_t i = 0; !match && i < entries.size(); i++) {
+            if (entries[i].name.size() == part.size() &&
+                strncasecmp(entries[i].name.data(), part.data(), part.size()) == 0)
+                match = &entries[i];
+        }
+        if (!match) return false;
+        current = *match;
+    }
+    entry = current;
+    return true;
+}
+
+std::string_view IsoImage::contents(const IsoEntry& file) const {
+    uint64_t start = static_cast<uint64_t>(file.extent) * block_size_;
+    if (start > image_.size() || file.size > image_.size() - start) return std::string_view();
+    return image_.substr(start, file.size);
+}
+
+void IsoImage::walk(const std::function<void(const std::string&, const IsoEntry&)>& visit) const {
+    walkDirectory(root_, std::string(), 0, visit);
+}
+
+void IsoImage::walkDirectory(const IsoEntry& dir, const std::string& prefix, int depth,
+                             const std::function<void(const std::string&, const IsoEntry&)>& visit) const {
+    // ECMA-119 allows 8 levels; Rock Ridge relocation can go deeper, a loop cannot
+    if (depth > 64) return;
+    std::vector<IsoEntry> entries;
+    if (!list(dir, entries)) return;
+    for (const auto& entry : entries) {
+        std::string path = prefix.empty() ? entry.name : prefix + "/" + entry.name;
+        visit(path, entry);
+        if (entry.directory) walkDirectory(entry, path, depth + 1, visit);
+    }
+}
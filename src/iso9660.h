@@ -0,0 +1,81 @@
+#ifndef ISO9660_H
+#define ISO9660_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define ISO_SECTOR_SIZE 2048
+#define ISO_DESCRIPTOR_START 16          // first volume descriptor sector
+
+// Offsets inside a directory record (ECMA-119 9.1)
+#define ISO_DR_LENGTH 0
+#define ISO_DR_EXTENT 2                  // both-endian u32
+#define ISO_DR_SIZE 10                   // both-endian u32
+#define ISO_DR_FLAGS 25
+#define ISO_DR_NAME_LEN 32
+#define ISO_DR_NAME 33
+
+#define ISO_FLAG_DIRECTORY 0x02
+#define ISO_FLAG_MULTI_EXTENT 0x80
+
+// One file or directory as listed in its parent
+struct IsoEntry {
+    std::string name;            // Rock Ridge name when present, else the ISO name without ";1"
+    uint32_t extent = 0;         // first logical block
+    uint64_t size = 0;           // bytes, summed over multi-extent sections
+    bool directory = false;
+    uint64_t record_offset = 0;  // image offset of the (first) directory record
+    uint8_t record_length = 0;
+};
+
+/**
+    ISO9660 reader over an image held in memory (normally a MappedFile).
+    Nothing is copied: directories are parsed on demand straight from the
+    image and file contents are views into it. Rock Ridge NM names are used
+    when the image carries SUSP; Joliet is not needed on Linux media.
+ */
+class IsoImage {
+public:
+    bool open(std::string_view image, std::string& error);
+
+    const IsoEntry& root() const { return root_; }
+    uint32_t blockSize() const { return block_size_; }
+    bool hasRockRidge() const { return rock_ridge_; }
+    // Bytes between a record's name and its SUSP entries (SP LEN_SKP)
+    uint8_t suspSkip() const { return susp_skip_; }
+    const std::string& volumeId() const { return volume_id_; }
+    // Image offset of the primary volume descriptor
+    uint64_t pvdOffset() const { return pvd_offset_; }
+
+    bool list(const IsoEntry& dir, std::vector<IsoEntry>& entries) const;
+    // "casper/filesystem.squashfs"; exact match first, then ignoring case
+    bool find(std::string_view path, IsoEntry& entry) const;
+    // Empty if the extent lies outside the image
+    std::string_view contents(const IsoEntry& file) const;
+
+    // Every entry below the root, depth first, with its path relative to the root
+    void walk(const std::function<void(const std::string&, const IsoEntry&)>& visit) const;
+
+private:
+    bool parseRecord(const unsigned char* record, uint64_t offset, IsoEntry& entry) const;
+    void walkDirectory(const IsoEntry& dir, const std::string& prefix, int depth,
+                       const std::function<void(const std::string&, const IsoEntry&)>& visit) const;
+
+    std::string_view image_;
+    uint32_t block_size_ = ISO_SECTOR_SIZE;
+    uint64_t pvd_offset_ = 0;
+    IsoEntry root_;
+    bool rock_ridge_ = false;
+    uint8_t susp_skip_ = 0;
+    std::string volume_id_;
+};
+
+// Little-endian half of an ISO9660 both-endian field
+inline uint32_t isoLe32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+#endif // ISO9660_H
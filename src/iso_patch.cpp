@@ -0,0 +1,713 @@
+/**
+    Patches an installer ISO in place instead of extracting and rebuilding
+    it. Host files for the root filesystem are written as a new SquashFS
+    layer straight into the free space at the end of the image, and files
+    on the ISO itself (grub.cfg, ...) are appended beside it. Then only the
+    directory records, path table entries, El Torito catalog entries and
+    volume size that change are rewritten. The original SquashFS layers are
+    never touched, so time and scratch space follow the size of the change.
+
+    Usage: iso_patch [-o output.iso] [-L layer] [-z gzip|xz] [-u uid:gid]
+                     [-a host=root_path]... [-f host=iso_path]... image.iso
+
+    -a adds a file or tree to the layer at root_path, -f adds or replaces a
+    file on the ISO. -L names the layer on the ISO (default
+    casper/virtualdetect.squashfs); classic casper mounts every SquashFS in
+    casper/, layered media also need it named in layerfs-path, which a
+    patched grub.cfg can do. With -o the image is cloned first (a reflink
+    where the filesystem supports it) and the clone is patched.
+
+    Writes go to the appended area first and are synced before any existing
+    sector is rewritten, so an interrupted run leaves the old tree intact.
+ */
+#include "mapped_file.h"
+#include "iso9660.h"
+#include "squashfs_writer.h"
+#include "file_reader.h"
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+// Path table and volume descriptor offsets (ECMA-119 8.4)
+#define ISO_PVD_VOLUME_SIZE 80
+#define ISO_PVD_PATH_TABLE_SIZE 132
+#define ISO_PVD_L_PATH_TABLE 140
+#define ISO_PVD_M_PATH_TABLE 148
+#define ISO_PVD_ROOT_RECORD 156
+#define ELTORITO_SECTOR_SIZE 2048
+
+static void putBoth32(char* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = static_cast<char>(value >> (8 * i));
+        p[7 - i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static void putLe32(char* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<char>(value >> (8 * i));
+}
+
+static uint32_t loadBe32(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | u[3];
+}
+
+static uint32_t loadLe32(const char* p) {
+    return isoLe32(reinterpret_cast<const unsigned char*>(p));
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t unit) {
+    return (value + unit - 1) / unit * unit;
+}
+
+// One file to place on the ISO: already written at extent, or content to append
+struct Placement {
+    std::string iso_path;
+    uint32_t extent = 0;
+    uint64_t size = 0;
+    std::string content;         // empty for the layer, which is streamed to disk
+};
+
+class IsoPatcher {
+public:
+    bool open(const std::string& path, std::string& error);
+    // Where the next appended file starts, in logical blocks
+    uint32_t nextExtent() const { return end_ / block_size_; }
+    uint64_t appendOffset() const { return end_; }
+    int fd() const { return fd_; }
+
+    // A file can go to iso_path: it is a file or its parent directory exists
+    bool checkIsoPath(const std::string& iso_path, std::string& error) const;
+    void reserve(uint64_t bytes) { end_ = alignUp(end_ + bytes, block_size_); }
+    void append(Placement& file);
+    bool place(Placement& file, std::string& error);
+    bool commit(std::string& error);
+    // Restores the sectors patched in place, then drops everything appended so far (in-place patching only)
+    void rollback();
+
+    size_t recordsRewritten() const { return records_; }
+    size_t directoriesMoved() const { return moved_; }
+    size_t bootEntriesPatched() const { return boot_entries_; }
+
+private:
+    struct Write {
+        uint64_t offset;
+        std::string data;
+    };
+    struct Insertion {
+        IsoEntry dir;
+        int depth = 0;
+        std::vector<Placement*> files;
+    };
+
+    std::string read(uint64_t offset, size_t len) const;
+    void write(uint64_t offset, std::string data) { writes_.push_back({offset, std::move(data)}); }
+    void patchExtent(uint64_t record_offset, uint32_t extent, uint64_t size);
+    void replaceInJoliet(const IsoEntry& old_entry, const std::string& name, const Placement& file);
+    void patchBootCatalog(const IsoEntry& old_entry, Placement& file);
+    std::string makeRecord(const std::string& name, const Placement& file, const std::vector<std::string>& siblings) const;
+    bool insertRecords(Insertion& insertion, std::string& error);
+    void relocatePathTables(uint32_t old_extent, uint32_t new_extent);
+    bool pwriteAll(const Write& w, std::string& error);
+
+    int fd_ = -1;
+    MappedFile map_;
+    std::string_view image_;
+    IsoImage iso_;
+    uint32_t block_size_ = ISO_SECTOR_SIZE;
+    uint64_t original_size_ = 0;
+    uint64_t end_ = 0;
+    std::vector<uint64_t> descriptors_;          // primary and supplementary volume descriptors
+    std::vector<uint64_t> boot_entries_at_;      // El Torito entries with a load RBA
+    std::map<std::string, Insertion> insertions_;
+    std::vector<Write> writes_;
+    std::vector<Write> journal_;                 // original bytes under the in-place writes, once any has started
+    size_t records_ = 0, moved_ = 0, boot_entries_ = 0;
+};
+
+bool IsoPatcher::open(const std::string& path, std::string& error) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        error = std::string("cannot open: ") + strerror(errno);
+        return false;
+    }
+    if (!map_.open(path.c_str(), error)) return false;
+    image_ = map_.data();
+    if (!iso_.open(image_, error)) return false;
+    block_size_ = iso_.blockSize();
+    original_size_ = image_.size();
+
+    // Append after both the volume and anything the file carries beyond it
+    uint64_t volume = static_cast<uint64_t>(loadLe32(image_.data() + iso_.pvdOffset() + ISO_PVD_VOLUME_SIZE)) * block_size_;
+    end_ = alignUp(std::max<uint64_t>(volume, image_.size()), ELTORITO_SECTOR_SIZE);
+
+    for (uint64_t offset = ISO_DESCRIPTOR_START * ISO_SECTOR_SIZE; offset + ISO_SECTOR_SIZE <= image_.size(); offset += ISO_SECTOR_SIZE) {
+        const char* vd = image_.data() + offset;
+        if (memcmp(vd + 1, "CD001", 5) != 0 || static_cast<uint8_t>(vd[0]) == 255) break;
+        if (vd[0] == 1 || vd[0] == 2) descriptors_.push_back(offset);
+        if (vd[0] != 0 || memcmp(vd + 7, "EL TORITO SPECIFICATION", 23) != 0) continue;
+
+        // Boot catalog: validation entry, default entry, then sections of entries
+        uint64_t catalog = static_cast<uint64_t>(loadLe32(vd + 71)) * ELTORITO_SECTOR_SIZE;
+        if (catalog + ELTORITO_SECTOR_SIZE > image_.size()) continue;
+        const char* c = image_.data() + catalog;
+        boot_entries_at_.push_back(catalog + 32);
+        for (size_t i = 2; i < ELTORITO_SECTOR_SIZE / 32;) {
+            uint8_t header = c[i * 32];
+            if (header != 0x90 && header != 0x91) break;
+            size_t count = static_cast<uint8_t>(c[i * 32 + 2]) | (static_cast<uint8_t>(c[i * 32 + 3]) << 8);
+            i++;
+            for (size_t k = 0; k < count && i < ELTORITO_SECTOR_SIZE / 32; k++) {
+                boot_entries_at_.push_back(catalog + i * 32);
+                i++;
+                while (i < ELTORITO_SECTOR_SIZE / 32 && static_cast<uint8_t>(c[i * 32]) == 0x44) i++;
+            }
+            if (header == 0x91) break;
+        }
+    }
+    return true;
+}
+
+std::string IsoPatcher::read(uint64_t offset, size_t len) const {
+    // The image as it will be once every pending write has landed
+    std::string out(len, '\0');
+    if (offset < image_.size()) {
+        size_t n = std::min<uint64_t>(len, image_.size() - offset);
+        memcpy(&out[0], image_.data() + offset, n);
+    }
+    for (const auto& w : writes_) {
+        uint64_t start = std::max(offset, w.offset);
+        uint64_t end = std::min(offset + len, w.offset + w.data.size());
+        if (start < end) memcpy(&out[start - offset], w.data.data() + (start - w.offset), end - start);
+    }
+    return out;
+}
+
+void IsoPatcher::patchExtent(uint64_t record_offset, uint32_t extent, uint64_t size) {
+    std::string record = read(record_offset, 18);
+    putBoth32(&record[ISO_DR_EXTENT], extent);
+    putBoth32(&record[ISO_DR_SIZE], size);
+    write(record_offset + ISO_DR_EXTENT, record.substr(ISO_DR_EXTENT));
+    records_++;
+}
+
+void IsoPatcher::append(Placement& file) {
+    file.extent = nextExtent();
+    file.size = file.content.size();
+    reserve(file.size);
+}
+
+bool IsoPatcher::checkIsoPath(const std::string& iso_path, std::string& error) const {
+    IsoEntry entry;
+    if (iso_.find(iso_path, entry)) {
+        if (entry.directory) error = iso_path + " is a directory on the ISO";
+        return !entry.directory;
+    }
+    size_t slash = iso_path.rfind('/');
+    std::string parent = slash == std::string::npos ? std::string() : iso_path.substr(0, slash);
+    if (!iso_.find(parent, entry) || !entry.directory) {
+        error = "no directory " + parent + " on the ISO";
+        return false;
+    }
+    return true;
+}
+
+bool IsoPatcher::place(Placement& file, std::string& error) {
+    if (!checkIsoPath(file.iso_path, error)) return false;
+    if (file.size > 0xffffffffu) {
+        error = file.iso_path + ": files over 4 GiB need multi-extent records, which are not written";
+        return false;
+    }
+    if (!file.content.empty()) write(static_cast<uint64_t>(file.extent) * block_size_, file.content);
+
+    size_t slash = file.iso_path.rfind('/');
+    std::string name = slash == std::string::npos ? file.iso_path : file.iso_path.substr(slash + 1);
+    IsoEntry existing;
+    if (iso_.find(file.iso_path, existing)) {
+        patchBootCatalog(existing, file);
+        patchExtent(existing.record_offset, file.extent, file.size);
+        replaceInJoliet(existing, name, file);
+        return true;
+    }
+
+    std::string parent = slash == std::string::npos ? std::string() : file.iso_path.substr(0, slash);
+    Insertion& insertion = insertions_[parent];
+    if (insertion.files.empty()) {
+        iso_.find(parent, insertion.dir);
+        insertion.depth = std::count(parent.begin(), parent.end(), '/') + (parent.empty() ? 0 : 1);
+    }
+    insertion.files.push_back(&file);
+    return true;
+}
+
+void IsoPatcher::patchBootCatalog(const IsoEntry& old_entry, Placement& file) {
+    uint64_t old_lba = static_cast<uint64_t>(old_entry.extent) * block_size_ / ELTORITO_SECTOR_SIZE;
+    uint32_t new_lba = static_cast<uint64_t>(file.extent) * block_size_ / ELTORITO_SECTOR_SIZE;
+    for (uint64_t at : boot_entries_at_) {
+        std::string entry = read(at, 32);
+        if (loadLe32(&entry[8]) != old_lba) continue;
+        putLe32(&entry[8], new_lba);
+        // A sector count that covered the whole old image (EFI) follows the new size
+        uint16_t count = static_cast<uint8_t>(entry[6]) | (static_cast<uint8_t>(entry[7]) << 8);
+        if (count == alignUp(old_entry.size, 512) / 512) {
+            count = std::min<uint64_t>(0xffff, alignUp(file.size, 512) / 512);
+            entry[6] = static_cast<char>(count);
+            entry[7] = static_cast<char>(count >> 8);
+        }
+        write(at, entry);
+        boot_entries_++;
+
+        // isolinux-style boot info table: PVD LBA, own LBA, length, checksum from byte 64
+        std::string_view old_content = iso_.contents(old_entry);
+        uint32_t pvd_lba = iso_.pvdOffset() / ELTORITO_SECTOR_SIZE;
+        if (file.content.size() >= 64 && old_content.size() >= 16 && loadLe32(old_content.data() + 8) == pvd_lba &&
+            loadLe32(old_content.data() + 12) == old_lba) {
+            uint32_t checksum = 0;
+            for (size_t i = 64; i + 4 <= file.content.size(); i += 4) checksum += loadLe32(&file.content[i]);
+            putLe32(&file.content[8], pvd_lba);
+            putLe32(&file.content[12], new_lba);
+            putLe32(&file.content[16], file.content.size());
+            putLe32(&file.content[20], checksum);
+            write(static_cast<uint64_t>(file.extent) * block_size_, file.content);
+        }
+    }
+}
+
+void IsoPatcher::replaceInJoliet(const IsoEntry& old_entry, const std::string& name, const Placement& file) {
+    // Joliet trees point at the same extents; match on extent and UCS-2 name
+    for (uint64_t vd : descriptors_) {
+        if (image_[vd] != 2) continue;
+        std::vector<std::pair<uint32_t, uint32_t>> pending;       // directory extent, size
+        const char* root = image_.data() + vd + ISO_PVD_ROOT_RECORD;
+        pending.emplace_back(loadLe32(root + ISO_DR_EXTENT), loadLe32(root + ISO_DR_SIZE));
+        std::set<uint32_t> seen;
+        while (!pending.empty()) {
+            auto [extent, size] = pending.back();
+            pending.pop_back();
+            uint64_t base = static_cast<uint64_t>(extent) * block_size_;
+            if (!seen.insert(extent).second || base + size > image_.size()) continue;
+            for (uint64_t pos = 0; pos < size;) {
+                const unsigned char* r = reinterpret_cast<const unsigned char*>(image_.data() + base + pos);
+                if (r[0] == 0) {
+                    pos = (pos / ISO_SECTOR_SIZE + 1) * ISO_SECTOR_SIZE;
+                    continue;
+                }
+                if (pos + r[0] > size || r[0] < 34) break;
+                uint8_t name_len = r[ISO_DR_NAME_LEN];
+                bool special = name_len == 1 && r[ISO_DR_NAME] <= 1;
+                if (!special && (r[ISO_DR_FLAGS] & ISO_FLAG_DIRECTORY)) {
+                    pending.emplace_back(isoLe32(r + ISO_DR_EXTENT), isoLe32(r + ISO_DR_SIZE));
+                } else if (!special && isoLe32(r + ISO_DR_EXTENT) == old_entry.extent) {
+                    std::string joliet;
+                    for (size_t i = 0; i + 1 < name_len; i += 2) {
+                        if (r[ISO_DR_NAME + i] == 0 && r[ISO_DR_NAME + i + 1] == ';') break;
+                        joliet += r[ISO_DR_NAME + i] ? '?' : static_cast<char>(r[ISO_DR_NAME + i + 1]);
+                    }
+                    if (strcasecmp(joliet.c_str(), name.c_str()) == 0) patchExtent(base + pos, file.extent, file.size);
+                }
+                pos += r[0];
+            }
+        }
+    }
+}
+
+std::string IsoPatcher::makeRecord(const std::string& name, const Placement& file, const std::vector<std::string>& siblings) const {
+    // ISO level 2 identifier; the Rock Ridge NM entry carries the real name
+    std::string id;
+    size_t dot = name.rfind('.');
+    for (size_t i = 0; i < name.size() && id.size() < 30; i++) {
+        char c = toupper(static_cast<unsigned char>(name[i]));
+        id += (isalnum(static_cast<unsigned char>(c)) || (c == '.' && i == dot)) ? c : '_';
+    }
+    std::string unique = id;
+    for (int n = 1; std::find(siblings.begin(), siblings.end(), unique + ";1") != siblings.end(); n++) {
+        std::string suffix = "~" + std::to_string(n);
+        unique = id.substr(0, std::min(id.size(), 30 - suffix.size())) + suffix;
+    }
+    unique += ";1";
+
+    std::string record(33, '\0');
+    putBoth32(&record[ISO_DR_EXTENT], file.extent);
+    putBoth32(&record[ISO_DR_SIZE], file.size);
+    time_t now = time(nullptr);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    const int date[] = {utc.tm_year, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, 0};
+    for (int i = 0; i < 7; i++) record[18 + i] = static_cast<char>(date[i]);
+    record[28] = 1;              // volume sequence number, both-endian 16
+    record[31] = 1;
+    record[ISO_DR_NAME_LEN] = static_cast<char>(unique.size());
+    record += unique;
+    if (unique.size() % 2 == 0) record += '\0';
+
+    if (iso_.hasRockRidge()) {
+        record.append(iso_.suspSkip(), '\0');
+        // PX: regular file, r--r--r--, one link, root-owned
+        std::string px("PX\x24\x01", 4);
+        px.append(32, '\0');
+        putBoth32(&px[4], S_IFREG | 0444);
+        putBoth32(&px[12], 1);
+        record += px;
+        std::string nm = name.substr(0, 250 - record.size());
+        record += "NM";
+        record += static_cast<char>(5 + nm.size());
+        record += '\x01';
+        record += '\0';
+        record += nm;
+    }
+    if (record.size() % 2) record += '\0';
+    record[ISO_DR_LENGTH] = static_cast<char>(record.size());
+    return record;
+}
+
+void IsoPatcher::relocatePathTables(uint32_t old_extent, uint32_t new_extent) {
+    const char* pvd = image_.data() + iso_.pvdOffset();
+    uint32_t size = loadLe32(pvd + ISO_PVD_PATH_TABLE_SIZE);
+    // L tables (little-endian) at 140/144, M tables (big-endian) at 148/152
+    for (int table = 0; table < 4; table++) {
+        bool big_endian = table >= 2;
+        const char* location = pvd + ISO_PVD_L_PATH_TABLE + 4 * table;
+        uint32_t lba = big_endian ? loadBe32(location) : loadLe32(location);
+        if (lba == 0) continue;
+        uint64_t base = static_cast<uint64_t>(lba) * block_size_;
+        std::string data = read(base, size);
+        for (size_t pos = 0; pos + 8 <= data.size();) {
+            uint8_t name_len = data[pos];
+            if (name_len == 0) break;
+            uint32_t extent = big_endian ? loadBe32(&data[pos + 2]) : loadLe32(&data[pos + 2]);
+            if (extent == old_extent) {
+                char bytes[4];
+                for (int i = 0; i < 4; i++) bytes[big_endian ? 3 - i : i] = static_cast<char>(new_extent >> (8 * i));
+                write(base + pos + 2, std::string(bytes, 4));
+            }
+            pos += 8 + name_len + (name_len & 1);
+        }
+    }
+}
+
+bool IsoPatcher::insertRecords(Insertion& insertion, std::string& error) {
+    IsoEntry& dir = insertion.dir;
+    uint64_t offset = static_cast<uint64_t>(dir.extent) * block_size_;
+    std::string data = read(offset, dir.size);
+
+    std::vector<std::string> records;
+    std::vector<std::string> ids;
+    for (size_t pos = 0; pos < data.size();) {
+        uint8_t length = data[pos];
+        if (length == 0) {
+            pos = (pos / ISO_SECTOR_SIZE + 1) * ISO_SECTOR_SIZE;
+            continue;
+        }
+        if (length < 34 || pos + length > data.size()) {
+            error = "corrupt directory";
+            return false;
+        }
+        records.push_back(data.substr(pos, length));
+        ids.push_back(data.substr(pos + ISO_DR_NAME, static_cast<uint8_t>(data[pos + ISO_DR_NAME_LEN])));
+        pos += length;
+    }
+    if (records.size() < 2) {
+        error = "directory without . and ..";
+        return false;
+    }
+
+    // Keep the identifier order ECMA-119 asks for
+    for (Placement* file : insertion.files) {
+        size_t slash = file->iso_path.rfind('/');
+        std::string record = makeRecord(file->iso_path.substr(slash == std::string::npos ? 0 : slash + 1), *file, ids);
+        std::string id = record.substr(ISO_DR_NAME, static_cast<uint8_t>(record[ISO_DR_NAME_LEN]));
+        size_t at = 2;
+        while (at < ids.size() && ids[at] < id) at++;
+        records.insert(records.begin() + at, record);
+        ids.insert(ids.begin() + at, id);
+        records_++;
+    }
+
+    // Records never cross a sector boundary
+    std::string packed;
+    for (const auto& record : records) {
+        if (packed.size() % ISO_SECTOR_SIZE + record.size() > ISO_SECTOR_SIZE) packed.resize(alignUp(packed.size(), ISO_SECTOR_SIZE), '\0');
+        packed += record;
+    }
+    packed.resize(alignUp(packed.size(), ISO_SECTOR_SIZE), '\0');
+
+    if (packed.size() <= dir.size) {
+        packed.resize(dir.size, '\0');
+        write(offset, std::move(packed));
+        return true;
+    }
+
+    // Full: move the directory to the end and repoint everything that names it
+    uint32_t old_extent = dir.extent;
+    uint32_t new_extent = nextExtent();
+    reserve(packed.size());
+    putBoth32(&packed[ISO_DR_EXTENT], new_extent);
+    putBoth32(&packed[ISO_DR_SIZE], packed.size());
+    bool is_root = dir.record_offset == iso_.pvdOffset() + ISO_PVD_ROOT_RECORD;
+    if (is_root) {
+        putBoth32(&packed[records[0].size() + ISO_DR_EXTENT], new_extent);
+        putBoth32(&packed[records[0].size() + ISO_DR_SIZE], packed.size());
+    }
+    patchExtent(dir.record_offset, new_extent, packed.size());
+
+    // Subdirectories' ".." records
+    for (size_t pos = 0; pos < packed.size();) {
+        const unsigned char* r = reinterpret_cast<const unsigned char*>(packed.data() + pos);
+        if (r[0] == 0) {
+            pos = (pos / ISO_SECTOR_SIZE + 1) * ISO_SECTOR_SIZE;
+            continue;
+        }
+        bool special = r[ISO_DR_NAME_LEN] == 1 && r[ISO_DR_NAME] <= 1;
+        if (!special && (r[ISO_DR_FLAGS] & ISO_FLAG_DIRECTORY)) {
+            uint64_t child = static_cast<uint64_t>(isoLe32(r + ISO_DR_EXTENT)) * block_size_;
+            uint8_t dot_length = read(child, 1)[0];
+            patchExtent(child + dot_length, new_extent, packed.size());
+        }
+        pos += r[0];
+    }
+    write(static_cast<uint64_t>(new_extent) * block_size_, std::move(packed));
+    relocatePathTables(old_extent, new_extent);
+    moved_++;
+    return true;
+}
+
+bool IsoPatcher::pwriteAll(const Write& w, std::string& error) {
+    const char* p = w.data.data();
+    size_t len = w.data.size();
+    uint64_t offset = w.offset;
+    while (len > 0) {
+        ssize_t n = pwrite(fd_, p, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            error = std::string("write failed: ") + strerror(errno);
+            return false;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool IsoPatcher::commit(std::string& error) {
+    // Deepest directories first: a parent repacks the records its children repointed
+    std::vector<Insertion*> order;
+    for (auto& entry : insertions_) order.push_back(&entry.second);
+    std::stable_sort(order.begin(), order.end(), [](const Insertion* a, const Insertion* b) { return a->depth > b->depth; });
+    for (Insertion* insertion : order) {
+        if (!insertRecords(*insertion, error)) return false;
+    }
+
+    for (uint64_t vd : descriptors_) {
+        std::string size(8, '\0');
+        putBoth32(&size[0], end_ / block_size_);
+        write(vd + ISO_PVD_VOLUME_SIZE, size);
+    }
+
+    // New extents first and synced, then the sectors that point at them
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            for (const auto& w : writes_) {
+                if (w.offset < original_size_)
+                    journal_.push_back({w.offset, std::string(image_.substr(w.offset, w.data.size()))});
+            }
+        }
+        for (const auto& w : writes_) {
+            bool appended = w.offset >= original_size_;
+            if (appended == (pass == 0) && !pwriteAll(w, error)) return false;
+        }
+        if (pass == 0 && ftruncate(fd_, end_) != 0) {
+            error = std::string("cannot extend the image: ") + strerror(errno);
+            return false;
+        }
+        if (fdatasync(fd_) != 0) {
+            error = std::string("sync failed: ") + strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+void IsoPatcher::rollback() {
+    if (fd_ < 0) return;
+    // Truncating while a patched record still points past original_size_ would leave it dangling
+    std::string error;
+    for (const auto& w : journal_) {
+        if (!pwriteAll(w, error)) break;
+    }
+    if (error.empty() && !journal_.empty() && fdatasync(fd_) != 0) error = std::string("sync failed: ") + strerror(errno);
+    if (!error.empty()) {
+        std::cerr << "Error: could not restore the patched sectors (" << error << "); the image is partially patched" << std::endl;
+        return;
+    }
+    if (ftruncate(fd_, original_size_) != 0)
+        std::cerr << "Warning: could not truncate the image back to " << original_size_ << " bytes" << std::endl;
+}
+
+// Copies src to dst, sharing extents when the filesystem can
+static bool cloneImage(const char* src, const char* dst, std::string& error) {
+    int in = ::open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        error = std::string(src) + ": " + strerror(errno);
+        return false;
+    }
+    int out = ::open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        error = std::string(dst) + ": " + strerror(errno);
+        close(in);
+        return false;
+    }
+    bool ok = ioctl(out, FICLONE, in) == 0;
+    if (!ok) {
+        struct stat st;
+        ok = fstat(in, &st) == 0;
+        for (off_t left = st.st_size; ok && left > 0;) {
+            ssize_t n = copy_file_range(in, nullptr, out, nullptr, left, 0);
+            if (n <= 0) {
+                error = std::string("copy failed: ") + strerror(n < 0 ? errno : EIO);
+                ok = false;
+            }
+            left -= n;
+        }
+    }
+    close(in);
+    close(out);
+    return ok;
+}
+
+static bool splitMapping(const char* arg, std::string& host, std::string& target) {
+    const char* eq = strchr(arg, '=');
+    if (!eq || eq == arg) return false;
+    host.assign(arg, eq - arg);
+    target = eq + 1;
+    while (!target.empty() && target[0] == '/') target.erase(0, 1);
+    return true;
+}
+
+static void usage() {
+    std::cerr << "Usage: iso_patch [-o output.iso] [-L layer] [-z gzip|xz] [-u uid:gid]" << std::endl;
+    std::cerr << "                 [-a host=root_path]... [-f host=iso_path]... image.iso" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const char* output = nullptr;
+    std::string layer_path = "casper/virtualdetect.squashfs";
+    SquashCompression compression = SQUASHFS_XZ;
+    bool set_owner = false;
+    unsigned int uid = 0, gid = 0;
+    std::vector<std::pair<std::string, std::string>> layer_files, iso_files;
+
+    int option;
+    while ((option = getopt(argc, argv, "o:L:z:u:a:f:")) != -1) {
+        std::string host, target;
+        switch (option) {
+            case 'o': output = optarg; break;
+            case 'L': layer_path = optarg; break;
+            case 'z':
+                if (strcmp(optarg, "gzip") == 0) compression = SQUASHFS_ZLIB;
+                else if (strcmp(optarg, "xz") == 0) compression = SQUASHFS_XZ;
+                else {
+                    usage();
+                    return 1;
+                }
+                break;
+            case 'u':
+                if (sscanf(optarg, "%u:%u", &uid, &gid) != 2) {
+                    usage();
+                    return 1;
+                }
+                set_owner = true;
+                break;
+            case 'a':
+            case 'f':
+                if (!splitMapping(optarg, host, target)) {
+                    std::cerr << "Expected host=path, got " << optarg << std::endl;
+                    return 1;
+                }
+                (option == 'a' ? layer_files : iso_files).emplace_back(host, target);
+                break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (optind + 1 != argc || (layer_files.empty() && iso_files.empty())) {
+        usage();
+        return 1;
+    }
+
+    std::string error;
+    std::string image = argv[optind];
+    if (output) {
+        if (!cloneImage(argv[optind], output, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        image = output;
+    }
+
+    IsoPatcher patcher;
+    if (!patcher.open(image, error)) {
+        std::cerr << image << ": " << error << std::endl;
+        return 1;
+    }
+    auto fail = [&](const std::string& message) {
+        std::cerr << message << std::endl;
+        if (output) unlink(output);
+        else patcher.rollback();
+        return 1;
+    };
+
+    // Fail before anything is written
+    if (!layer_files.empty() && !patcher.checkIsoPath(layer_path, error)) return fail(error);
+    for (const auto& file : iso_files) {
+        if (!patcher.checkIsoPath(file.second, error)) return fail(error);
+    }
+
+    // Everything that lands on the ISO, the layer first; it streams straight to disk
+    std::vector<Placement> files;
+    files.reserve(iso_files.size() + 1);
+    if (!layer_files.empty()) {
+        SquashWriter writer(patcher.fd(), patcher.appendOffset(), compression);
+        if (set_owner) writer.setOwner(uid, gid);
+        for (const auto& [host, target] : layer_files) {
+            if (!writer.add(host, target, error)) return fail(error);
+        }
+        Placement& layer = files.emplace_back();
+        layer.iso_path = layer_path;
+        layer.extent = patcher.nextExtent();
+        if (!writer.write(layer.size, error)) return fail(layer_path + ": " + error);
+        patcher.reserve(layer.size);
+        std::cout << "Layer " << layer_path << ": " << writer.inodeCount() << " inodes, " << layer.size << " bytes" << std::endl;
+    }
+    FileReader reader;
+    for (const auto& [host, target] : iso_files) {
+        if (!reader.read(host.c_str())) return fail("Cannot read " + host);
+        Placement& file = files.emplace_back();
+        file.iso_path = target;
+        file.content = std::string(reader.data());
+        patcher.append(file);
+    }
+
+    for (auto& file : files) {
+        if (!patcher.place(file, error)) return fail(error);
+    }
+    if (!patcher.commit(error)) return fail(error);
+
+    std::cout << "Patched " << image << ": " << patcher.recordsRewritten() << " directory records rewritten, "
+              << patcher.directoriesMoved() << " directories moved, " << patcher.bootEntriesPatched()
+              << " boot catalog entries updated, " << patcher.appendOffset() << " bytes total." << std::endl;
+    return 0;
+}
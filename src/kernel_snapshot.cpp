@@ -0,0 +1,86 @@
+#include "kernel_snapshot.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+std::string kernel_snapshot_path = VMD_SNAPSHOT_DEVICE;
+
+// Smallest entry the reader understands for each known section type
+static size_t minimumEntrySize(uint32_t type) {
+    switch (type) {
+        case VMD_SNAP_DMI: return sizeof(vmd_snap_dmi);
+        case VMD_SNAP_ACPI: return sizeof(vmd_snap_acpi);
+        case VMD_SNAP_PCI: return sizeof(vmd_snap_pci);
+        case VMD_SNAP_MODULES: return sizeof(vmd_snap_module);
+        case VMD_SNAP_NETDEV: return sizeof(vmd_snap_netdev);
+        case VMD_SNAP_CPU: return sizeof(vmd_snap_cpu);
+        default: return 1;
+    }
+}
+
+bool KernelSnapshot::load(const char* path) {
+    loaded_ = false;
+    if (buf_.empty()) buf_.resize(64 * 1024);
+
+    // The module builds the snapshot on open; read it whole from offset 0
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ssize_t n;
+    while (true) {
+        n = pread(fd, buf_.data(), buf_.size(), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < static_cast<ssize_t>(sizeof(vmd_snapshot_header))) break;
+        uint32_t total = reinterpret_cast<const vmd_snapshot_header*>(buf_.data())->total_size;
+        if (total <= buf_.size()) break;
+        buf_.resize(total);
+    }
+    close(fd);
+    if (n < 0) return false;
+
+    loaded_ = validate(static_cast<size_t>(n));
+    return loaded_;
+}
+
+bool KernelSnapshot::validate(size_t size) {
+    if (size < sizeof(vmd_snapshot_header)) return false;
+    const auto* header = reinterpret_cast<const vmd_snapshot_header*>(buf_.data());
+    if (header->magic != VMD_SNAPSHOT_MAGIC || header->version != VMD_SNAPSHOT_VERSION ||
+        header->total_size != size || header->header_size < sizeof(vmd_snapshot_header))
+        return false;
+    if (header->section_count > (size - header->header_size) / sizeof(vmd_snapshot_section)) return false;
+
+    const auto* sections = reinterpret_cast<const vmd_snapshot_section*>(buf_.data() + header->header_size);
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        const vmd_snapshot_section& s = sections[i];
+        if (s.entry_size < minimumEntrySize(s.type) || s.offset % 8 != 0 || s.offset > size) return false;
+        if (s.count > (size - s.offset) / s.entry_size) return false;
+    }
+    generation_ = header->generation;
+    return true;
+}
+
+const vmd_snapshot_section* KernelSnapshot::find(uint32_t type) const {
+    if (!loaded_) return nullptr;
+    const auto* header = reinterpret_cast<const vmd_snapshot_header*>(buf_.data());
+    const auto* sections = reinterpret_cast<const vmd_snapshot_section*>(buf_.data() + header->header_size);
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        if (sections[i].type == type) return &sections[i];
+    }
+    return nullptr;
+}
+
+bool KernelSnapshot::has(uint32_t type) const {
+    return find(type) != nullptr;
+}
+
+static KernelSnapshot current_snapshot;
+
+void refreshKernelSnapshot() {
+    if (kernel_snapshot_path.empty()) return;
+    current_snapshot.load(kernel_snapshot_path.c_str());
+}
+
+const KernelSnapshot* kernelSnapshot() {
+    return current_snapshot.loaded() ? &current_snapshot : nullptr;
+}
@@ -0,0 +1,82 @@
+#ifndef KERNEL_SNAPSHOT_H
+#define KERNEL_SNAPSHOT_H
+
+#include "vmd_snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Entries of one snapshot section; entry_size may exceed sizeof(T) in newer snapshots
+template <typename T>
+class SnapshotSection {
+public:
+    SnapshotSection() = default;
+    SnapshotSection(const char* data, uint32_t count, uint32_t stride) : data_(data), count_(count), stride_(stride) {}
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    const T& operator[](size_t i) const { return *reinterpret_cast<const T*>(data_ + i * stride_); }
+
+private:
+    const char* data_ = nullptr;
+    uint32_t count_ = 0;
+    uint32_t stride_ = sizeof(T);
+};
+
+/**
+    Snapshot read from snapshot_module's device (see vmd_snapshot.h) with a
+    single read. The buffer is reused across loads; sections reference it
+    and stay valid until the next load().
+ */
+class KernelSnapshot {
+public:
+    // False if the device is missing or the snapshot fails validation
+    bool load(const char* path);
+    bool loaded() const { return loaded_; }
+    uint64_t generation() const { return generation_; }
+
+    // A section the module did not send is empty; has() tells the two apart
+    bool has(uint32_t type) const;
+    SnapshotSection<vmd_snap_dmi> dmi() const { return section<vmd_snap_dmi>(VMD_SNAP_DMI); }
+    SnapshotSection<vmd_snap_acpi> acpi() const { return section<vmd_snap_acpi>(VMD_SNAP_ACPI); }
+    SnapshotSection<vmd_snap_pci> pci() const { return section<vmd_snap_pci>(VMD_SNAP_PCI); }
+    SnapshotSection<vmd_snap_module> modules() const { return section<vmd_snap_module>(VMD_SNAP_MODULES); }
+    SnapshotSection<vmd_snap_netdev> netdevs() const { return section<vmd_snap_netdev>(VMD_SNAP_NETDEV); }
+    SnapshotSection<vmd_snap_cpu> cpus() const { return section<vmd_snap_cpu>(VMD_SNAP_CPU); }
+
+private:
+    const vmd_snapshot_section* find(uint32_t type) const;
+
+    template <typename T>
+    SnapshotSection<T> section(uint32_t type) const {
+        const vmd_snapshot_section* entry = find(type);
+        if (!entry) return SnapshotSection<T>();
+        return SnapshotSection<T>(buf_.data() + entry->offset, entry->count, entry->entry_size);
+    }
+
+    bool validate(size_t size);
+
+    std::vector<char> buf_;
+    bool loaded_ = false;
+    uint64_t generation_ = 0;
+};
+
+// Device the probes read, settable with -k; empty disables the snapshot
+extern std::string kernel_snapshot_path;
+
+// Re-reads the snapshot for a new scan (once per runAllTests/runIndividualTest)
+void refreshKernelSnapshot();
+
+// The snapshot of the current scan, or null if snapshot_module is not loaded
+const KernelSnapshot* kernelSnapshot();
+
+// Copies a fixed-size, possibly unterminated string field
+template <size_t N>
+std::string snapshotString(const char (&field)[N]) {
+    size_t len = 0;
+    while (len < N && field[len]) len++;
+    return std::string(field, len);
+}
+
+#endif // KERNEL_SNAPSHOT_H
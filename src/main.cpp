@@ -1,13 +1,91 @@
 #include "vm_detection.h"
 #include "vm_mitigations.h"  // Include the mitigations header
+#include "steal_time.h"
+#include "results_export.h"
+#include "metrics_exporter.h"
+#include "batch_reader.h"
+#include "sigpack.h"
+#include "kernel_snapshot.h"
+#include "container_scan.h"
+#include "scan_history.h"
+#include "probe_watchdog.h"
+#include "scan_budget.h"
+#include "hw_fingerprint.h"
 #include <iostream>
+#include <csignal>
 #include <unistd.h> // For getopt on Unix/Linux systems
+#include <getopt.h>
+#include <ctime>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <algorithm>
 
 using namespace std;
 
+// SIGHUP in daemon mode: pick up a new signature pack before the next scan
+static void handleSighup(int) {
+    requestSignatureReload();
+}
+
+// Long-only options
+enum { OPT_MITIGATE = 256, OPT_VERIFY, OPT_HISTORY, OPT_SINCE, OPT_HISTORY_LIMIT, OPT_BUDGET, OPT_BUDGET_EXITS };
+
+static const struct option long_options[] = {
+    {"help", no_argument, nullptr, 'h'},
+    {"mitigate", no_argument, nullptr, OPT_MITIGATE},
+    {"verify", no_argument, nullptr, OPT_VERIFY},
+    {"history", required_argument, nullptr, OPT_HISTORY},
+    {"since", required_argument, nullptr, OPT_SINCE},
+    {"history-limit", required_argument, nullptr, OPT_HISTORY_LIMIT},
+    {"budget", required_argument, nullptr, OPT_BUDGET},
+    {"budget-exits", required_argument, nullptr, OPT_BUDGET_EXITS},
+    {nullptr, 0, nullptr, 0}
+};
+
+// A whole decimal number in [min, max] and nothing else
+static bool parseNumber(const char* text, unsigned long long min, unsigned long long max, unsigned long long& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = strtoull(text, &end, 10);
+    // strtoull negates "-5" into a huge value instead of failing
+    if (end == text || *end != '\0' || errno == ERANGE || text[strspn(text, " \t")] == '-') return false;
+    return value >= min && value <= max;
+}
+
+// --since: Unix seconds, or an age such as 90s, 30m, 6h or 2d
+static bool parseSince(const char* text, uint64_t& since_ns) {
+    const unsigned long long max_seconds = ULLONG_MAX / 1000000000ull;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    // strtoull negates "-5" into a huge value instead of failing
+    if (end == text || errno == ERANGE || text[strspn(text, " \t")] == '-') return false;
+    if (*end == '\0') {
+        if (value > max_seconds) return false;
+        since_ns = value * 1000000000ull;
+        return true;
+    }
+    unsigned long long unit = *end == 's' ? 1 : *end == 'm' ? 60 : *end == 'h' ? 3600 : *end == 'd' ? 86400 : 0;
+    if (unit == 0 || end[1] != '\0' || value > ULLONG_MAX / unit) return false;
+    // An age older than the epoch means everything
+    unsigned long long now = static_cast<unsigned long long>(time(nullptr));
+    since_ns = value * unit >= now ? 0 : std::min(now - value * unit, max_seconds) * 1000000000ull;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     bool runAll = false;
     string testName;
+    int daemonInterval = 0;
+    bool mitigate = false;
+    bool verify = false;
+    string containerSpec;
+    string historyPath;
+    long historyCount = 0;
+    uint64_t historySince = 0;
+    bool budget = false;
+    bool fingerprint = false;
 
     // Detect and display the OS and Architecture
     if (LINUX) {
@@ -27,8 +105,9 @@ int main(int argc, char* argv[]) {
     else if (ARM) ARCH = ARCH_ARM;
     else cout << "Unknown architecture" << endl;
 
+    unsigned long long number = 0;
     int option;
-    while ((option = getopt(argc, argv, "hat:")) != -1) 
+    while ((option = getopt_long(argc, argv, "hat:d:w:s:m:uO:p:k:PC:j:H:T:F", long_options, nullptr)) != -1) 
     {
         switch (option) {
             case 'h':
@@ -40,12 +119,205 @@ int main(int argc, char* argv[]) {
             case 't':
                 testName = optarg;
                 break;
+            case 'd':
+                if (!parseNumber(optarg, 1, INT_MAX, number)) {
+                    cerr << "-d: expected a positive number of seconds" << endl;
+                    return -1;
+                }
+                daemonInterval = static_cast<int>(number);
+                break;
+            case 'w':
+                if (!parseNumber(optarg, 1, UINT_MAX, number)) {
+                    cerr << "-w: expected a positive number of milliseconds" << endl;
+                    return -1;
+                }
+                steal_window_ms = static_cast<unsigned int>(number);
+                break;
+            case 's':
+                if (!openResultsExport(optarg)) return -1;
+                break;
+            case 'm':
+                if (!startMetricsExporter(optarg)) return -1;
+                break;
+            case 'u':
+                use_io_uring = true;
+                break;
+            case 'O':
+                oui_db_path = optarg;
+                break;
+            case 'p':
+                signature_pack_path = optarg;
+                break;
+            case 'k':
+                kernel_snapshot_path = optarg;
+                break;
+            case 'P':
+                perf_counters_enabled = true;
+                break;
+            case 'C':
+                containerSpec = optarg;
+                break;
+            case 'j':
+                if (!parseNumber(optarg, 1, UINT_MAX, number)) {
+                    cerr << "-j: expected a positive number of threads" << endl;
+                    return -1;
+                }
+                container_scan_threads = static_cast<unsigned int>(number);
+                break;
+            case OPT_MITIGATE:
+                mitigate = true;
+                break;
+            case OPT_VERIFY:
+                verify = true;
+                break;
+            case 'H':
+                historyPath = optarg;
+                break;
+            case 'T':
+                if (!parseNumber(optarg, 0, UINT_MAX, number)) {
+                    cerr << "-T: expected a number of milliseconds, or 0 to disable" << endl;
+                    return -1;
+                }
+                probe_timeout_ms = static_cast<unsigned int>(number);
+                break;
+            case 'F':
+                fingerprint = true;
+                break;
+            case OPT_HISTORY:
+                if (!parseNumber(optarg, 1, LONG_MAX, number)) {
+                    cerr << "--history: expected a positive number of scans" << endl;
+                    return -1;
+                }
+                historyCount = static_cast<long>(number);
+                break;
+            case OPT_SINCE:
+                if (!parseSince(optarg, historySince)) {
+                    cerr << "--since: expected Unix seconds or an age like 30m, 6h, 2d" << endl;
+                    return -1;
+                }
+                break;
+            case OPT_HISTORY_LIMIT:
+                if (!parseNumber(optarg, 1, UINT64_MAX / 1024, number)) {
+                    cerr << "--history-limit: expected a positive size in KiB" << endl;
+                    return -1;
+                }
+                history_max_bytes = number * 1024;
+                break;
+            case OPT_BUDGET: {
+                char* end = nullptr;
+                budget = true;
+                budget_cpu_pct = strtod(optarg, &end);
+                if (end == optarg || *end != '\0') {
+                    cerr << "--budget: expected a percentage of one CPU" << endl;
+                    return -1;
+                }
+                break;
+            }
+            case OPT_BUDGET_EXITS: {
+                char* end = nullptr;
+                errno = 0;
+                long exits = strtol(optarg, &end, 10);
+                if (end == optarg || *end != '\0' || errno == ERANGE || exits <= 0 || exits > UINT_MAX) {
+                    cerr << "--budget-exits: expected a positive number of exits per second" << endl;
+                    return -1;
+                }
+                budget_exits_per_sec = static_cast<unsigned int>(exits);
+                break;
+            }
             default:
                 displayHelp();
                 return -1;
         }
     }
 
+    // History queries read the log and exit without scanning
+    if (historyCount > 0 || historySince > 0) {
+        if (historyPath.empty()) {
+            cerr << "--history and --since need -H <path>" << endl;
+            return -1;
+        }
+        bool ok = historyCount <= 0 || printScanHistory(historyPath, static_cast<size_t>(historyCount));
+        if (ok && historySince > 0) ok = printHistoryChanges(historyPath, historySince);
+        return ok ? 0 : -1;
+    }
+    if (!historyPath.empty() && !openScanHistory(historyPath)) return -1;
+
+    // Fingerprint only: no probes run
+    if (fingerprint) {
+        refreshKernelSnapshot();
+        computeHardwareFingerprint(hardware_fingerprint);
+        printHardwareFingerprint(hardware_fingerprint);
+        return 0;
+    }
+
+    // Before any scan thread starts, so they all inherit SCHED_IDLE
+    if (budget && !startScanBudget()) return -1;
+
+    loadSignatures();
+    openOuiDatabase();
+
+    // Host-side container scan: every target's own view, from threads in this process
+    if (!containerSpec.empty()) {
+        vector<ContainerTarget> targets;
+        string error;
+        if (!findContainerTargets(containerSpec, targets, error)) {
+            cerr << "-C: " << error << endl;
+            return -1;
+        }
+        vector<ContainerResult> results;
+        beginBudgetWindow();
+        scanContainers(targets, results);
+        printContainerReport(results);
+        printBudgetReport();
+        for (const auto& result : results) {
+            for (const auto& [name, probe] : result.probes) {
+                if (probe.detected) return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Scan, mitigate and optionally verify once, without prompts; the exit code gates rollouts
+    if (mitigate || verify) {
+        if (!mitigate) {
+            cerr << "--verify requires --mitigate" << endl;
+            return -1;
+        }
+        if (runAll || testName.empty()) runAllTests();
+        else runIndividualTest(testName);
+        recordScanHistory(probe_results);
+        printBudgetReport();
+        const map<string, ProbeResult> before = probe_results;
+        return mitigateAndVerify(before, verify) ? 0 : 1;
+    }
+
+    // Daemon mode: re-run the selected tests on an interval, no prompts
+    if (daemonInterval > 0) {
+        if (!runAll && testName.empty()) {
+            displayHelp();
+            return -1;
+        }
+        // No SA_RESTART: the signal cuts the sleep short so the reload is immediate
+        struct sigaction action = {};
+        action.sa_handler = handleSighup;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGHUP, &action, nullptr);
+
+        while (true) {
+            if (runAll) runAllTests();
+            else runIndividualTest(testName);
+            publishResults(probe_results);
+            updateMetrics(probe_results);
+            recordScanHistory(probe_results);
+            printBudgetReport();
+            unsigned int remaining = daemonInterval;
+            while (remaining > 0) {
+                remaining = sleep(remaining);
+                reloadSignaturesIfRequested();
+            }
+        }
+    }
+
     bool exitProgram = false;
     while (!exitProgram) {
         map<string, bool> test_results;
@@ -53,11 +325,15 @@ int main(int argc, char* argv[]) {
         if (runAll) {
             test_results = runAllTests();  // Store results in the map
         } else if (!testName.empty()) {
-            runIndividualTest(testName);
+            test_results[testName] = runIndividualTest(testName) == 1;
         } else {
             displayHelp();
             return -1;
         }
+        publishResults(probe_results);
+        updateMetrics(probe_results);
+        recordScanHistory(probe_results);
+        printBudgetReport();
 
         // Ask user if they want to apply mitigation techniques
         char userChoice;
@@ -0,0 +1,43 @@
+#include "mapped_file.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const char* path, std::string& error) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = std::string("cannot open: ") + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        error = "empty or unreadable file";
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        error = std::string("mmap failed: ") + strerror(errno);
+        return false;
+    }
+    // Directory walks jump around; file contents are read front to back
+    madvise(map, st.st_size, MADV_RANDOM);
+    map_ = map;
+    size_ = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (map_) munmap(map_, size_);
+    map_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,26 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only mmap of a whole file; the view stays valid until close() or destruction
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path, std::string& error);
+    void close();
+
+    std::string_view data() const { return std::string_view(static_cast<const char*>(map_), size_); }
+
+private:
+    void* map_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,242 @@
+#include "metrics_exporter.h"
+#include "hw_fingerprint.h"
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Complete HTTP responses, rendered once per scan and shared with the listener
+static std::shared_ptr<const std::string> metrics_response;
+static const std::string not_found_response =
+    "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+// Latest result of every probe seen so far, and the scan counter
+static std::map<std::string, ProbeResult> latest_results;
+static uint64_t scans_total = 0;
+
+static std::string httpResponse(const std::string& body) {
+    std::string response = "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n";
+    return response + body;
+}
+
+static std::string renderMetrics() {
+    std::ostringstream out;
+
+    out << "# TYPE vmd_probe_detected gauge\n"
+        << "# HELP vmd_probe_detected Whether the probe found virtualization artifacts in its last run.\n";
+    for (const auto& [name, result] : latest_results)
+        out << "vmd_probe_detected{probe=\"" << name << "\"} " << (result.detected ? 1 : 0) << "\n";
+
+    out << "# TYPE vmd_probe_timed_out gauge\n"
+        << "# HELP vmd_probe_timed_out Whether the watchdog stopped the probe at its time budget in its last run.\n";
+    for (const auto& [name, result] : latest_results)
+        out << "vmd_probe_timed_out{probe=\"" << name << "\"} " << (result.timed_out ? 1 : 0) << "\n";
+
+    out << "# TYPE vmd_probe_evidence gauge\n"
+        << "# HELP vmd_probe_evidence Distinct evidence items found by the probe in its last run.\n";
+    for (const auto& [name, result] : latest_results)
+        out << "vmd_probe_evidence{probe=\"" << name << "\"} " << result.evidence.size() << "\n";
+
+    out << "# TYPE vmd_probe_duration_seconds gauge\n"
+        << "# UNIT vmd_probe_duration_seconds seconds\n"
+        << "# HELP vmd_probe_duration_seconds Run time of the probe's last run.\n";
+    for (const auto& [name, result] : latest_results)
+        out << "vmd_probe_duration_seconds{probe=\"" << name << "\"} " << result.elapsed_ns / 1e9 << "\n";
+
+    // Only probes run with -P carry counters
+    struct CounterMetric { const char* name; const char* help; uint64_t ProbeCounters::*field; bool hardware; double scale; };
+    static const CounterMetric counter_metrics[] = {
+        {"vmd_probe_task_clock_seconds", "CPU time of the probe's last run, helpers included.", &ProbeCounters::task_clock_ns, false, 1e-9},
+        {"vmd_probe_context_switches", "Context switches during the probe's last run.", &ProbeCounters::context_switches, false, 1},
+        {"vmd_probe_page_faults", "Page faults during the probe's last run.", &ProbeCounters::page_faults, false, 1},
+        {"vmd_probe_cycles", "CPU cycles of the probe's last run (PMU only).", &ProbeCounters::cycles, true, 1},
+        {"vmd_probe_instructions", "Instructions retired in the probe's last run (PMU only).", &ProbeCounters::instructions, true, 1},
+    };
+    for (const CounterMetric& metric : counter_metrics) {
+        bool header = false;
+        for (const auto& [name, result] : latest_results) {
+            const ProbeCounters& counters = result.counters;
+            if (!counters.ok || (metric.hardware && !counters.hardware)) continue;
+            if (!header) {
+                out << "# TYPE " << metric.name << " gauge\n"
+                    << "# HELP " << metric.name << " " << metric.help << "\n";
+                header = true;
+            }
+            out << metric.name << "{probe=\"" << name << "\"} " << counters.*metric.field * metric.scale << "\n";
+        }
+    }
+
+    int detected = 0;
+    for (const auto& [name, result] : latest_results)
+        detected += result.detected ? 1 : 0;
+
+    out << "# TYPE vmd_detected_probes gauge\n"
+        << "# HELP vmd_detected_probes Probes currently reporting virtualization.\n"
+        << "vmd_detected_probes " << detected << "\n"
+        << "# TYPE vmd_scans counter\n"
+        << "# HELP vmd_scans Completed scans.\n"
+        << "vmd_scans_total " << scans_total << "\n"
+        << "# TYPE vmd_last_scan_timestamp_seconds gauge\n"
+        << "# UNIT vmd_last_scan_timestamp_seconds seconds\n"
+        << "# HELP vmd_last_scan_timestamp_seconds Wall-clock time of the last scan.\n"
+        << "vmd_last_scan_timestamp_seconds " << time(nullptr) << "\n";
+
+    if (hardware_fingerprint.version != 0) {
+        out << "# TYPE vmd_hardware_fingerprint info\n"
+            << "# HELP vmd_hardware_fingerprint Canonical hash of the virtual hardware model, with per-component hashes.\n"
+            << "vmd_hardware_fingerprint_info{fingerprint=\"" << formatFingerprint(hardware_fingerprint) << "\"";
+        for (int component = 0; component < FP_COMPONENTS; component++)
+            out << "," << fingerprint_component_names[component] << "=\"" << formatHash128(hardware_fingerprint.components[component]) << "\"";
+        out << "} 1\n";
+    }
+
+    if (latest_results.count("timing")) {
+        out << "# TYPE vmd_timing_cycles_per_op gauge\n"
+            << "# HELP vmd_timing_cycles_per_op Average counter ticks per serialized timing iteration.\n"
+            << "vmd_timing_cycles_per_op " << timing_stats.cycles_per_op << "\n"
+            << "# TYPE vmd_timing_op_seconds gauge\n"
+            << "# UNIT vmd_timing_op_seconds seconds\n"
+            << "# HELP vmd_timing_op_seconds Average time per serialized timing iteration.\n"
+            << "vmd_timing_op_seconds " << timing_stats.ns_per_op / 1e9 << "\n";
+    }
+    if (latest_results.count("steal")) {
+        out << "# TYPE vmd_steal_ratio gauge\n"
+            << "# HELP vmd_steal_ratio Share of CPU time stolen by the hypervisor in the last sample window.\n"
+            << "vmd_steal_ratio " << timing_stats.steal_pct / 100.0 << "\n"
+            << "# TYPE vmd_run_delay_seconds gauge\n"
+            << "# UNIT vmd_run_delay_seconds seconds\n"
+            << "# HELP vmd_run_delay_seconds Run-queue delay summed over all CPUs in the last sample window.\n"
+            << "vmd_run_delay_seconds " << timing_stats.run_delay_ms / 1e3 << "\n";
+    }
+    out << "# EOF\n";
+    return out.str();
+}
+
+void updateMetrics(const std::map<std::string, ProbeResult>& results) {
+    for (const auto& [name, result] : results)
+        latest_results[name] = result;
+    scans_total++;
+
+    auto response = std::make_shared<const std::string>(httpResponse(renderMetrics()));
+    std::atomic_store(&metrics_response, response);
+}
+
+static void writeAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+static void serve(int listen_fd) {
+    while (true) {
+        int client = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno != EINTR) usleep(10000);
+            continue;
+        }
+
+        // Don't let a slow client stall the listener
+        struct timeval tv = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        char request[2048];
+        size_t len = 0;
+        while (len < sizeof(request) - 1) {
+            ssize_t n = recv(client, request + len, sizeof(request) - 1 - len, 0);
+            if (n <= 0) break;
+            len += n;
+            request[len] = '\0';
+            if (strstr(request, "\r\n\r\n")) break;
+        }
+        request[len] = '\0';
+
+        auto response = std::atomic_load(&metrics_response);
+        bool wants_metrics = strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0;
+        if (wants_metrics && response) writeAll(client, *response);
+        else writeAll(client, not_found_response);
+        close(client);
+    }
+}
+
+static int bindAddress(const std::string& address) {
+    if (address.rfind("unix:", 0) == 0) {
+        std::string path = address.substr(5);
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) return -1;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        // Only clear a stale socket; anything else at the path makes bind fail with EADDRINUSE
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    std::string host = "127.0.0.1";
+    std::string port = address;
+    size_t colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+    if (host == "localhost") host = "127.0.0.1";
+
+    char* end;
+    errno = 0;
+    long number = strtol(port.c_str(), &end, 10);
+    if (port.empty() || *end != '\0' || errno == ERANGE || number < 1 || number > 65535) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(number));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool startMetricsExporter(const std::string& address) {
+    int fd = bindAddress(address);
+    if (fd < 0 || listen(fd, 16) != 0) {
+        std::cerr << "Failed to listen for metrics on " << address << ": " << strerror(errno) << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    std::thread(serve, fd).detach();
+    return true;
+}
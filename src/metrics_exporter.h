@@ -0,0 +1,20 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <map>
+#include <string>
+#include "vm_detection.h"
+
+/**
+    Starts the OpenMetrics listener on a background thread. address is either
+    "unix:/path/to/socket", "host:port" or a bare port (bound to 127.0.0.1).
+ */
+bool startMetricsExporter(const std::string& address);
+
+/**
+    Re-renders the exposition after a scan. Scrapes are served from the
+    rendered buffer and never run probes themselves.
+ */
+void updateMetrics(const std::map<std::string, ProbeResult>& results);
+
+#endif // METRICS_EXPORTER_H
@@ -0,0 +1,134 @@
+#include "netlink_links.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+
+namespace {
+
+// Copies a string attribute into a fixed buffer
+void copyString(char* dst, size_t size, const struct rtattr* rta) {
+    size_t len = RTA_PAYLOAD(rta);
+    if (len >= size) len = size - 1;
+    memcpy(dst, RTA_DATA(rta), len);
+    dst[len] = '\0';
+}
+
+void parseLinkInfo(LinkInfo& link, const struct rtattr* info, int len) {
+    for (const struct rtattr* rta = info; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == IFLA_INFO_KIND) copyString(link.kind, sizeof(link.kind), rta);
+    }
+}
+
+void parseLink(const struct nlmsghdr* nh, std::vector<LinkInfo>& links) {
+    const struct ifinfomsg* ifi = static_cast<const struct ifinfomsg*>(NLMSG_DATA(nh));
+    LinkInfo& link = links.emplace_back();
+    link.index = ifi->ifi_index;
+    link.type = ifi->ifi_type;
+
+    int len = IFLA_PAYLOAD(nh);
+    for (const struct rtattr* rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type) {
+            case IFLA_IFNAME:
+                copyString(link.name, sizeof(link.name), rta);
+                break;
+            case IFLA_ADDRESS:
+                if (RTA_PAYLOAD(rta) == 6) {
+                    memcpy(link.addr, RTA_DATA(rta), 6);
+                    link.has_addr = true;
+                }
+                break;
+            case IFLA_PERM_ADDRESS:
+                if (RTA_PAYLOAD(rta) == 6) {
+                    memcpy(link.perm_addr, RTA_DATA(rta), 6);
+                    link.has_perm_addr = true;
+                }
+                break;
+            case IFLA_LINK:
+                memcpy(&link.parent_index, RTA_DATA(rta), sizeof(int));
+                break;
+            case IFLA_LINKINFO:
+                parseLinkInfo(link, static_cast<const struct rtattr*>(RTA_DATA(rta)), RTA_PAYLOAD(rta));
+                break;
+            case IFLA_PARENT_DEV_NAME:
+                copyString(link.parent_dev, sizeof(link.parent_dev), rta);
+                break;
+            case IFLA_PARENT_DEV_BUS_NAME:
+                copyString(link.parent_bus, sizeof(link.parent_bus), rta);
+                break;
+        }
+    }
+}
+
+} // namespace
+
+bool dumpLinks(std::vector<LinkInfo>& links) {
+    links.clear();
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return false;
+
+    struct {
+        struct nlmsghdr nh;
+        struct ifinfomsg ifi;
+        struct rtattr ext_mask;
+        uint32_t ext_mask_value;
+    } req = {};
+    req.nh.nlmsg_len = sizeof(req);
+    req.nh.nlmsg_type = RTM_GETLINK;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = 1;
+    req.ifi.ifi_family = AF_UNSPEC;
+    // Per-link statistics are most of the dump and we never look at them
+    req.ext_mask.rta_type = IFLA_EXT_MASK;
+    req.ext_mask.rta_len = RTA_LENGTH(sizeof(uint32_t));
+    req.ext_mask_value = RTEXT_FILTER_SKIP_STATS;
+
+    if (send(fd, &req, sizeof(req), 0) < 0) {
+        close(fd);
+        return false;
+    }
+
+    static thread_local std::vector<char> buf(64 * 1024);
+    bool done = false, ok = true;
+    while (!done) {
+        ssize_t n = recv(fd, buf.data(), buf.size(), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        int len = static_cast<int>(n);
+        for (const struct nlmsghdr* nh = reinterpret_cast<const struct nlmsghdr*>(buf.data());
+             NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type == NLMSG_DONE) {
+                done = true;
+                break;
+            }
+            if (nh->nlmsg_type == NLMSG_ERROR) {
+                done = true;
+                ok = false;
+                break;
+            }
+            if (nh->nlmsg_type == RTM_NEWLINK) parseLink(nh, links);
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+bool isVirtualLinkKind(const char* kind) {
+    static const char* const virtual_kinds[] = {
+        "veth", "bridge", "tun", "dummy", "vxlan", "geneve", "ifb",
+        "macvlan", "macvtap", "ipvlan", "ipvtap", "wireguard", "gre", "gretap",
+        "ipip", "sit", "vrf", "team", "bond", "nlmon"
+    };
+    if (kind[0] == '\0') return false;
+    for (const char* virtual_kind : virtual_kinds) {
+        if (strcmp(kind, virtual_kind) == 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,37 @@
+#ifndef NETLINK_LINKS_H
+#define NETLINK_LINKS_H
+
+#include <cstdint>
+#include <vector>
+#include <net/if.h>
+
+// One network interface as reported by an RTM_GETLINK dump
+struct LinkInfo {
+    int index = 0;
+    unsigned short type = 0;        // ARPHRD_*
+    char name[IFNAMSIZ] = {};
+    char kind[32] = {};             // IFLA_INFO_KIND, e.g. "veth", "bridge"; empty for plain NICs
+    int parent_index = 0;           // IFLA_LINK, lower device for vlan/macvlan/veth
+    char parent_dev[64] = {};       // IFLA_PARENT_DEV_NAME, e.g. "0000:00:03.0" or "virtio0"
+    char parent_bus[16] = {};       // IFLA_PARENT_DEV_BUS_NAME, e.g. "pci", "virtio"
+    bool has_addr = false;
+    bool has_perm_addr = false;
+    uint8_t addr[6] = {};
+    uint8_t perm_addr[6] = {};      // burned-in address, survives MAC overrides
+};
+
+/**
+    Fetches every link with a single rtnetlink dump (statistics skipped).
+    links is cleared and refilled so its storage can be reused between scans.
+ */
+bool dumpLinks(std::vector<LinkInfo>& links);
+
+// True for software link kinds (veth, bridge, tun, ...) that never carry a vendor OUI
+bool isVirtualLinkKind(const char* kind);
+
+// First three octets of a MAC as a 24-bit integer
+inline uint32_t macOui(const uint8_t* mac) {
+    return (static_cast<uint32_t>(mac[0]) << 16) | (static_cast<uint32_t>(mac[1]) << 8) | mac[2];
+}
+
+#endif // NETLINK_LINKS_H
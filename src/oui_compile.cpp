@@ -0,0 +1,243 @@
+/**
+    Compiles the IEEE MAC address registry into the binary index read by
+    checkMAC (see oui_db.h).
+
+    Usage: oui_compile -o oui.idx [-t tags.txt] oui.csv [mam.csv] [oui36.csv]
+
+    Inputs are the CSV downloads from standards-oui.ieee.org
+    (Registry,Assignment,Organization Name,Organization Address).
+    A tags file adds or overrides entries, one per line:
+        <hex assignment> <vmware|virtualbox|qemu|hyperv|xen|parallels> [name]
+ */
+#include "oui_db.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+#include <unistd.h>
+
+struct Assignment {
+    uint64_t prefix;
+    uint8_t bits;
+    uint8_t tag;
+    std::string name;
+};
+
+// Virtual NIC assignments that hypervisors hand out, some of them locally
+// administered and therefore missing from the IEEE registry
+static const struct { const char* hex; OuiTag tag; const char* name; } builtin_virtual[] = {
+    {"000569", OUI_TAG_VMWARE, "VMware, Inc."},
+    {"000C29", OUI_TAG_VMWARE, "VMware, Inc."},
+    {"001C14", OUI_TAG_VMWARE, "VMware, Inc."},
+    {"005056", OUI_TAG_VMWARE, "VMware, Inc."},
+    {"080027", OUI_TAG_VIRTUALBOX, "PCS Systemtechnik GmbH (VirtualBox)"},
+    {"0A0027", OUI_TAG_VIRTUALBOX, "VirtualBox host-only adapter"},
+    {"525400", OUI_TAG_QEMU_KVM, "QEMU virtual NIC"},
+    {"001A4A", OUI_TAG_QEMU_KVM, "Qumranet Inc."},
+    {"00155D", OUI_TAG_HYPERV, "Microsoft Hyper-V virtual NIC"},
+    {"00163E", OUI_TAG_XEN, "XenSource, Inc."},
+    {"001C42", OUI_TAG_PARALLELS, "Parallels, Inc."},
+};
+
+// Organizations whose whole allocation is virtual hardware
+static const struct { const char* pattern; OuiTag tag; } vendor_patterns[] = {
+    {"vmware", OUI_TAG_VMWARE},
+    {"parallels", OUI_TAG_PARALLELS},
+    {"xensource", OUI_TAG_XEN},
+    {"qumranet", OUI_TAG_QEMU_KVM},
+    {"innotek", OUI_TAG_VIRTUALBOX},
+};
+
+static bool containsIgnoreCase(const std::string& haystack, const char* needle) {
+    size_t n = strlen(needle);
+    for (size_t i = 0; i + n <= haystack.size(); i++) {
+        if (strncasecmp(haystack.c_str() + i, needle, n) == 0) return true;
+    }
+    return false;
+}
+
+static bool parseAssignment(const std::string& hex, uint64_t& prefix, uint8_t& bits) {
+    if (hex.size() != 6 && hex.size() != 7 && hex.size() != 9) return false;
+    uint64_t value = 0;
+    for (char c : hex) {
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        value = (value << 4) | digit;
+    }
+    bits = static_cast<uint8_t>(hex.size() * 4);
+    prefix = value << (48 - bits);
+    return true;
+}
+
+static int parseTag(const std::string& name) {
+    static const char* const names[] = {"", "vmware", "virtualbox", "qemu", "hyperv", "xen", "parallels"};
+    for (int i = 1; i < OUI_TAG_COUNT; i++) {
+        if (strcasecmp(name.c_str(), names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+// Splits one CSV record, honouring quotes and "" escapes
+static std::vector<std::string> splitCsv(const std::string& line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') { fields.back() += '"'; i++; }
+            else if (c == '"') quoted = false;
+            else fields.back() += c;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else if (c != '\r') {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+static bool loadRegistry(const char* path, std::map<std::pair<uint64_t, uint8_t>, Assignment>& table) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    size_t loaded = 0;
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = splitCsv(line);
+        if (fields.size() < 3 || fields[0].rfind("MA-", 0) != 0) continue;  // header, CID rows
+
+        Assignment a;
+        if (!parseAssignment(fields[1], a.prefix, a.bits)) continue;
+        a.name = fields[2];
+        a.tag = OUI_TAG_NONE;
+        for (const auto& vendor : vendor_patterns) {
+            if (containsIgnoreCase(a.name, vendor.pattern)) a.tag = vendor.tag;
+        }
+        table[{a.prefix, a.bits}] = a;
+        loaded++;
+    }
+    std::cout << path << ": " << loaded << " assignments" << std::endl;
+    return true;
+}
+
+static bool loadTags(const char* path, std::map<std::pair<uint64_t, uint8_t>, Assignment>& table) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.find(' ', sp1 == std::string::npos ? sp1 : sp1 + 1);
+        std::string hex = line.substr(0, sp1);
+        std::string tag = sp1 == std::string::npos ? "" : line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+        Assignment a;
+        int tag_value = parseTag(tag);
+        if (!parseAssignment(hex, a.prefix, a.bits) || tag_value < 0) {
+            std::cerr << "Skipping bad tag line: " << line << std::endl;
+            continue;
+        }
+        auto& entry = table[{a.prefix, a.bits}];
+        entry.prefix = a.prefix;
+        entry.bits = a.bits;
+        entry.tag = static_cast<uint8_t>(tag_value);
+        if (sp2 != std::string::npos) entry.name = line.substr(sp2 + 1);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* output = nullptr;
+    const char* tags = nullptr;
+    int option;
+    while ((option = getopt(argc, argv, "o:t:")) != -1) {
+        switch (option) {
+            case 'o': output = optarg; break;
+            case 't': tags = optarg; break;
+            default:
+                std::cerr << "Usage: oui_compile -o oui.idx [-t tags.txt] oui.csv [mam.csv] [oui36.csv]" << std::endl;
+                return 1;
+        }
+    }
+    if (!output || optind >= argc) {
+        std::cerr << "Usage: oui_compile -o oui.idx [-t tags.txt] oui.csv [mam.csv] [oui36.csv]" << std::endl;
+        return 1;
+    }
+
+    std::map<std::pair<uint64_t, uint8_t>, Assignment> table;
+    for (const auto& v : builtin_virtual) {
+        Assignment a;
+        parseAssignment(v.hex, a.prefix, a.bits);
+        a.tag = v.tag;
+        a.name = v.name;
+        table[{a.prefix, a.bits}] = a;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (!loadRegistry(argv[i], table)) return 1;
+    }
+    // Registry names win, but the built-in virtual tags are kept
+    for (const auto& v : builtin_virtual) {
+        uint64_t prefix;
+        uint8_t bits;
+        parseAssignment(v.hex, prefix, bits);
+        table[{prefix, bits}].tag = v.tag;
+    }
+    if (tags && !loadTags(tags, table)) return 1;
+
+    // Entries come out of the map already sorted by (prefix, bits)
+    std::vector<OuiDbEntry> entries;
+    std::string names(1, '\0');
+    std::unordered_map<std::string, uint32_t> name_offsets;
+    for (const auto& [key, a] : table) {
+        auto it = name_offsets.find(a.name);
+        if (it == name_offsets.end()) {
+            it = name_offsets.emplace(a.name, static_cast<uint32_t>(names.size())).first;
+            names += a.name;
+            names += '\0';
+        }
+        OuiDbEntry entry = {};
+        entry.prefix = a.prefix;
+        entry.bits = a.bits;
+        entry.tag = a.tag;
+        entry.name_offset = it->second;
+        entries.push_back(entry);
+    }
+
+    OuiDbHeader header = {};
+    memcpy(header.magic, OUI_DB_MAGIC, sizeof(header.magic));
+    header.version = OUI_DB_VERSION;
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    header.entries_offset = sizeof(header);
+    header.names_offset = static_cast<uint32_t>(sizeof(header) + entries.size() * sizeof(OuiDbEntry));
+    header.names_size = static_cast<uint32_t>(names.size());
+
+    std::string tmp = std::string(output) + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(OuiDbEntry));
+    out.write(names.data(), names.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), output) != 0) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+
+    size_t tagged = std::count_if(entries.begin(), entries.end(), [](const OuiDbEntry& e) { return e.tag != OUI_TAG_NONE; });
+    std::cout << "Wrote " << entries.size() << " assignments (" << tagged << " virtualization-tagged) to " << output << std::endl;
+    return 0;
+}
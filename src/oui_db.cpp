@@ -0,0 +1,86 @@
+#include "oui_db.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char* ouiTagName(uint8_t tag) {
+    static const char* const names[OUI_TAG_COUNT] = {
+        "", "VMware", "VirtualBox", "QEMU/KVM", "Hyper-V", "Xen", "Parallels"
+    };
+    return tag < OUI_TAG_COUNT ? names[tag] : "";
+}
+
+OuiDatabase::~OuiDatabase() {
+    if (map_) munmap(map_, map_size_);
+}
+
+bool OuiDatabase::open(const char* path) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(OuiDbHeader)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const OuiDbHeader* header = static_cast<const OuiDbHeader*>(map);
+    size_t size = st.st_size;
+    bool valid = memcmp(header->magic, OUI_DB_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == OUI_DB_VERSION &&
+                 header->entries_offset % alignof(OuiDbEntry) == 0 &&
+                 header->entries_offset + static_cast<uint64_t>(header->entry_count) * sizeof(OuiDbEntry) <= size &&
+                 static_cast<uint64_t>(header->names_offset) + header->names_size <= size &&
+                 header->names_size > 0 &&
+                 static_cast<const char*>(map)[header->names_offset + header->names_size - 1] == '\0';
+    // Checked once here so name() needs no bounds check: the blob ends in a NUL, so every
+    // offset inside it reaches one
+    if (valid) {
+        const OuiDbEntry* entries = reinterpret_cast<const OuiDbEntry*>(static_cast<const char*>(map) + header->entries_offset);
+        for (uint32_t i = 0; valid && i < header->entry_count; i++) valid = entries[i].name_offset < header->names_size;
+    }
+    if (!valid) {
+        munmap(map, size);
+        return false;
+    }
+
+    if (map_) munmap(map_, map_size_);
+    map_ = map;
+    map_size_ = size;
+    entries_ = reinterpret_cast<const OuiDbEntry*>(static_cast<const char*>(map) + header->entries_offset);
+    count_ = header->entry_count;
+    names_ = static_cast<const char*>(map) + header->names_offset;
+    return true;
+}
+
+const OuiDbEntry* OuiDatabase::find(uint64_t prefix, uint8_t bits) const {
+    uint32_t lo = 0, hi = count_;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const OuiDbEntry& e = entries_[mid];
+        if (e.prefix < prefix || (e.prefix == prefix && e.bits < bits)) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < count_ && entries_[lo].prefix == prefix && entries_[lo].bits == bits) return &entries_[lo];
+    return nullptr;
+}
+
+const OuiDbEntry* OuiDatabase::lookup(const uint8_t* mac) const {
+    if (!entries_) return nullptr;
+
+    uint64_t value = 0;
+    for (int i = 0; i < 6; i++) value = (value << 8) | mac[i];
+
+    static const uint8_t widths[] = {36, 28, 24};
+    for (uint8_t bits : widths) {
+        uint64_t mask = ~((1ull << (48 - bits)) - 1) & 0xffffffffffffull;
+        const OuiDbEntry* entry = find(value & mask, bits);
+        if (entry) return entry;
+    }
+    return nullptr;
+}
@@ -0,0 +1,82 @@
+#ifndef OUI_DB_H
+#define OUI_DB_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+    Compiled IEEE MAC address registry (MA-L/OUI, MA-M and MA-S), produced by
+    oui_compile and mapped read-only by checkMAC.
+
+    File layout, little-endian:
+        OuiDbHeader
+        OuiDbEntry[entry_count]   sorted by (prefix, bits)
+        names blob                NUL-terminated organization names
+ */
+
+#define OUI_DB_MAGIC   "VMDOUI1"
+#define OUI_DB_VERSION 1
+#define OUI_DB_PATH    "/usr/local/share/vm_detection/oui.idx"
+
+// Virtualization vendor tag stored with each assignment
+enum OuiTag : uint8_t {
+    OUI_TAG_NONE = 0,
+    OUI_TAG_VMWARE,
+    OUI_TAG_VIRTUALBOX,
+    OUI_TAG_QEMU_KVM,
+    OUI_TAG_HYPERV,
+    OUI_TAG_XEN,
+    OUI_TAG_PARALLELS,
+    OUI_TAG_COUNT
+};
+
+struct OuiDbHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t entries_offset;
+    uint32_t names_offset;
+    uint32_t names_size;
+    uint32_t reserved;
+};
+
+struct OuiDbEntry {
+    uint64_t prefix;       // assignment in the top bits of a 48-bit MAC value
+    uint8_t bits;          // 24 (MA-L), 28 (MA-M) or 36 (MA-S)
+    uint8_t tag;           // OuiTag
+    uint16_t reserved;
+    uint32_t name_offset;  // into the names blob
+};
+
+static_assert(sizeof(OuiDbHeader) == 32, "OuiDbHeader layout changed");
+static_assert(sizeof(OuiDbEntry) == 16, "OuiDbEntry layout changed");
+
+const char* ouiTagName(uint8_t tag);
+
+// Read-only view of a compiled registry
+class OuiDatabase {
+public:
+    OuiDatabase() = default;
+    ~OuiDatabase();
+    OuiDatabase(const OuiDatabase&) = delete;
+    OuiDatabase& operator=(const OuiDatabase&) = delete;
+
+    bool open(const char* path);
+    bool isOpen() const { return entries_ != nullptr; }
+    uint32_t size() const { return count_; }
+
+    // Longest matching assignment (MA-S, then MA-M, then MA-L), or null
+    const OuiDbEntry* lookup(const uint8_t* mac) const;
+    const char* name(const OuiDbEntry* entry) const { return names_ + entry->name_offset; }
+
+private:
+    const OuiDbEntry* find(uint64_t prefix, uint8_t bits) const;
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const OuiDbEntry* entries_ = nullptr;
+    uint32_t count_ = 0;
+    const char* names_ = nullptr;
+};
+
+#endif // OUI_DB_H
@@ -0,0 +1,179 @@
+#include "pci_inspect.h"
+#include <pci/pci.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+// virtio_pci_cap cfg_type values (virtio 1.x, 4.1.4)
+#define VIRTIO_PCI_CAP_COMMON_CFG   1
+#define VIRTIO_PCI_CAP_NOTIFY_CFG   2
+#define VIRTIO_PCI_CAP_ISR_CFG      3
+
+#define PCI_VENDOR_REDHAT_VIRTIO    0x1af4
+
+// PCIe device/port types that should carry AER on real hardware
+#define PCI_EXP_TYPE_ENDPOINT       0x0
+#define PCI_EXP_TYPE_ROOT_PORT      0x4
+
+// Chipsets from the 1990s that hypervisors still emulate: i440FX/PIIX3 (QEMU,
+// VirtualBox, Hyper-V gen 1) and i440BX/PIIX4 (VMware)
+static const uint32_t emulated_chipset_ids[] = {
+    0x80861237, 0x80867000, 0x80867010, 0x80867020, 0x80867113,
+    0x80867190, 0x80867191, 0x80867192,
+};
+
+// Subsystem vendors hypervisors stamp on the devices they emulate: Red Hat
+// (virtio and QEMU), VMware, VirtualBox, Xen, Microsoft (Hyper-V), Parallels
+static const uint16_t hypervisor_subsys_vendors[] = {
+    0x1af4, 0x1b36, 0x15ad, 0x80ee, 0x5853, 0x1414, 0x1ab8,
+};
+
+static bool hasExtCap(const PciFunction& function, uint16_t id) {
+    return std::find(function.ext_caps.begin(), function.ext_caps.end(), id) != function.ext_caps.end();
+}
+
+const std::vector<PciRule> pci_rules = {
+    {"subsystem-id", "hypervisor subsystem ID on another vendor's device (emulated hardware)", true,
+     [](const PciFunction& f, const SignaturePack& signatures) {
+         return f.header_type == 0 && f.subsys_vendor != f.vendor && f.subsys_vendor != 0 &&
+                (std::find(std::begin(hypervisor_subsys_vendors), std::end(hypervisor_subsys_vendors), f.subsys_vendor) !=
+                     std::end(hypervisor_subsys_vendors) ||
+                 signatures.matchPci(f.subsys_vendor, f.subsys_device) != nullptr);
+     }},
+    {"virtio-transport", "virtio 1.x common, notify and ISR vendor capabilities", true,
+     [](const PciFunction& f, const SignaturePack&) {
+         const uint8_t needed = 1 << VIRTIO_PCI_CAP_COMMON_CFG | 1 << VIRTIO_PCI_CAP_NOTIFY_CFG | 1 << VIRTIO_PCI_CAP_ISR_CFG;
+         return (f.virtio_cfg_types & needed) == needed;
+     }},
+    {"emulated-chipset", "i440FX/i440BX/PIIX chipset function", true,
+     [](const PciFunction& f, const SignaturePack&) {
+         uint32_t id = static_cast<uint32_t>(f.vendor) << 16 | f.device;
+         return std::find(std::begin(emulated_chipset_ids), std::end(emulated_chipset_ids), id) != std::end(emulated_chipset_ids);
+     }},
+    {"pcie-without-pm", "PCIe function without the power management capability the spec requires", false,
+     [](const PciFunction& f, const SignaturePack&) {
+         return f.pcie && f.header_type == 0 && !f.caps[PCI_CAP_ID_PM];
+     }},
+    {"pcie-without-aer", "PCIe endpoint or root port with extended capabilities but no AER", false,
+     [](const PciFunction& f, const SignaturePack&) {
+         return f.pcie && f.config_size >= 4096 && !f.ext_caps.empty() && !hasExtCap(f, PCI_EXT_CAP_ID_ERR) &&
+                (f.pcie_type == PCI_EXP_TYPE_ENDPOINT || f.pcie_type == PCI_EXP_TYPE_ROOT_PORT);
+     }},
+    {"empty-extended-config", "PCIe function with an empty extended configuration space", false,
+     [](const PciFunction& f, const SignaturePack&) {
+         return f.pcie && f.config_size >= 4096 && f.ext_caps.empty();
+     }},
+    {"no-bars", "endpoint that decodes no memory or I/O (bridges and host bridges excepted)", false,
+     [](const PciFunction& f, const SignaturePack&) {
+         return f.header_type == 0 && (f.device_class >> 8) != 0x06 &&
+                std::all_of(std::begin(f.bar_size), std::end(f.bar_size), [](uint64_t size) { return size == 0; });
+     }},
+};
+
+std::vector<const PciRule*> matchPciRules(const PciFunction& function, const SignaturePack& signatures, bool& flagged) {
+    std::vector<const PciRule*> matched;
+    int weak = 0;
+    flagged = false;
+    for (const auto& rule : pci_rules) {
+        if (!rule.match(function, signatures)) continue;
+        matched.push_back(&rule);
+        if (rule.strong) flagged = true;
+        else weak++;
+    }
+    flagged = flagged || weak >= 2;
+    return matched;
+}
+
+// Walks the standard and (with 4 KiB of config) extended capability lists in the cached block
+static void decodeCapabilities(const uint8_t* config, int len, PciFunction& function) {
+    const uint16_t status = static_cast<uint16_t>(config[0x06] | config[0x07] << 8);
+    if (status & 0x10) {
+        int pos = config[function.header_type == 2 ? 0x14 : 0x34];
+        // 48 entries at most fit between 0x40 and 0x100; the bound also stops loops
+        for (int i = 0; i < 48 && pos >= 0x40 && pos + 4 <= len; i++) {
+            pos &= ~3;
+            uint8_t id = config[pos];
+            function.caps.set(id);
+            if (id == PCI_CAP_ID_EXP) {
+                function.pcie = true;
+                function.pcie_type = (config[pos + 2] >> 4) & 0xf;
+            } else if (id == PCI_CAP_ID_VNDR && function.vendor == PCI_VENDOR_REDHAT_VIRTIO && config[pos + 2] >= 16) {
+                uint8_t cfg_type = config[pos + 3];
+                if (cfg_type < 8) function.virtio_cfg_types |= static_cast<uint8_t>(1 << cfg_type);
+            }
+            pos = config[pos + 1];
+        }
+    }
+
+    if (!function.pcie || len < 4096) return;
+    int pos = 0x100;
+    for (int i = 0; i < 960 && pos >= 0x100 && pos + 4 <= len; i++) {
+        uint32_t header;
+        memcpy(&header, config + pos, sizeof(header));
+        if (header == 0 || header == 0xffffffff) break;
+        function.ext_caps.push_back(static_cast<uint16_t>(header & 0xffff));
+        pos = (header >> 20) & ~3;
+    }
+}
+
+// Unprivileged sysfs reads stop at 64 bytes, so every function fails the larger sizes
+static void quietWarning(char*, ...) {}
+
+bool scanPciFunctions(std::vector<PciFunction>& functions, std::string& error) {
+    functions.clear();
+    // libpci's error handler exits the process, so make sure its sysfs scan can work first
+    struct stat st;
+    if (stat("/sys/bus/pci/devices", &st) != 0) {
+        error = "no /sys/bus/pci/devices";
+        return false;
+    }
+
+    struct pci_access* pacc = pci_alloc();
+    pacc->method = PCI_ACCESS_SYS_BUS_PCI;
+    pacc->warning = quietWarning;
+    pci_init(pacc);
+    pci_scan_bus(pacc);
+
+    static const int sizes[] = {4096, 256, 64};
+    size_t first_size = 0;   // drops to 64 for good once we learn we are unprivileged
+    static uint8_t config[4096];
+
+    for (struct pci_dev* dev = pacc->devices; dev; dev = dev->next) {
+        pci_fill_info(dev, PCI_FILL_IDENT | PCI_FILL_CLASS | PCI_FILL_BASES | PCI_FILL_SIZES);
+        PciFunction& function = functions.emplace_back();
+        char slot[16];
+        snprintf(slot, sizeof(slot), "%04x:%02x:%02x.%d", dev->domain, dev->bus, dev->dev, dev->func);
+        function.slot = slot;
+        function.vendor = dev->vendor_id;
+        function.device = dev->device_id;
+        function.device_class = dev->device_class;
+        for (int i = 0; i < 6; i++) function.bar_size[i] = dev->size[i];
+
+        // PCIe functions have 4 KiB of config space, conventional PCI 256 bytes
+        int len = 0;
+        for (size_t i = first_size; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            if (pci_read_block(dev, 0, config, sizes[i])) {
+                len = sizes[i];
+                if (len == 64) first_size = i;
+                break;
+            }
+        }
+        function.config_size = len;
+        if (len < 64) continue;
+        pci_setup_cache(dev, config, len);
+
+        function.revision = pci_read_byte(dev, PCI_REVISION_ID);
+        function.header_type = pci_read_byte(dev, PCI_HEADER_TYPE) & 0x7f;
+        if (function.header_type == 0) {
+            function.subsys_vendor = pci_read_word(dev, PCI_SUBSYSTEM_VENDOR_ID);
+            function.subsys_device = pci_read_word(dev, PCI_SUBSYSTEM_ID);
+        }
+        decodeCapabilities(config, len, function);
+        // The buffer is reused for the next function
+        pci_setup_cache(dev, nullptr, 0);
+    }
+
+    pci_cleanup(pacc);
+    return true;
+}
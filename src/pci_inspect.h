@@ -0,0 +1,55 @@
+#ifndef PCI_INSPECT_H
+#define PCI_INSPECT_H
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sigpack.h"
+
+// One PCI function as decoded from a single read of its configuration space
+struct PciFunction {
+    std::string slot;                // "0000:00:03.0"
+    uint16_t vendor = 0;
+    uint16_t device = 0;
+    uint16_t subsys_vendor = 0;      // header type 0 only
+    uint16_t subsys_device = 0;
+    uint16_t device_class = 0;       // base class << 8 | subclass
+    uint8_t revision = 0;
+    uint8_t header_type = 0;         // without the multi-function bit
+    uint64_t bar_size[6] = {};
+    int config_size = 0;             // bytes we could read: 64 unprivileged, 256 or 4096 as root
+    bool pcie = false;
+    uint8_t pcie_type = 0;           // device/port type from the PCIe capability
+    std::bitset<256> caps;           // standard capability IDs present
+    std::vector<uint16_t> ext_caps;  // extended capability IDs, needs config_size 4096
+    uint8_t virtio_cfg_types = 0;    // bit n: a virtio vendor capability with cfg_type n
+};
+
+/**
+    One heuristic over a decoded function. Strong rules are enough on their
+    own to call the function virtual; weak ones only count when a second
+    weak rule agrees.
+ */
+struct PciRule {
+    const char* name;
+    const char* description;
+    bool strong;
+    bool (*match)(const PciFunction& function, const SignaturePack& signatures);
+};
+
+extern const std::vector<PciRule> pci_rules;
+
+/**
+    Enumerates every PCI function with one libpci pci_scan_bus pass over
+    sysfs. Each function's config space is read once as a block and handed
+    to libpci with pci_setup_cache, so capability walks and every later
+    config access come from that buffer instead of separate reads. Cost is
+    one or two reads per function, linear in the number of functions.
+ */
+bool scanPciFunctions(std::vector<PciFunction>& functions, std::string& error);
+
+// Rules a function matches; flagged when one of them is strong or two are weak
+std::vector<const PciRule*> matchPciRules(const PciFunction& function, const SignaturePack& signatures, bool& flagged);
+
+#endif // PCI_INSPECT_H
@@ -0,0 +1,119 @@
+#include "perf_counters.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+bool perf_counters_enabled = false;
+
+static int perfEventOpen(uint32_t type, uint64_t config, int group_fd, bool exclude_kernel) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd < 0 ? 1 : 0;   // members follow the leader
+    attr.inherit = 1;                        // count forked helpers (popen, system)
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+PerfGroup::~PerfGroup() {
+    closeAll();
+}
+
+void PerfGroup::closeAll() {
+    for (int& fd : fds_) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    leader_ = -1;
+    members_ = 0;
+}
+
+bool PerfGroup::open() {
+    struct Event { int id; uint32_t type; uint64_t config; };
+    static const Event events[] = {
+        {EVENT_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {EVENT_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {EVENT_TASK_CLOCK, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {EVENT_CONTEXT_SWITCHES, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {EVENT_PAGE_FAULTS, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    };
+
+    // perf_event_paranoid >= 2 refuses kernel counting to unprivileged users
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool exclude_kernel = attempt == 1;
+        closeAll();
+        hardware_ = false;
+        for (int& slot : slot_) slot = -1;
+
+        for (const Event& event : events) {
+            int fd = perfEventOpen(event.type, event.config, leader_, exclude_kernel);
+            if (fd < 0) {
+                // No virtual PMU: the group is built from software events alone
+                if (event.type == PERF_TYPE_HARDWARE) continue;
+                break;
+            }
+            if (leader_ < 0) leader_ = fd;
+            fds_[event.id] = fd;
+            slot_[event.id] = members_++;
+            if (event.type == PERF_TYPE_HARDWARE) hardware_ = true;
+        }
+        if (slot_[EVENT_TASK_CLOCK] >= 0 && slot_[EVENT_CONTEXT_SWITCHES] >= 0 && slot_[EVENT_PAGE_FAULTS] >= 0)
+            return true;
+    }
+    closeAll();
+    return false;
+}
+
+bool PerfGroup::start() {
+    if (!tried_) {
+        tried_ = true;
+        open();
+    }
+    if (leader_ < 0) return false;
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    // A reset does not clear counts folded in from exited children, so measure deltas
+    if (!readGroup(baseline_)) {
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        return false;
+    }
+    return true;
+}
+
+bool PerfGroup::readGroup(uint64_t* values) {
+    // nr, time_enabled, time_running, then one value per member in open order
+    ssize_t n = read(leader_, values, sizeof(uint64_t) * (3 + EVENT_COUNT));
+    return n >= static_cast<ssize_t>((3 + members_) * sizeof(uint64_t)) && values[0] == static_cast<uint64_t>(members_);
+}
+
+void PerfGroup::stop(ProbeCounters& counters) {
+    counters = ProbeCounters();
+    if (leader_ < 0) return;
+    uint64_t values[3 + EVENT_COUNT];
+    bool ok = readGroup(values);
+    ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (!ok) return;
+
+    uint64_t enabled = values[1] - baseline_[1], running = values[2] - baseline_[2];
+    auto value = [&](int event) -> uint64_t {
+        if (slot_[event] < 0) return 0;
+        uint64_t raw = values[3 + slot_[event]] - baseline_[3 + slot_[event]];
+        if (running == 0 || running >= enabled) return raw;
+        return static_cast<uint64_t>(static_cast<double>(raw) * enabled / running);
+    };
+
+    counters.ok = true;
+    counters.hardware = hardware_;
+    counters.scaled = running > 0 && running < enabled;
+    counters.cycles = value(EVENT_CYCLES);
+    counters.instructions = value(EVENT_INSTRUCTIONS);
+    counters.context_switches = value(EVENT_CONTEXT_SWITCHES);
+    counters.page_faults = value(EVENT_PAGE_FAULTS);
+    counters.task_clock_ns = value(EVENT_TASK_CLOCK);
+}
@@ -0,0 +1,52 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+// Counters collected around one probe run (see -P)
+struct ProbeCounters {
+    bool ok = false;
+    bool hardware = false;          // cycles/instructions came from the PMU
+    bool scaled = false;            // the group was multiplexed, values extrapolated
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t context_switches = 0;
+    uint64_t page_faults = 0;
+    uint64_t task_clock_ns = 0;
+};
+
+// Wrap every probe in a counter group, settable with -P
+extern bool perf_counters_enabled;
+
+/**
+    One perf_event_open group on the calling thread: cycles and instructions
+    when the PMU is available (often not in guests), plus the software
+    context-switch, page-fault and task-clock events. Helpers forked by a
+    probe are counted once they exit. The group is opened on the first
+    start() and reused, so each probe costs two ioctls and two reads.
+ */
+class PerfGroup {
+public:
+    ~PerfGroup();
+
+    // False if even the software events cannot be opened
+    bool start();
+    void stop(ProbeCounters& counters);
+
+private:
+    bool open();
+    void closeAll();
+    bool readGroup(uint64_t* values);
+
+    enum { EVENT_CYCLES, EVENT_INSTRUCTIONS, EVENT_CONTEXT_SWITCHES, EVENT_PAGE_FAULTS, EVENT_TASK_CLOCK, EVENT_COUNT };
+
+    int fds_[EVENT_COUNT] = {-1, -1, -1, -1, -1};
+    int slot_[EVENT_COUNT] = {};    // position of each event in the group read, -1 if absent
+    uint64_t baseline_[3 + EVENT_COUNT] = {};
+    int leader_ = -1;
+    int members_ = 0;
+    bool tried_ = false;
+    bool hardware_ = false;
+};
+
+#endif // PERF_COUNTERS_H
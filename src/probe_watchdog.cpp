@@ -0,0 +1,221 @@
+#include "probe_watchdog.h"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// How long to wait for a helper we could not kill (a setuid sudo child) before leaving it unreaped
+#define HELPER_REAP_GRACE_MS 500
+
+extern char** environ;
+
+unsigned int probe_timeout_ms = 10000;
+
+using Clock = std::chrono::steady_clock;
+
+// Shared with the watchdog thread, guarded by mutex
+struct WatchState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool armed = false;
+    uint64_t generation = 0;
+    Clock::time_point deadline;
+    std::string probe_name;
+    pid_t helper_group = 0;
+    std::vector<std::pair<std::string, bool>> finished;
+};
+
+// Never destroyed: the detached watchdog thread still waits on the condition
+// variable at exit, and destroying a waited-on condition variable blocks
+static WatchState& state() {
+    static WatchState* watch = new WatchState;
+    return *watch;
+}
+
+static std::atomic<bool> cancelled{false};
+
+// The budget as seen by the probe's own thread
+static thread_local bool has_deadline = false;
+static thread_local Clock::time_point probe_deadline;
+
+[[noreturn]] static void giveUp(const WatchState& watch) {
+    std::cerr << "\n[watchdog] probe \"" << watch.probe_name << "\" is still running " << PROBE_HARD_GRACE_MS
+              << " ms past its " << probe_timeout_ms << " ms budget; exiting with the results so far" << std::endl;
+    for (const auto& [name, detected] : watch.finished)
+        std::cerr << "  " << name << ": " << (detected ? "Detected" : "Not Detected") << std::endl;
+    std::cerr << "  " << watch.probe_name << ": Timed Out" << std::endl;
+    if (watch.helper_group > 0) kill(-watch.helper_group, SIGKILL);
+    _exit(124);
+}
+
+static void watch() {
+    WatchState& watch = state();
+    std::unique_lock<std::mutex> lock(watch.mutex);
+    while (true) {
+        watch.cv.wait(lock, [&watch] { return watch.armed; });
+        uint64_t current = watch.generation;
+        auto done = [&watch, current] { return !watch.armed || watch.generation != current; };
+        if (watch.cv.wait_until(lock, watch.deadline, done)) continue;
+
+        // Out of time: loops see the flag, helpers are killed
+        cancelled.store(true, std::memory_order_relaxed);
+        if (watch.helper_group > 0) kill(-watch.helper_group, SIGKILL);
+
+        if (watch.cv.wait_until(lock, watch.deadline + std::chrono::milliseconds(PROBE_HARD_GRACE_MS), done)) continue;
+        giveUp(watch);
+    }
+}
+
+void armProbeDeadline(const std::string& name) {
+    if (probe_timeout_ms == 0) return;
+    static std::once_flag started;
+    std::call_once(started, [] { std::thread(watch).detach(); });
+
+    WatchState& watch = state();
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    probe_deadline = Clock::now() + std::chrono::milliseconds(probe_timeout_ms);
+    has_deadline = true;
+    cancelled.store(false, std::memory_order_relaxed);
+    watch.deadline = probe_deadline;
+    watch.probe_name = name;
+    watch.armed = true;
+    watch.generation++;
+    watch.cv.notify_one();
+}
+
+bool disarmProbeDeadline(bool detected) {
+    if (!has_deadline) return false;
+    has_deadline = false;
+    bool timed_out = cancelled.load(std::memory_order_relaxed) || Clock::now() > probe_deadline;
+
+    WatchState& watch = state();
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    watch.finished.emplace_back(watch.probe_name, detected);
+    watch.armed = false;
+    watch.cv.notify_one();
+    return timed_out;
+}
+
+void beginWatchedScan() {
+    WatchState& watch = state();
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    watch.finished.clear();
+}
+
+bool probeCancelled() {
+    return has_deadline && cancelled.load(std::memory_order_relaxed);
+}
+
+int probeRemainingMs() {
+    if (!has_deadline) return -1;
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(probe_deadline - Clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+static void setHelperGroup(pid_t group) {
+    WatchState& watch = state();
+    std::lock_guard<std::mutex> lock(watch.mutex);
+    watch.helper_group = group;
+}
+
+HelperStatus runHelper(const std::vector<std::string>& argv, std::string& output) {
+    output.clear();
+    int pipefd[2];
+    if (argv.empty() || pipe2(pipefd, O_CLOEXEC) != 0) return HELPER_NOT_RUN;
+
+    std::vector<char*> args;
+    for (const auto& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+
+    // posix_spawn instead of fork: no copy of our address space, and exec failures are reported
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t defaults, empty;
+    sigemptyset(&empty);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid;
+    int spawned = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(pipefd[1]);
+    if (spawned != 0) {
+        close(pipefd[0]);
+        return HELPER_NOT_RUN;
+    }
+    if (has_deadline) setHelperGroup(pid);
+
+    bool timed_out = false;
+    char buf[4096];
+    while (true) {
+        int timeout = probeRemainingMs();
+        struct pollfd pfd = {pipefd[0], POLLIN, 0};
+        int ready = timeout == 0 ? 0 : poll(&pfd, 1, timeout);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready == 0) {
+            timed_out = true;
+            break;
+        }
+        if (ready < 0) break;
+        ssize_t n = read(pipefd[0], buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        output.append(buf, static_cast<size_t>(n));
+    }
+    close(pipefd[0]);
+
+    // Wait for the leader without reaping it, so its group ID cannot be reused while we kill stragglers
+    siginfo_t info;
+    bool exited = false;
+    while (!timed_out) {
+        info.si_pid = 0;
+        if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0 && errno != EINTR) break;
+        exited = info.si_pid == pid;
+        if (exited) break;
+        if (probeRemainingMs() == 0) timed_out = true;
+        else usleep(2000);
+    }
+    // A setuid leader (sudo) refuses our signal; once it has exited, reaping it cannot block
+    bool killed = kill(-pid, SIGKILL) == 0 || errno != EPERM || exited;
+    if (has_deadline) setHelperGroup(0);
+
+    int status = 0;
+    if (killed) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    } else {
+        // Its pipe is closed already, so a helper that only waited on output sees EPIPE and exits
+        std::cerr << "[watchdog] could not kill helper " << argv[0] << " (pid " << pid << "): " << strerror(EPERM) << std::endl;
+        pid_t reaped = 0;
+        for (int waited = 0; waited < HELPER_REAP_GRACE_MS; waited += 2) {
+            reaped = waitpid(pid, &status, WNOHANG);
+            if (reaped != 0 && !(reaped < 0 && errno == EINTR)) break;
+            usleep(2000);
+        }
+        if (reaped == 0) std::cerr << "[watchdog] helper " << argv[0] << " (pid " << pid << ") still running; left unreaped" << std::endl;
+        if (reaped <= 0) return timed_out ? HELPER_TIMED_OUT : HELPER_FAILED;
+    }
+    if (timed_out) return HELPER_TIMED_OUT;
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) return HELPER_OK;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 127 ? HELPER_NOT_RUN : HELPER_FAILED;
+}
@@ -0,0 +1,50 @@
+#ifndef PROBE_WATCHDOG_H
+#define PROBE_WATCHDOG_H
+
+#include <string>
+#include <vector>
+
+// Time budget of each probe in milliseconds, settable with -T (0 disables the watchdog)
+extern unsigned int probe_timeout_ms;
+
+// How long a probe may keep running past its budget before the process gives up on it
+#define PROBE_HARD_GRACE_MS 2000
+
+/**
+    Starts the budget of a probe about to run on this thread. When it runs
+    out, a watchdog thread sets the cancel flag and kills the probe's helper
+    process group. A probe still running PROBE_HARD_GRACE_MS later cannot be
+    stopped from outside, so the watchdog prints the verdicts of the scan so
+    far and exits with status 124: the scan's latency stays bounded.
+ */
+void armProbeDeadline(const std::string& name);
+
+// Ends the running probe's budget and records its verdict; true if it ran out of time
+bool disarmProbeDeadline(bool detected);
+
+// Forgets the verdicts of the previous scan
+void beginWatchedScan();
+
+// True once the running probe's budget has run out; a relaxed atomic load, fine in inner loops
+bool probeCancelled();
+
+// Milliseconds left in the running probe's budget, -1 without one
+int probeRemainingMs();
+
+enum HelperStatus {
+    HELPER_OK,          // exited with status 0
+    HELPER_FAILED,      // exited non-zero or died from a signal
+    HELPER_NOT_RUN,     // could not be started, e.g. not installed
+    HELPER_TIMED_OUT,   // killed at the probe's deadline
+};
+
+/**
+    Runs argv[0] from PATH without a shell, capturing its stdout into output.
+    stdin and stderr are /dev/null, so "sudo -n" fails at once instead of
+    waiting on a password prompt. The helper leads its own process group,
+    which is SIGKILLed at the running probe's deadline and always reaped;
+    anything it left behind in the group is killed after it exits.
+ */
+HelperStatus runHelper(const std::vector<std::string>& argv, std::string& output);
+
+#endif // PROBE_WATCHDOG_H
@@ -0,0 +1,123 @@
+/**
+    Benchmark for the shared file reader (make bench). Reads the files the
+    probes read, the way they read them, and counts heap allocations per
+    pass with a replaced global operator new. After one warm-up pass has
+    grown the buffers, every pass must allocate nothing; the same reads
+    through std::ifstream and std::getline are timed alongside for
+    comparison. Exits non-zero if the steady state allocates.
+ */
+#include "file_reader.h"
+#include "batch_reader.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static const char* const proc_files[] = {"/proc/cpuinfo", "/proc/stat", "/proc/modules", "/proc/self/status"};
+static const char* const dmi_files[] = {"sys_vendor", "product_name", "product_version", "board_vendor",
+                                        "bios_vendor", "product_family", "uevent", "modalias"};
+
+static uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// The procfs files line by line; returns a checksum so nothing is optimized out
+static uint64_t procPass(FileReader& file) {
+    uint64_t sum = 0;
+    std::string_view line;
+    for (const char* path : proc_files) {
+        if (!file.read(path)) continue;
+        LineScanner lines(file.data());
+        while (lines.next(line)) sum += line.size();
+    }
+    return sum;
+}
+
+// One scan's worth of reads through the shared reader
+static uint64_t readerPass(FileReader& file, BatchReader& batch, int dmi_dir, int pci_dir) {
+    uint64_t sum = procPass(file);
+    if (dmi_dir >= 0) {
+        batch.clear();
+        for (const char* name : dmi_files) batch.add(dmi_dir, name);
+        batch.run();
+        for (size_t i = 0; i < batch.size(); i++) sum += batch.data(i).size();
+    }
+    if (pci_dir >= 0) {
+        lseek(pci_dir, 0, SEEK_SET);
+        DirScanner devices(pci_dir);
+        const char* name;
+        char path[128];
+        while (devices.next(name)) {
+            snprintf(path, sizeof(path), "%s/vendor", name);
+            if (file.readAt(pci_dir, path)) sum += trim(file.data()).size();
+        }
+    }
+    return sum;
+}
+
+// The same procfs reads the way the probes did them before the shared reader
+static uint64_t streamPass() {
+    uint64_t sum = 0;
+    for (const char* path : proc_files) {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) sum += line.size();
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[]) {
+    int passes = argc > 1 ? atoi(argv[1]) : 1000;
+    if (passes <= 0) {
+        fprintf(stderr, "Usage: reader_bench [passes]\n");
+        return 2;
+    }
+    FileReader file;
+    BatchReader batch;
+    int dmi_dir = openDirectory("/sys/class/dmi/id");
+    int pci_dir = openDirectory("/sys/bus/pci/devices");
+
+    uint64_t sum = readerPass(file, batch, dmi_dir, pci_dir);  // warm-up: buffers grow to fit
+
+    uint64_t before = allocations.load();
+    uint64_t start = monotonicNs();
+    for (int i = 0; i < passes; i++) sum += readerPass(file, batch, dmi_dir, pci_dir);
+    uint64_t reader_ns = monotonicNs() - start;
+    uint64_t reader_allocs = allocations.load() - before;
+
+    start = monotonicNs();
+    for (int i = 0; i < passes; i++) sum += procPass(file);
+    uint64_t proc_ns = monotonicNs() - start;
+
+    before = allocations.load();
+    start = monotonicNs();
+    for (int i = 0; i < passes; i++) sum += streamPass();
+    uint64_t stream_ns = monotonicNs() - start;
+    uint64_t stream_allocs = allocations.load() - before;
+
+    printf("shared reader, all files:     %8.1f us/pass, %6.2f allocations/pass\n", reader_ns / 1e3 / passes,
+           static_cast<double>(reader_allocs) / passes);
+    printf("shared reader, procfs only:   %8.1f us/pass\n", proc_ns / 1e3 / passes);
+    printf("ifstream/getline, procfs only:%8.1f us/pass, %6.2f allocations/pass\n", stream_ns / 1e3 / passes,
+           static_cast<double>(stream_allocs) / passes);
+    printf("(checksum %llu)\n", static_cast<unsigned long long>(sum));
+    if (dmi_dir >= 0) close(dmi_dir);
+    if (pci_dir >= 0) close(pci_dir);
+    return reader_allocs == 0 ? 0 : 1;
+}
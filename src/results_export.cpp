@@ -0,0 +1,120 @@
+#include "results_export.h"
+#include "vm_results_shm.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <time.h>
+
+static_assert(sizeof(vmd_probe_sample) == 16, "vmd_probe_sample layout changed");
+static_assert(sizeof(vmd_probe_slot) == 1072, "vmd_probe_slot layout changed");
+static_assert(offsetof(vmd_results, probes) == 56, "vmd_results header layout changed");
+
+static vmd_results* shm = nullptr;
+// Kept open for the writer's flock until the process exits
+static int shm_fd = -1;
+
+static uint64_t realtimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+bool openResultsExport(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open results segment " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    // The seqlock allows one writer; a second one would interleave sequence bumps and tear records
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        if (errno == EWOULDBLOCK) std::cerr << "Results segment " << path << " is already published by another process" << std::endl;
+        else std::cerr << "Failed to lock results segment " << path << ": " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    if (ftruncate(fd, sizeof(vmd_results)) != 0) {
+        std::cerr << "Failed to size results segment: " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, sizeof(vmd_results), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "Failed to map results segment: " << strerror(errno) << std::endl;
+        close(fd);
+        return false;
+    }
+    shm = static_cast<vmd_results*>(map);
+    shm_fd = fd;
+
+    // Start fresh if the segment is new or was written by another layout version.
+    // The magic is stored last so readers never see a half-initialized header.
+    if (shm->magic != VMD_RESULTS_MAGIC || shm->version != VMD_RESULTS_VERSION) {
+        __atomic_store_n(&shm->magic, 0, __ATOMIC_RELAXED);
+        memset(shm, 0, sizeof(vmd_results));
+        shm->version = VMD_RESULTS_VERSION;
+        shm->header_size = offsetof(vmd_results, probes);
+        shm->total_size = sizeof(vmd_results);
+        shm->probe_slot_size = sizeof(vmd_probe_slot);
+        __atomic_store_n(&shm->magic, VMD_RESULTS_MAGIC, __ATOMIC_RELEASE);
+    }
+    shm->writer_pid = static_cast<uint32_t>(getpid());
+    return true;
+}
+
+// Finds the slot for a probe, claiming a free one the first time it is seen
+static vmd_probe_slot* findSlot(const std::string& name) {
+    for (uint32_t i = 0; i < shm->probe_count; i++) {
+        if (strncmp(shm->probes[i].name, name.c_str(), VMD_RESULTS_NAME_LEN) == 0)
+            return &shm->probes[i];
+    }
+    if (shm->probe_count == VMD_RESULTS_MAX_PROBES) return nullptr;
+
+    vmd_probe_slot* slot = &shm->probes[shm->probe_count++];
+    strncpy(slot->name, name.c_str(), VMD_RESULTS_NAME_LEN - 1);
+    return slot;
+}
+
+void publishResults(const std::map<std::string, ProbeResult>& results) {
+    if (!shm) return;
+    uint64_t now = realtimeNs();
+
+    // Seqlock write side: odd sequence while the segment is inconsistent
+    __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    for (const auto& [name, result] : results) {
+        vmd_probe_slot* slot = findSlot(name);
+        if (!slot) continue;
+
+        vmd_probe_sample sample = {};
+        sample.timestamp_ns = now;
+        sample.elapsed_us = static_cast<uint32_t>(result.elapsed_ns / 1000);
+        sample.detected = result.detected ? 1 : 0;
+        sample.timed_out = result.timed_out ? 1 : 0;
+
+        slot->latest = sample;
+        slot->history[slot->history_head % VMD_RESULTS_HISTORY] = sample;
+        slot->history_head++;
+    }
+
+    uint32_t detected = 0;
+    for (uint32_t i = 0; i < shm->probe_count; i++)
+        detected += shm->probes[i].latest.detected;
+
+    shm->scan_count++;
+    shm->last_scan_ns = now;
+    shm->detected_count = detected;
+    shm->verdict = detected > 0 ? 1 : 0;
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,14 @@
+#ifndef RESULTS_EXPORT_H
+#define RESULTS_EXPORT_H
+
+#include <map>
+#include <string>
+#include "vm_detection.h"
+
+// Maps (creating if needed) the shared results segment at path
+bool openResultsExport(const std::string& path);
+
+// Publishes the probes of the last scan into the segment, if one is open
+void publishResults(const std::map<std::string, ProbeResult>& results);
+
+#endif // RESULTS_EXPORT_H
@@ -0,0 +1,276 @@
+#include "scan_budget.h"
+#include "file_reader.h"
+#include "probe_watchdog.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+bool budget_enabled = false;
+double budget_cpu_pct = 2.0;
+unsigned int budget_exits_per_sec = 20000;
+
+namespace {
+
+// Refills at rate per second up to burst; usage drives the level negative
+struct Bucket {
+    double rate = 0.0;
+    double burst = 0.0;
+    double level = 0.0;
+
+    void refill(double seconds) { level = std::min(burst, level + rate * seconds); }
+    // Seconds until the level is back to zero
+    double deficit() const { return level < 0.0 ? -level / rate : 0.0; }
+};
+
+// Usage since beginBudgetWindow
+struct Window {
+    uint64_t wall_ns = 0;
+    uint64_t cpu_ns = 0;
+    uint64_t exits = 0;
+    uint64_t sleep_ns = 0;
+    uint64_t throttles = 0;
+    uint64_t cutoffs = 0;
+};
+
+// Held across the pacing sleep too, so parallel workers queue on one budget
+std::mutex pace_mutex;
+Bucket cpu_bucket;      // CPU seconds
+Bucket exit_bucket;     // exits
+double cpu_share = 0.0; // fraction of one CPU after the cgroup quota
+uint64_t last_wall_ns = 0;
+uint64_t last_cpu_ns = 0;
+Window window;
+
+double cgroup_cpus = 0.0;        // tightest cpu.max quota in CPUs, 0 if unlimited
+uint64_t cgroup_period_us = 100000;
+int cpu_stat_fd = -1;
+uint64_t last_throttled = 0;
+FileReader cpu_stat(1024);
+
+uint64_t clockNs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Our own CPU time plus that of the helpers we have reaped
+uint64_t cpuNs() {
+    struct rusage usage;
+    uint64_t children = 0;
+    if (getrusage(RUSAGE_CHILDREN, &usage) == 0) {
+        children = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ull +
+                   (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ull;
+    }
+    return clockNs(CLOCK_PROCESS_CPUTIME_ID) + children;
+}
+
+// Applies SCHED_IDLE to every thread already running; new threads inherit it
+bool enterSchedIdle(std::string& error) {
+    DIR* tasks = opendir("/proc/self/task");
+    if (!tasks) {
+        error = std::string("/proc/self/task: ") + strerror(errno);
+        return false;
+    }
+    struct sched_param param = {};
+    bool ok = true;
+    while (struct dirent* entry = readdir(tasks)) {
+        if (entry->d_name[0] == '.') continue;
+        if (sched_setscheduler(atoi(entry->d_name), SCHED_IDLE, &param) != 0 && errno != ESRCH) {
+            error = strerror(errno);
+            ok = false;
+        }
+    }
+    closedir(tasks);
+    return ok;
+}
+
+// cpu.max ("max 100000" or "50000 100000") on v2, cfs_quota_us/cfs_period_us on v1
+bool readQuota(const std::string& dir, bool v2, double& cpus, uint64_t& period_us) {
+    FileReader reader(128);
+    if (v2) {
+        if (!reader.read((dir + "/cpu.max").c_str())) return false;
+        std::string_view text = trim(reader.data());
+        size_t space = text.find(' ');
+        uint64_t quota, period;
+        if (space == std::string_view::npos || !parseUnsigned(text.substr(space + 1), period) || period == 0) return false;
+        if (!parseUnsigned(text.substr(0, space), quota)) return false;   // "max"
+        cpus = static_cast<double>(quota) / period;
+        period_us = period;
+        return true;
+    }
+    double quota;
+    uint64_t period;
+    if (!reader.read((dir + "/cpu.cfs_quota_us").c_str()) || !parseDouble(trim(reader.data()), quota) || quota <= 0) return false;
+    if (!reader.read((dir + "/cpu.cfs_period_us").c_str()) || !parseUnsigned(trim(reader.data()), period) || period == 0) return false;
+    cpus = quota / period;
+    period_us = period;
+    return true;
+}
+
+/**
+    Finds our cgroup's directory and the tightest CPU quota from it up to
+    the root: a parent's limit binds the whole subtree. Keeps cpu.stat open
+    so budgetPace can re-read nr_throttled without reopening it.
+ */
+void findCgroupQuota() {
+    FileReader self(1024);
+    if (!self.read("/proc/self/cgroup")) return;
+    LineScanner lines(self.data());
+    std::string_view line;
+    std::string root, leaf;
+    bool v2 = false;
+    // On a hybrid hierarchy the v1 cpu controller is the one that enforces quotas
+    while (lines.next(line)) {
+        // "0::/system.slice/app.service" (v2) or "4:cpu,cpuacct:/app" (v1)
+        size_t first = line.find(':');
+        size_t second = first == std::string_view::npos ? first : line.find(':', first + 1);
+        if (second == std::string_view::npos) continue;
+        std::string_view controllers = line.substr(first + 1, second - first - 1);
+        std::string_view path = line.substr(second + 1);
+        if (controllers.empty() && line.substr(0, first) == "0") {
+            root = "/sys/fs/cgroup";
+            leaf = root + std::string(path);
+            v2 = true;
+            continue;
+        }
+        std::string list = "," + std::string(controllers) + ",";
+        if (list.find(",cpu,") != std::string::npos) {
+            root = access("/sys/fs/cgroup/cpu,cpuacct", F_OK) == 0 ? "/sys/fs/cgroup/cpu,cpuacct" : "/sys/fs/cgroup/cpu";
+            leaf = root + std::string(path);
+            v2 = false;
+            break;
+        }
+    }
+    if (leaf.empty()) return;
+    while (leaf.size() > 1 && leaf.back() == '/') leaf.pop_back();
+
+    for (std::string dir = leaf; dir.size() >= root.size(); dir.resize(dir.rfind('/'))) {
+        double cpus;
+        uint64_t period_us;
+        if (readQuota(dir, v2, cpus, period_us) && (cgroup_cpus == 0.0 || cpus < cgroup_cpus)) {
+            cgroup_cpus = cpus;
+            cgroup_period_us = period_us;
+        }
+    }
+    cpu_stat_fd = open((leaf + "/cpu.stat").c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+// nr_throttled from cpu.stat, false if the cgroup has no CPU controller
+bool readThrottled(uint64_t& throttled) {
+    if (cpu_stat_fd < 0 || !cpu_stat.readFd(cpu_stat_fd)) return false;
+    LineScanner lines(cpu_stat.data());
+    std::string_view line;
+    while (lines.next(line)) {
+        if (line.rfind("nr_throttled ", 0) == 0) return parseUnsigned(line.substr(13), throttled);
+    }
+    return false;
+}
+
+} // namespace
+
+bool startScanBudget() {
+    if (budget_cpu_pct <= 0.0 || budget_cpu_pct > 100.0 || budget_exits_per_sec == 0) {
+        std::cerr << "--budget: the CPU share must be in (0, 100] and the exit rate above 0" << std::endl;
+        return false;
+    }
+    std::string error;
+    bool idle = enterSchedIdle(error);
+    findCgroupQuota();
+    readThrottled(last_throttled);
+
+    cpu_share = budget_cpu_pct / 100.0;
+    if (cgroup_cpus > 0.0) cpu_share *= std::min(1.0, cgroup_cpus);
+    // 100 ms worth of budget may be spent at once; that bounds the stall anyone else sees
+    cpu_bucket.rate = cpu_share;
+    cpu_bucket.burst = cpu_bucket.level = cpu_share * 0.1;
+    exit_bucket.rate = budget_exits_per_sec;
+    exit_bucket.burst = exit_bucket.level = budget_exits_per_sec * 0.1;
+    last_wall_ns = clockNs(CLOCK_MONOTONIC);
+    last_cpu_ns = cpuNs();
+    budget_enabled = true;
+
+    std::cout << "[budget] " << budget_cpu_pct << "% of a CPU, " << budget_exits_per_sec << " exits/s, "
+              << (idle ? "SCHED_IDLE" : "SCHED_IDLE unavailable (" + error + ")") << std::endl;
+    if (cgroup_cpus > 0.0) {
+        std::cout << "[budget] cgroup CPU quota allows " << std::fixed << std::setprecision(2) << cgroup_cpus
+                  << " CPU: effective share " << cpu_share * 100.0 << "% of a CPU" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+    beginBudgetWindow();
+    return true;
+}
+
+void beginBudgetWindow() {
+    if (!budget_enabled) return;
+    std::lock_guard<std::mutex> lock(pace_mutex);
+    window = Window();
+    window.wall_ns = clockNs(CLOCK_MONOTONIC);
+    window.cpu_ns = cpuNs();
+}
+
+bool budgetPace(uint64_t exits) {
+    if (!budget_enabled) return true;
+    std::lock_guard<std::mutex> lock(pace_mutex);
+
+    uint64_t wall = clockNs(CLOCK_MONOTONIC);
+    uint64_t cpu = cpuNs();
+    double elapsed = (wall - last_wall_ns) / 1e9;
+    cpu_bucket.refill(elapsed);
+    exit_bucket.refill(elapsed);
+    cpu_bucket.level -= (cpu - last_cpu_ns) / 1e9;
+    exit_bucket.level -= static_cast<double>(exits);
+    last_wall_ns = wall;
+    last_cpu_ns = cpu;
+    window.exits += exits;
+
+    double pause = std::max(cpu_bucket.deficit(), exit_bucket.deficit());
+    // The workload hit its quota since we last looked: give it a full period back
+    uint64_t throttled;
+    if (readThrottled(throttled) && throttled > last_throttled) {
+        window.throttles += throttled - last_throttled;
+        last_throttled = throttled;
+        pause = std::max(pause, cgroup_period_us / 1e6);
+    }
+    if (pause <= 0.0) return true;
+
+    int remaining_ms = probeRemainingMs();
+    if (remaining_ms >= 0 && pause * 1000.0 >= remaining_ms) {
+        window.cutoffs++;
+        return false;
+    }
+    struct timespec ts = {static_cast<time_t>(pause), static_cast<long>((pause - static_cast<time_t>(pause)) * 1e9)};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+    window.sleep_ns += clockNs(CLOCK_MONOTONIC) - wall;
+    return true;
+}
+
+void printBudgetReport() {
+    if (!budget_enabled) return;
+    std::lock_guard<std::mutex> lock(pace_mutex);
+    double wall = (clockNs(CLOCK_MONOTONIC) - window.wall_ns) / 1e9;
+    double cpu = (cpuNs() - window.cpu_ns) / 1e9;
+    if (wall <= 0.0) return;
+    double share = cpu / wall;
+    double exit_rate = window.exits / wall;
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "[budget] " << wall << " s wall, " << cpu * 1000.0 << " ms CPU (" << share * 100.0 << "% of a CPU, "
+              << share / cpu_share * 100.0 << "% of budget), " << window.exits << " exits ("
+              << std::setprecision(0) << exit_rate << "/s, " << exit_rate / budget_exits_per_sec * 100.0 << "% of budget)"
+              << std::endl;
+    std::cout << std::setprecision(2) << "[budget] paced sleep " << window.sleep_ns / 1e9 << " s, "
+              << window.throttles << " cgroup throttles, " << window.cutoffs << " sampling loops cut short at a deadline"
+              << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,43 @@
+#ifndef SCAN_BUDGET_H
+#define SCAN_BUDGET_H
+
+#include <cstdint>
+
+// --budget: cap the scanner's CPU use and VM exit rate
+extern bool budget_enabled;
+
+// Share of one CPU the scanner may use, in percent (--budget <pct>)
+extern double budget_cpu_pct;
+
+// cpuid and other trapping instructions per second (--budget-exits <n>)
+extern unsigned int budget_exits_per_sec;
+
+// Timing-loop iterations in budget mode, instead of the full million
+#define BUDGET_TIMING_ITERATIONS 32768
+
+/**
+    Enters budget mode: every thread of the process moves to SCHED_IDLE, so
+    the scanner only runs when nothing else wants the CPU, and the cgroup's
+    cpu.max quota (tightest one up the hierarchy) scales the CPU share down
+    so it is a share of what the workload is allowed rather than of a whole
+    CPU. Prints what took effect.
+ */
+bool startScanBudget();
+
+// Starts a new accounting window for the usage report
+void beginBudgetWindow();
+
+/**
+    Charges exits to the budget and sleeps until both the CPU share and the
+    exit rate are back within it. Called between batches of work and before
+    each probe; when the cgroup was throttled since the last call it also
+    backs off for one cpu.max period. Returns false without sleeping when
+    the sleep would outlast the running probe's deadline, so the caller can
+    stop sampling and report what it has. No-op outside budget mode.
+ */
+bool budgetPace(uint64_t exits);
+
+// Prints CPU, exits, paced sleep and throttling since beginBudgetWindow
+void printBudgetReport();
+
+#endif // SCAN_BUDGET_H
@@ -0,0 +1,596 @@
+#include "scan_history.h"
+#include "file_reader.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+
+static_assert(sizeof(vmd_history_header) == 64, "vmd_history_header layout changed");
+static_assert(sizeof(vmd_history_record) == 88, "vmd_history_record layout changed");
+static_assert(offsetof(vmd_history_record, checksum) == 40, "vmd_history_record layout changed");
+static_assert(sizeof(vmd_history_probe) == 40, "vmd_history_probe layout changed");
+static_assert(sizeof(vmd_history_index_header) == 32, "vmd_history_index_header layout changed");
+static_assert(sizeof(vmd_history_index_entry) == 24, "vmd_history_index_entry layout changed");
+
+uint64_t history_max_bytes = 4 << 20;
+
+static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+static const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+static uint64_t fnv1a(const void* data, size_t len, uint64_t hash = FNV_OFFSET) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Order-independent: probes record evidence in the order they happen to find it
+static uint64_t evidenceHash(const std::vector<std::string>& evidence) {
+    std::vector<std::string> sorted = evidence;
+    std::sort(sorted.begin(), sorted.end());
+    uint64_t hash = FNV_OFFSET;
+    for (const auto& item : sorted) hash = fnv1a(item.c_str(), item.size() + 1, hash);
+    return hash;
+}
+
+// Checksum of a whole record, taken as if its checksum field were zero
+static uint64_t recordChecksum(const char* record, size_t size) {
+    static const uint8_t zero[8] = {};
+    const size_t at = offsetof(vmd_history_record, checksum);
+    uint64_t hash = fnv1a(record, at);
+    hash = fnv1a(zero, sizeof(zero), hash);
+    return fnv1a(record + at + 8, size - at - 8, hash);
+}
+
+// True if a complete, intact record starts at data (avail bytes readable)
+static bool validRecord(const char* data, uint64_t avail) {
+    if (avail < sizeof(vmd_history_record)) return false;
+    vmd_history_record record;
+    memcpy(&record, data, sizeof(record));
+    return record.magic == VMD_HISTORY_RECORD_MAGIC && record.size <= avail &&
+           record.size == sizeof(vmd_history_record) + record.probe_count * sizeof(vmd_history_probe) &&
+           record.checksum == recordChecksum(data, record.size);
+}
+
+static uint64_t realtimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+static void readBootId(uint8_t* boot_id) {
+    memset(boot_id, 0, 16);
+    FileReader file;
+    if (!file.read("/proc/sys/kernel/random/boot_id")) return;
+    size_t n = 0;
+    int high = -1;
+    for (char c : file.data()) {
+        int nibble = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (nibble < 0) continue;
+        if (high < 0) {
+            high = nibble;
+        } else {
+            boot_id[n++] = static_cast<uint8_t>(high << 4 | nibble);
+            high = -1;
+            if (n == 16) break;
+        }
+    }
+}
+
+static std::string formatTime(uint64_t ns) {
+    time_t seconds = static_cast<time_t>(ns / 1000000000ull);
+    struct tm local;
+    char text[32];
+    localtime_r(&seconds, &local);
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    return text;
+}
+
+static bool readAll(int fd, void* buf, size_t len, uint64_t offset) {
+    char* out = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t n = pread(fd, out, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        out += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void* buf, size_t len, uint64_t offset) {
+    const char* in = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t n = pwrite(fd, in, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        in += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+//==============================HistoryWindow============================
+
+HistoryWindow::~HistoryWindow() {
+    reset();
+}
+
+void HistoryWindow::reset() {
+    if (map_) munmap(map_, map_len_);
+    map_ = nullptr;
+    map_len_ = 0;
+    records_.clear();
+}
+
+//===============================ScanHistory=============================
+
+ScanHistory::~ScanHistory() {
+    close();
+}
+
+void ScanHistory::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    index_.clear();
+    last_.clear();
+}
+
+bool ScanHistory::open(const std::string& path, bool create, std::string& error) {
+    close();
+    path_ = path;
+    if (create) {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    }
+    fd_ = ::open(path.c_str(), (create ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        error = "cannot open " + path + ": " + strerror(errno);
+        return false;
+    }
+    if (create) flock(fd_, LOCK_EX);
+    bool ok = load(create, error);
+    if (create) flock(fd_, LOCK_UN);
+    return ok;
+}
+
+// Reads the header and index, then indexes (and, if writable, truncates) whatever follows them
+bool ScanHistory::load(bool writable, std::string& error) {
+    index_.clear();
+    last_.clear();
+    next_seq_ = 1;
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        error = std::string("fstat: ") + strerror(errno);
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (size == 0 && writable) {
+        header_ = {};
+        header_.magic = VMD_HISTORY_MAGIC;
+        header_.version = VMD_HISTORY_VERSION;
+        header_.header_size = sizeof(vmd_history_header);
+        header_.generation = realtimeNs();
+        if (!writeAll(fd_, &header_, sizeof(header_), 0)) {
+            error = std::string("cannot write history header: ") + strerror(errno);
+            return false;
+        }
+        size = sizeof(header_);
+    }
+    if (size < sizeof(header_) || !readAll(fd_, &header_, sizeof(header_), 0) ||
+        header_.magic != VMD_HISTORY_MAGIC || header_.version != VMD_HISTORY_VERSION ||
+        header_.header_size < sizeof(header_) || header_.header_size > size) {
+        error = path_ + " is not a scan history (version " + std::to_string(VMD_HISTORY_VERSION) + ")";
+        return false;
+    }
+    end_ = header_.header_size;
+
+    // Index entries are trusted while they tile the log from the header on
+    bool index_current = false;
+    FileReader index_file(64 * 1024);
+    if (index_file.read((path_ + ".idx").c_str())) {
+        std::string_view data = index_file.data();
+        vmd_history_index_header index_header;
+        if (data.size() >= sizeof(index_header)) {
+            memcpy(&index_header, data.data(), sizeof(index_header));
+            if (index_header.magic == VMD_HISTORY_INDEX_MAGIC && index_header.version == VMD_HISTORY_VERSION &&
+                index_header.entry_size == sizeof(vmd_history_index_entry) && index_header.generation == header_.generation) {
+                size_t entries = (data.size() - sizeof(index_header)) / sizeof(vmd_history_index_entry);
+                index_current = data.size() == sizeof(index_header) + entries * sizeof(vmd_history_index_entry);
+                for (size_t i = 0; i < entries; i++) {
+                    vmd_history_index_entry entry;
+                    memcpy(&entry, data.data() + sizeof(index_header) + i * sizeof(entry), sizeof(entry));
+                    if (entry.offset != end_ || entry.size < sizeof(vmd_history_record) || end_ + entry.size > size) {
+                        index_current = false;
+                        break;
+                    }
+                    index_.push_back(entry);
+                    end_ += entry.size;
+                }
+            }
+        }
+    }
+
+    // Records past the index: appended without their index entry, or the index was lost
+    if (end_ < size) {
+        std::vector<char> tail(size - end_);
+        if (!readAll(fd_, tail.data(), tail.size(), end_)) {
+            error = std::string("cannot read history: ") + strerror(errno);
+            return false;
+        }
+        uint64_t pos = 0;
+        while (validRecord(tail.data() + pos, tail.size() - pos)) {
+            vmd_history_record record;
+            memcpy(&record, tail.data() + pos, sizeof(record));
+            index_.push_back({record.timestamp_ns, end_ + pos, record.size, record.flags});
+            pos += record.size;
+        }
+        index_current = false;
+        end_ += pos;
+        // Anything left is a torn write from a crash
+        if (end_ < size && writable && ftruncate(fd_, static_cast<off_t>(end_)) != 0) {
+            error = std::string("cannot truncate torn history record: ") + strerror(errno);
+            return false;
+        }
+    }
+    if (!index_current && writable && !writeIndex(error)) return false;
+
+    if (!index_.empty()) {
+        const vmd_history_index_entry& newest = index_.back();
+        last_.resize(newest.size);
+        if (!readAll(fd_, last_.data(), last_.size(), newest.offset)) {
+            error = std::string("cannot read history: ") + strerror(errno);
+            return false;
+        }
+        vmd_history_record record;
+        memcpy(&record, last_.data(), sizeof(record));
+        next_seq_ = record.seq + 1;
+    }
+    return true;
+}
+
+// Rewrites the whole index under a temporary name and renames it into place
+bool ScanHistory::writeIndex(std::string& error) {
+    std::string tmp = path_ + ".idx.tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "cannot write " + tmp + ": " + strerror(errno);
+        return false;
+    }
+    vmd_history_index_header index_header = {};
+    index_header.magic = VMD_HISTORY_INDEX_MAGIC;
+    index_header.version = VMD_HISTORY_VERSION;
+    index_header.entry_size = sizeof(vmd_history_index_entry);
+    index_header.generation = header_.generation;
+    bool ok = writeAll(fd, &index_header, sizeof(index_header), 0) &&
+              writeAll(fd, index_.data(), index_.size() * sizeof(vmd_history_index_entry), sizeof(index_header));
+    ::close(fd);
+    if (!ok || rename(tmp.c_str(), (path_ + ".idx").c_str()) != 0) {
+        error = "cannot write " + path_ + ".idx: " + strerror(errno);
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ScanHistory::append(const std::map<std::string, ProbeResult>& results, const TimingStats& timing,
+                         std::vector<std::string>& changed, std::string& error) {
+    changed.clear();
+    flock(fd_, LOCK_EX);
+
+    // Another writer may have appended or compacted since we loaded, and again between
+    // our reopen and relock: only write once the view checks out under the lock
+    while (true) {
+        struct stat ours, current;
+        if (fstat(fd_, &ours) == 0 && stat(path_.c_str(), &current) == 0 &&
+            ours.st_ino == current.st_ino && static_cast<uint64_t>(ours.st_size) == end_)
+            break;
+        flock(fd_, LOCK_UN);
+        if (!open(path_, true, error)) return false;
+        flock(fd_, LOCK_EX);
+    }
+
+    std::vector<char> buf(sizeof(vmd_history_record) + results.size() * sizeof(vmd_history_probe));
+    vmd_history_record record = {};
+    record.magic = VMD_HISTORY_RECORD_MAGIC;
+    record.size = static_cast<uint32_t>(buf.size());
+    record.seq = next_seq_;
+    record.timestamp_ns = realtimeNs();
+    readBootId(record.boot_id);
+    record.probe_count = static_cast<uint16_t>(results.size());
+    record.cycles_per_op = timing.cycles_per_op;
+    record.ns_per_op = timing.ns_per_op;
+    record.steal_pct = timing.steal_pct;
+    record.run_delay_ms = timing.run_delay_ms;
+
+    // Previous record's probes by name
+    std::map<std::string, const vmd_history_probe*> previous;
+    if (!last_.empty()) {
+        const vmd_history_record* prev = reinterpret_cast<const vmd_history_record*>(last_.data());
+        const vmd_history_probe* probes = HistoryWindow::probes(*prev);
+        for (uint16_t i = 0; i < prev->probe_count; i++)
+            previous[std::string(probes[i].name, strnlen(probes[i].name, VMD_HISTORY_NAME_LEN))] = &probes[i];
+        if (memcmp(prev->boot_id, record.boot_id, sizeof(record.boot_id)) != 0) record.flags |= VMD_HISTORY_NEW_BOOT;
+    }
+
+    vmd_history_probe* probes = reinterpret_cast<vmd_history_probe*>(buf.data() + sizeof(record));
+    size_t i = 0;
+    for (const auto& [name, result] : results) {
+        vmd_history_probe& probe = probes[i++];
+        strncpy(probe.name, name.c_str(), VMD_HISTORY_NAME_LEN - 1);
+        probe.evidence_hash = evidenceHash(result.evidence);
+        probe.elapsed_us = static_cast<uint32_t>(result.elapsed_ns / 1000);
+        probe.evidence_count = static_cast<uint16_t>(std::min<size_t>(result.evidence.size(), UINT16_MAX));
+        probe.detected = result.detected ? 1 : 0;
+        if (probe.detected) record.detected_count++;
+
+        auto it = previous.find(name);
+        if (it == previous.end()) continue;
+        if (it->second->evidence_hash != probe.evidence_hash) record.flags |= VMD_HISTORY_DRIFT;
+        if (it->second->detected != probe.detected) record.flags |= VMD_HISTORY_VERDICT;
+        if (it->second->evidence_hash != probe.evidence_hash || it->second->detected != probe.detected) {
+            probe.changed = 1;
+            changed.push_back(name);
+        }
+    }
+    memcpy(buf.data(), &record, sizeof(record));
+    record.checksum = recordChecksum(buf.data(), buf.size());
+    memcpy(buf.data() + offsetof(vmd_history_record, checksum), &record.checksum, sizeof(record.checksum));
+
+    if (!writeAll(fd_, buf.data(), buf.size(), end_)) {
+        error = std::string("cannot append to history: ") + strerror(errno);
+        // Drop the partial record so the log stays a run of whole ones
+        if (ftruncate(fd_, static_cast<off_t>(end_)) != 0) error += std::string("; truncate: ") + strerror(errno);
+        flock(fd_, LOCK_UN);
+        return false;
+    }
+    vmd_history_index_entry entry = {record.timestamp_ns, end_, record.size, record.flags};
+    index_.push_back(entry);
+    end_ += record.size;
+    last_ = std::move(buf);
+    next_seq_++;
+
+    // A lost index entry is not fatal: the next open indexes the record from the log
+    int index_fd = ::open((path_ + ".idx").c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (index_fd >= 0) {
+        ssize_t written = write(index_fd, &entry, sizeof(entry));
+        (void)written;
+        ::close(index_fd);
+    }
+
+    bool ok = end_ <= history_max_bytes || compact(error);
+    flock(fd_, LOCK_UN);
+    return ok;
+}
+
+bool ScanHistory::compact(std::string& error) {
+    // Newest records up to half the limit, then older change points up to three quarters
+    std::vector<bool> keep(index_.size());
+    uint64_t kept = 0;
+    size_t i = index_.size();
+    while (i > 0 && (kept == 0 || kept + index_[i - 1].size <= history_max_bytes / 2)) {
+        kept += index_[--i].size;
+        keep[i] = true;
+    }
+    while (i > 0) {
+        const vmd_history_index_entry& entry = index_[--i];
+        if (entry.flags == 0) continue;
+        if (kept + entry.size > history_max_bytes * 3 / 4) break;
+        kept += entry.size;
+        keep[i] = true;
+    }
+
+    std::string tmp = path_ + ".tmp";
+    int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "cannot compact history: " + tmp + ": " + strerror(errno);
+        return false;
+    }
+    vmd_history_header header = header_;
+    header.header_size = sizeof(header);
+    header.generation = realtimeNs();
+    header.compactions++;
+
+    std::vector<vmd_history_index_entry> index;
+    std::vector<char> record;
+    uint64_t pos = sizeof(header);
+    bool ok = writeAll(fd, &header, sizeof(header), 0);
+    for (size_t j = 0; ok && j < index_.size(); j++) {
+        if (!keep[j]) continue;
+        record.resize(index_[j].size);
+        ok = readAll(fd_, record.data(), record.size(), index_[j].offset) && writeAll(fd, record.data(), record.size(), pos);
+        index.push_back({index_[j].timestamp_ns, pos, index_[j].size, index_[j].flags});
+        pos += index_[j].size;
+    }
+    ok = ok && fdatasync(fd) == 0;
+    if (!ok || rename(tmp.c_str(), path_.c_str()) != 0) {
+        error = std::string("cannot compact history: ") + strerror(errno);
+        ::close(fd);
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // Our lock was on the old file; the new one is ours until we return
+    ::close(fd_);
+    fd_ = fd;
+    flock(fd_, LOCK_EX);
+    header_ = header;
+    index_ = std::move(index);
+    end_ = pos;
+    return writeIndex(error);
+}
+
+bool ScanHistory::map(size_t first, size_t last, HistoryWindow& window, std::string& error) {
+    window.reset();
+    if (first >= last) return true;
+    uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = index_[first].offset & ~(page - 1);
+    uint64_t end = index_[last - 1].offset + index_[last - 1].size;
+    void* map = mmap(nullptr, end - start, PROT_READ, MAP_SHARED, fd_, static_cast<off_t>(start));
+    if (map == MAP_FAILED) {
+        error = std::string("cannot map history: ") + strerror(errno);
+        return false;
+    }
+    window.map_ = map;
+    window.map_len_ = end - start;
+    for (size_t i = first; i < last; i++) {
+        const char* at = static_cast<const char*>(map) + (index_[i].offset - start);
+        const vmd_history_record* record = reinterpret_cast<const vmd_history_record*>(at);
+        if (record->magic != VMD_HISTORY_RECORD_MAGIC || record->size != index_[i].size) {
+            window.reset();
+            error = "history index does not match the log; it is rebuilt on the next write";
+            return false;
+        }
+        window.records_.push_back(record);
+    }
+    return true;
+}
+
+bool ScanHistory::latest(size_t n, HistoryWindow& window, std::string& error) {
+    return map(index_.size() - std::min(n, index_.size()), index_.size(), window, error);
+}
+
+bool ScanHistory::range(uint64_t from_ns, uint64_t to_ns, bool with_baseline, HistoryWindow& window, std::string& error) {
+    // Records are appended in time order, so the index is sorted by timestamp
+    auto by_time = [](const vmd_history_index_entry& entry, uint64_t ns) { return entry.timestamp_ns < ns; };
+    size_t first = std::lower_bound(index_.begin(), index_.end(), from_ns, by_time) - index_.begin();
+    size_t last = std::lower_bound(index_.begin(), index_.end(), to_ns, by_time) - index_.begin();
+    if (with_baseline && first > 0 && first < last) first--;
+    return map(first, last, window, error);
+}
+
+//============================Front end================================
+
+static ScanHistory* history = nullptr;
+
+bool openScanHistory(const std::string& path) {
+    static ScanHistory log;
+    std::string error;
+    if (!log.open(path, true, error)) {
+        std::cerr << "Failed to open scan history: " << error << std::endl;
+        return false;
+    }
+    history = &log;
+    return true;
+}
+
+void recordScanHistory(const std::map<std::string, ProbeResult>& results) {
+    if (!history) return;
+    std::vector<std::string> changed;
+    std::string error;
+    if (!history->append(results, timing_stats, changed, error)) {
+        std::cerr << "Failed to record scan history: " << error << std::endl;
+        return;
+    }
+    if (changed.empty()) return;
+    std::cout << "[history] drift since the last scan:";
+    for (const auto& name : changed) std::cout << " " << name;
+    std::cout << std::endl;
+}
+
+static std::string probeName(const vmd_history_probe& probe) {
+    return std::string(probe.name, strnlen(probe.name, VMD_HISTORY_NAME_LEN));
+}
+
+static std::string changedProbes(const vmd_history_record& record) {
+    std::string names;
+    const vmd_history_probe* probes = HistoryWindow::probes(record);
+    for (uint16_t i = 0; i < record.probe_count; i++) {
+        if (probes[i].changed) names += (names.empty() ? "" : " ") + probeName(probes[i]);
+    }
+    return names;
+}
+
+static void printRecord(const vmd_history_record& record) {
+    char boot[9];
+    snprintf(boot, sizeof(boot), "%02x%02x%02x%02x", record.boot_id[0], record.boot_id[1], record.boot_id[2], record.boot_id[3]);
+    std::cout << "  #" << std::left << std::setw(6) << record.seq << std::right << formatTime(record.timestamp_ns)
+              << "  " << record.detected_count << "/" << record.probe_count << " detected  boot " << boot;
+    if (record.steal_pct > 0) std::cout << "  steal " << std::fixed << std::setprecision(1) << record.steal_pct << "%";
+    std::cout.unsetf(std::ios::floatfield);
+    if (record.flags & (VMD_HISTORY_DRIFT | VMD_HISTORY_VERDICT)) std::cout << "  [changed: " << changedProbes(record) << "]";
+    if (record.flags & VMD_HISTORY_NEW_BOOT) std::cout << "  [new boot]";
+    std::cout << std::endl;
+}
+
+bool printScanHistory(const std::string& path, size_t count) {
+    ScanHistory log;
+    HistoryWindow window;
+    std::string error;
+    if (!log.open(path, false, error) || !log.latest(count, window, error)) {
+        std::cerr << "Scan history: " << error << std::endl;
+        return false;
+    }
+    std::cout << "\n===== Scan History (" << window.size() << " of " << log.count() << " records, " << path << ") =====" << std::endl;
+    for (size_t i = 0; i < window.size(); i++) printRecord(window[i]);
+    return true;
+}
+
+bool printHistoryChanges(const std::string& path, uint64_t since_ns) {
+    ScanHistory log;
+    HistoryWindow window;
+    std::string error;
+    if (!log.open(path, false, error) || !log.range(since_ns, UINT64_MAX, true, window, error)) {
+        std::cerr << "Scan history: " << error << std::endl;
+        return false;
+    }
+    std::cout << "\n===== Changes Since " << formatTime(since_ns) << " =====" << std::endl;
+    if (window.size() == 0) {
+        std::cout << "No scans recorded since then." << std::endl;
+        return true;
+    }
+
+    // The state at since_ns is the last record before it; an unflagged record repeats its predecessor
+    const vmd_history_record& base = window[0];
+    const vmd_history_record& now = window[window.size() - 1];
+    std::cout << "Baseline: scan #" << base.seq << " at " << formatTime(base.timestamp_ns)
+              << (base.timestamp_ns >= since_ns ? " (oldest kept record)" : "") << std::endl;
+    std::cout << "Latest:   scan #" << now.seq << " at " << formatTime(now.timestamp_ns) << std::endl;
+
+    std::map<std::string, const vmd_history_probe*> before;
+    const vmd_history_probe* base_probes = HistoryWindow::probes(base);
+    for (uint16_t i = 0; i < base.probe_count; i++) before[probeName(base_probes[i])] = &base_probes[i];
+
+    size_t differences = 0;
+    const vmd_history_probe* now_probes = HistoryWindow::probes(now);
+    for (uint16_t i = 0; i < now.probe_count; i++) {
+        const vmd_history_probe& probe = now_probes[i];
+        auto it = before.find(probeName(probe));
+        if (it == before.end()) continue;
+        const vmd_history_probe& old = *it->second;
+        if (old.detected == probe.detected && old.evidence_hash == probe.evidence_hash) continue;
+        differences++;
+        std::cout << "  " << probeName(probe) << ":";
+        if (old.detected != probe.detected)
+            std::cout << (old.detected ? " detected -> not detected," : " not detected -> detected,");
+        if (old.evidence_hash != probe.evidence_hash)
+            std::cout << " evidence changed (" << old.evidence_count << " -> " << probe.evidence_count << " items)";
+        else
+            std::cout << " same evidence";
+        std::cout << std::endl;
+    }
+    if (differences == 0) std::cout << "  No probe changed its verdict or evidence." << std::endl;
+
+    bool header = false;
+    for (size_t i = 1; i < window.size(); i++) {
+        if (window[i].flags == 0) continue;
+        if (!header) std::cout << "Change events:" << std::endl;
+        header = true;
+        printRecord(window[i]);
+    }
+    return true;
+}
@@ -0,0 +1,99 @@
+#ifndef SCAN_HISTORY_H
+#define SCAN_HISTORY_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "vm_detection.h"
+#include "vm_history.h"
+
+// Compaction starts when the log grows past this many bytes, settable with --history-limit
+extern uint64_t history_max_bytes;
+
+/**
+    A run of consecutive history records mapped with a single mmap of the
+    log. Records point into the mapping and stay valid for the window's
+    lifetime, even if the log is compacted meanwhile.
+ */
+class HistoryWindow {
+public:
+    HistoryWindow() = default;
+    HistoryWindow(const HistoryWindow&) = delete;
+    HistoryWindow& operator=(const HistoryWindow&) = delete;
+    ~HistoryWindow();
+
+    size_t size() const { return records_.size(); }
+    const vmd_history_record& operator[](size_t i) const { return *records_[i]; }
+
+    static const vmd_history_probe* probes(const vmd_history_record& record) {
+        return reinterpret_cast<const vmd_history_probe*>(&record + 1);
+    }
+
+private:
+    friend class ScanHistory;
+    void reset();
+
+    void* map_ = nullptr;
+    size_t map_len_ = 0;
+    std::vector<const vmd_history_record*> records_;
+};
+
+/**
+    The append-only scan log (layout in vm_history.h). open() recovers from
+    a torn last record and rebuilds a stale index; append() flags drift
+    against the previous record and compacts once the log passes
+    history_max_bytes. Compaction keeps the newest records plus every older
+    record that changed something: an unflagged record only repeats its
+    predecessor's verdicts and evidence, so the change history survives.
+ */
+class ScanHistory {
+public:
+    ScanHistory() = default;
+    ScanHistory(const ScanHistory&) = delete;
+    ScanHistory& operator=(const ScanHistory&) = delete;
+    ~ScanHistory();
+
+    // create: make the log if missing (writers); readers fail instead
+    bool open(const std::string& path, bool create, std::string& error);
+
+    // Appends a record for one scan; changed gets the probes that drifted since the last one
+    bool append(const std::map<std::string, ProbeResult>& results, const TimingStats& timing,
+                std::vector<std::string>& changed, std::string& error);
+
+    size_t count() const { return index_.size(); }
+
+    // The newest n records, oldest first
+    bool latest(size_t n, HistoryWindow& window, std::string& error);
+    // Records with from_ns <= timestamp < to_ns; with_baseline adds the last one before from_ns
+    bool range(uint64_t from_ns, uint64_t to_ns, bool with_baseline, HistoryWindow& window, std::string& error);
+
+private:
+    bool load(bool writable, std::string& error);
+    bool writeIndex(std::string& error);
+    bool map(size_t first, size_t last, HistoryWindow& window, std::string& error);
+    bool compact(std::string& error);
+    void close();
+
+    std::string path_;
+    int fd_ = -1;
+    vmd_history_header header_ = {};
+    uint64_t end_ = 0;                                  // log size covered by index_
+    uint64_t next_seq_ = 1;
+    std::vector<vmd_history_index_entry> index_;
+    std::vector<char> last_;                            // newest record, for drift checks
+};
+
+// Opens the history log at path for recordScanHistory, creating it if needed
+bool openScanHistory(const std::string& path);
+
+// Appends the probes of the last scan, if a history is open, and prints any drift
+void recordScanHistory(const std::map<std::string, ProbeResult>& results);
+
+// --history: prints the newest count records of the log at path
+bool printScanHistory(const std::string& path, size_t count);
+
+// --since: what changed between the state at since_ns and the newest record
+bool printHistoryChanges(const std::string& path, uint64_t since_ns);
+
+#endif // SCAN_HISTORY_H
@@ -0,0 +1,639 @@
+#include "sigpack.h"
+#include "file_reader.h"
+#include <iostream>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <deque>
+#include <atomic>
+#include <cstring>
+#include <cctype>
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char* const builtin_source = R"SIG(# vm_detection signature source
+# Compile with: sigpack_compile -o signatures.pack <this file>
+version 1
+
+[strings]
+# Substrings searched in environment variables, lsusb, lscpu, input devices
+# (case-sensitive) and ACPI tables (case-insensitive)
+VMware
+VirtualBox
+VBOX
+QEMU
+KVM
+Microsoft Corporation
+Hyper-V
+Parallels
+Bochs
+BHYVE
+HVM domU
+innotek GmbH
+QEM
+VRT
+
+[dmi]
+# Matched case-insensitively against DMI fields and dmidecode output
+qemu
+vmware
+virtualbox
+hyper-v
+xen
+kvm
+parallels
+
+[devicetree]
+# Matched case-insensitively against device tree compatible strings and node names
+linux,dummy-virt
+qemu,fw-cfg-mmio
+qemu,pvpanic-mmio
+virtio,mmio
+virtio_mmio
+riscv-virtio
+xen,xen
+google,goldfish
+
+[pci]
+# vendor:device in hex; vendor:* matches every device of the vendor
+15ad:0740 VMware VMCI
+15ad:0405 VMware SVGA II
+15ad:07a0 VMware PCI Express root port
+1234:1111 QEMU VGA
+1af4:1000 Virtio network (QEMU)
+80ee:beef VirtualBox graphics
+10de:1db6 NVIDIA vGPU
+5853:0001 Xen platform device
+5853:0002 Xen platform device
+
+[usb]
+# vendor:product in hex; vendor:* matches every product of the vendor
+80ee:0021 VirtualBox USB tablet
+0627:0001 QEMU USB tablet
+46f4:0001 QEMU USB storage
+0e0f:0002 VMware virtual USB hub
+0e0f:0003 VMware virtual mouse
+
+[oui]
+# NIC address prefixes, used when no compiled IEEE registry is available
+00:05:69 VMware
+00:0C:29 VMware
+00:1C:14 VMware
+00:50:56 VMware
+08:00:27 VirtualBox
+52:54:00 QEMU/KVM
+00:15:5D Microsoft Hyper-V
+00:16:3E Xen
+00:1A:4A Qumranet (KVM)
+
+[modules]
+vboxguest
+vboxsf
+vboxvideo
+vmw_balloon
+vmw_vmci
+vmw_vsock_vmci_transport
+vmw_vsock_virtio_transport_common
+vmwgfx
+vsock
+hyperv
+hv_utils
+hv_vmbus
+hv_storvsc
+kvm
+kvm_intel
+kvm_amd
+xen_netfront
+xen_blkfront
+xenfs
+xen_platform_pci
+parallels
+prl_fs
+prl_tg
+)SIG";
+
+const char* builtinSignatureSource() {
+    return builtin_source;
+}
+
+uint32_t signatureHash(std::string_view text) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Spreads table keys (IDs differ mostly in their low bits) over the slots
+static inline uint32_t mixKey(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x45d9f3bu;
+    key ^= key >> 16;
+    return key;
+}
+
+//============================== Compiler ==============================
+
+namespace {
+
+struct StringTable {
+    std::string blob = std::string(1, '\0');
+    std::unordered_map<std::string, uint32_t> offsets;
+
+    uint32_t add(const std::string& text) {
+        auto it = offsets.find(text);
+        if (it != offsets.end()) return it->second;
+        uint32_t offset = static_cast<uint32_t>(blob.size());
+        blob += text;
+        blob += '\0';
+        offsets.emplace(text, offset);
+        return offset;
+    }
+};
+
+template <typename T>
+void append(std::vector<char>& out, const T* data, size_t count) {
+    const char* bytes = reinterpret_cast<const char*>(data);
+    out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+
+/**
+    Builds the Aho-Corasick trie, resolves failure links into a full
+    transition table, and serializes it (see SigAutomatonHeader).
+ */
+void buildAutomaton(const std::vector<std::string>& patterns, bool icase,
+                    StringTable& strings, std::vector<char>& out) {
+    SigAutomatonHeader header = {};
+    auto fold = [icase](unsigned char c) { return icase ? static_cast<unsigned char>(tolower(c)) : c; };
+
+    // Class 0 stands for every byte no pattern uses
+    uint32_t classes = 1;
+    for (const auto& pattern : patterns) {
+        for (unsigned char c : pattern) {
+            unsigned char f = fold(c);
+            if (header.classmap[f] == 0) {
+                header.classmap[f] = static_cast<uint8_t>(classes++);
+                if (icase) header.classmap[toupper(f)] = header.classmap[f];
+            }
+        }
+    }
+
+    // Trie; child 0 means "no edge" since the root is never a child
+    std::vector<uint32_t> delta(classes, 0);
+    std::vector<std::vector<uint32_t>> outputs(1);
+    for (uint32_t id = 0; id < patterns.size(); id++) {
+        uint32_t state = 0;
+        for (unsigned char c : patterns[id]) {
+            uint32_t cls = header.classmap[fold(c)];
+            if (delta[state * classes + cls] == 0) {
+                delta[state * classes + cls] = static_cast<uint32_t>(outputs.size());
+                outputs.emplace_back();
+                delta.resize(outputs.size() * classes, 0);
+            }
+            state = delta[state * classes + cls];
+        }
+        outputs[state].push_back(id);
+    }
+
+    // Breadth-first so a state's failure target is final before its children
+    uint32_t states = static_cast<uint32_t>(outputs.size());
+    std::vector<uint32_t> fail(states, 0);
+    std::deque<uint32_t> queue;
+    for (uint32_t cls = 0; cls < classes; cls++) {
+        if (delta[cls] != 0) queue.push_back(delta[cls]);
+    }
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+        const auto& inherited = outputs[fail[state]];
+        outputs[state].insert(outputs[state].end(), inherited.begin(), inherited.end());
+        for (uint32_t cls = 0; cls < classes; cls++) {
+            uint32_t& next = delta[state * classes + cls];
+            uint32_t fallback = delta[fail[state] * classes + cls];
+            if (next != 0) {
+                fail[next] = fallback;
+                queue.push_back(next);
+            } else {
+                next = fallback;
+            }
+        }
+    }
+
+    std::vector<uint32_t> out_index, out_ids, pattern_offsets;
+    for (const auto& ids : outputs) {
+        out_index.push_back(static_cast<uint32_t>(out_ids.size()));
+        out_ids.insert(out_ids.end(), ids.begin(), ids.end());
+    }
+    out_index.push_back(static_cast<uint32_t>(out_ids.size()));
+    for (const auto& pattern : patterns) pattern_offsets.push_back(strings.add(pattern));
+
+    header.num_states = states;
+    header.num_classes = classes;
+    header.num_patterns = static_cast<uint32_t>(patterns.size());
+    header.flags = icase ? 1 : 0;
+    header.delta_offset = sizeof(header);
+    header.out_index_offset = header.delta_offset + static_cast<uint32_t>(delta.size() * 4);
+    header.out_ids_offset = header.out_index_offset + static_cast<uint32_t>(out_index.size() * 4);
+    header.patterns_offset = header.out_ids_offset + static_cast<uint32_t>(out_ids.size() * 4);
+
+    append(out, &header, 1);
+    append(out, delta.data(), delta.size());
+    append(out, out_index.data(), out_index.size());
+    append(out, out_ids.data(), out_ids.size());
+    append(out, pattern_offsets.data(), pattern_offsets.size());
+}
+
+void buildHashTable(const std::map<uint32_t, uint32_t>& entries, std::vector<char>& out) {
+    uint32_t capacity = 8;
+    while (capacity < entries.size() * 2) capacity *= 2;
+
+    std::vector<SigHashEntry> slots(capacity, SigHashEntry{0, 0});
+    for (const auto& [key, name_offset] : entries) {
+        uint32_t slot = mixKey(key) & (capacity - 1);
+        while (slots[slot].name_offset != 0) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = {key, name_offset};
+    }
+
+    SigHashHeader header = {capacity, static_cast<uint32_t>(entries.size())};
+    append(out, &header, 1);
+    append(out, slots.data(), slots.size());
+}
+
+// "vvvv:dddd" or "vvvv:*"
+bool parseIdPair(std::string_view text, uint32_t& key) {
+    size_t colon = text.find(':');
+    if (colon == std::string_view::npos) return false;
+    uint64_t vendor, device = SIG_ANY_DEVICE;
+    std::string_view device_text = text.substr(colon + 1);
+    if (!parseUnsigned(text.substr(0, colon), vendor, 16) || vendor > 0xffff) return false;
+    if (device_text != "*" && (!parseUnsigned(device_text, device, 16) || device > 0xffff)) return false;
+    key = static_cast<uint32_t>(vendor << 16 | device);
+    return true;
+}
+
+// "aa:bb:cc", "aa-bb-cc" or "aabbcc"
+bool parseOui(std::string_view text, uint32_t& key) {
+    std::string digits;
+    for (char c : text) {
+        if (c != ':' && c != '-') digits += c;
+    }
+    uint64_t value;
+    if (digits.size() != 6 || !parseUnsigned(digits, value, 16)) return false;
+    key = static_cast<uint32_t>(value);
+    return true;
+}
+
+} // namespace
+
+bool compileSignaturePack(const std::string& source, std::vector<char>& pack, std::string& error) {
+    std::vector<std::string> general, dmi, devicetree;
+    std::set<std::string> seen_general, seen_dmi, seen_devicetree;
+    std::map<uint32_t, std::string> pci, usb, oui;
+    std::map<uint32_t, std::string> modules;
+    uint32_t generation = 0;
+    std::string section;
+
+    LineScanner lines(source);
+    std::string_view raw;
+    int line_number = 0;
+    while (lines.next(raw)) {
+        line_number++;
+        std::string_view line = trim(raw.substr(0, raw.find('#')));
+        if (line.empty()) continue;
+        auto fail = [&](const char* what) {
+            error = "line " + std::to_string(line_number) + ": " + what + ": " + std::string(line);
+            return false;
+        };
+
+        if (line.front() == '[') {
+            section = std::string(line);
+            if (section != "[strings]" && section != "[dmi]" && section != "[devicetree]" && section != "[pci]" &&
+                section != "[usb]" && section != "[oui]" && section != "[modules]")
+                return fail("unknown section");
+            continue;
+        }
+        if (section.empty()) {
+            uint64_t value;
+            if (line.substr(0, 8) != "version " || !parseUnsigned(trim(line.substr(8)), value) || value > UINT32_MAX)
+                return fail("expected \"version N\" or a section");
+            generation = static_cast<uint32_t>(value);
+            continue;
+        }
+
+        // Table entries are "<id> [label]"
+        size_t space = line.find_first_of(" \t");
+        std::string_view id = line.substr(0, space);
+        std::string label(space == std::string_view::npos ? std::string_view() : trim(line.substr(space)));
+        uint32_t key;
+
+        if (section == "[strings]") {
+            if (seen_general.insert(std::string(line)).second) general.emplace_back(line);
+        } else if (section == "[dmi]") {
+            if (seen_dmi.insert(std::string(line)).second) dmi.emplace_back(line);
+        } else if (section == "[devicetree]") {
+            if (seen_devicetree.insert(std::string(line)).second) devicetree.emplace_back(line);
+        } else if (section == "[pci]" || section == "[usb]") {
+            if (!parseIdPair(id, key)) return fail("bad vendor:device ID");
+            (section == "[pci]" ? pci : usb)[key] = label.empty() ? std::string(id) : label;
+        } else if (section == "[oui]") {
+            if (!parseOui(id, key)) return fail("bad OUI");
+            oui[key] = label.empty() ? std::string(id) : label;
+        } else {
+            if (space != std::string_view::npos) return fail("module names cannot contain spaces");
+            std::string name(line);
+            for (char& c : name) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+            auto [it, inserted] = modules.emplace(signatureHash(name), name);
+            if (!inserted && it->second != name) return fail("module name hash collision");
+        }
+    }
+
+    StringTable strings;
+    std::vector<char> blobs[SIG_SECTION_COUNT];
+    buildAutomaton(general, false, strings, blobs[SIG_SECTION_AC_GENERAL]);
+    buildAutomaton(general, true, strings, blobs[SIG_SECTION_AC_GENERAL_ICASE]);
+    buildAutomaton(dmi, true, strings, blobs[SIG_SECTION_AC_DMI]);
+    buildAutomaton(devicetree, true, strings, blobs[SIG_SECTION_AC_DEVICETREE]);
+
+    auto intern = [&strings](const std::map<uint32_t, std::string>& table) {
+        std::map<uint32_t, uint32_t> offsets;
+        for (const auto& [key, name] : table) offsets[key] = strings.add(name);
+        return offsets;
+    };
+    buildHashTable(intern(pci), blobs[SIG_SECTION_PCI]);
+    buildHashTable(intern(usb), blobs[SIG_SECTION_USB]);
+    buildHashTable(intern(oui), blobs[SIG_SECTION_OUI]);
+    buildHashTable(intern(modules), blobs[SIG_SECTION_MODULES]);
+    blobs[SIG_SECTION_STRINGS].assign(strings.blob.begin(), strings.blob.end());
+
+    SigPackHeader header = {};
+    memcpy(header.magic, SIGPACK_MAGIC, sizeof(header.magic));
+    header.version = SIGPACK_VERSION;
+    header.generation = generation;
+    header.section_count = SIG_SECTION_COUNT;
+
+    SigPackSectionEntry table[SIG_SECTION_COUNT];
+    size_t offset = sizeof(header) + sizeof(table);
+    for (uint32_t i = 0; i < SIG_SECTION_COUNT; i++) {
+        offset = (offset + 3) & ~size_t(3);
+        table[i] = {static_cast<uint32_t>(offset), static_cast<uint32_t>(blobs[i].size())};
+        offset += blobs[i].size();
+    }
+
+    pack.clear();
+    pack.reserve(offset);
+    append(pack, &header, 1);
+    append(pack, table, SIG_SECTION_COUNT);
+    for (uint32_t i = 0; i < SIG_SECTION_COUNT; i++) {
+        pack.resize(table[i].offset, '\0');
+        pack.insert(pack.end(), blobs[i].begin(), blobs[i].end());
+    }
+    return true;
+}
+
+//============================== Reader ==============================
+
+SignaturePack::~SignaturePack() {
+    if (map_) munmap(map_, size_);
+}
+
+std::shared_ptr<const SignaturePack> SignaturePack::load(const std::string& path, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SigPackHeader)) {
+        close(fd);
+        error = path + ": not a signature pack";
+        return nullptr;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        error = path + ": " + strerror(errno);
+        return nullptr;
+    }
+
+    std::shared_ptr<SignaturePack> pack(new SignaturePack());
+    pack->map_ = map;
+    pack->data_ = static_cast<const char*>(map);
+    pack->size_ = st.st_size;
+    pack->origin_ = path;
+    if (!pack->validate(error)) {
+        error = path + ": " + error;
+        return nullptr;
+    }
+    return pack;
+}
+
+std::shared_ptr<const SignaturePack> SignaturePack::compile(const std::string& source, std::string& error) {
+    std::shared_ptr<SignaturePack> pack(new SignaturePack());
+    if (!compileSignaturePack(source, pack->owned_, error)) return nullptr;
+    pack->data_ = pack->owned_.data();
+    pack->size_ = pack->owned_.size();
+    pack->origin_ = "built-in";
+    if (!pack->validate(error)) return nullptr;
+    return pack;
+}
+
+const char* SignaturePack::section(SigSection s) const {
+    if (s >= header()->section_count) return nullptr;
+    const SigPackSectionEntry* table = reinterpret_cast<const SigPackSectionEntry*>(data_ + sizeof(SigPackHeader));
+    return table[s].size ? data_ + table[s].offset : nullptr;
+}
+
+const SigAutomatonHeader* SignaturePack::automaton(SigSet set) const {
+    return reinterpret_cast<const SigAutomatonHeader*>(section(static_cast<SigSection>(set)));
+}
+
+/**
+    Bounds-checks every offset and index so a truncated or corrupt pack is
+    rejected at load instead of faulting in the middle of a scan.
+ */
+bool SignaturePack::validate(std::string& error) {
+    const SigPackHeader* h = header();
+    if (memcmp(h->magic, SIGPACK_MAGIC, sizeof(h->magic)) != 0 || h->version != SIGPACK_VERSION) {
+        error = "not a version " + std::to_string(SIGPACK_VERSION) + " signature pack";
+        return false;
+    }
+    if (sizeof(SigPackHeader) + static_cast<uint64_t>(h->section_count) * sizeof(SigPackSectionEntry) > size_) {
+        error = "truncated section table";
+        return false;
+    }
+    const SigPackSectionEntry* table = reinterpret_cast<const SigPackSectionEntry*>(data_ + sizeof(SigPackHeader));
+    for (uint32_t i = 0; i < h->section_count; i++) {
+        if (table[i].size && (table[i].offset % 4 != 0 || static_cast<uint64_t>(table[i].offset) + table[i].size > size_)) {
+            error = "section " + std::to_string(i) + " out of bounds";
+            return false;
+        }
+    }
+
+    const char* strings = section(SIG_SECTION_STRINGS);
+    uint32_t strings_size = strings ? table[SIG_SECTION_STRINGS].size : 0;
+    if (!strings || strings[0] != '\0' || strings[strings_size - 1] != '\0') {
+        error = "bad strings section";
+        return false;
+    }
+    strings_ = strings;
+
+    for (SigSet set : {SIG_GENERAL, SIG_GENERAL_ICASE, SIG_DMI, SIG_DEVICETREE}) {
+        const SigAutomatonHeader* a = automaton(set);
+        if (!a) continue;
+        uint64_t size = table[set].size;
+        uint64_t cells = static_cast<uint64_t>(a->num_states) * a->num_classes;
+        bool ok = size >= sizeof(SigAutomatonHeader) && a->num_states > 0 && a->num_classes > 0 &&
+                  a->delta_offset >= sizeof(SigAutomatonHeader) && a->delta_offset % 4 == 0 &&
+                  a->delta_offset + cells * 4 <= size &&
+                  a->out_index_offset % 4 == 0 &&
+                  a->out_index_offset + (a->num_states + 1ull) * 4 <= size &&
+                  a->out_ids_offset % 4 == 0 && a->out_ids_offset <= size &&
+                  a->patterns_offset % 4 == 0 &&
+                  a->patterns_offset + a->num_patterns * 4ull <= size;
+        for (int c = 0; ok && c < 256; c++) ok = a->classmap[c] < a->num_classes;
+        const uint32_t* delta = ok ? array(a, a->delta_offset) : nullptr;
+        for (uint64_t i = 0; ok && i < cells; i++) ok = delta[i] < a->num_states;
+        const uint32_t* out_index = ok ? array(a, a->out_index_offset) : nullptr;
+        for (uint32_t i = 0; ok && i < a->num_states; i++) ok = out_index[i] <= out_index[i + 1];
+        ok = ok && a->out_ids_offset + out_index[a->num_states] * 4ull <= size;
+        const uint32_t* out_ids = ok ? array(a, a->out_ids_offset) : nullptr;
+        for (uint32_t i = 0; ok && i < out_index[a->num_states]; i++) ok = out_ids[i] < a->num_patterns;
+        const uint32_t* patterns = ok ? array(a, a->patterns_offset) : nullptr;
+        for (uint32_t i = 0; ok && i < a->num_patterns; i++) ok = patterns[i] < strings_size;
+        if (!ok) {
+            error = "bad automaton in section " + std::to_string(set);
+            return false;
+        }
+    }
+
+    for (SigSection s : {SIG_SECTION_PCI, SIG_SECTION_USB, SIG_SECTION_OUI, SIG_SECTION_MODULES}) {
+        const char* blob = section(s);
+        if (!blob) continue;
+        const SigHashHeader* t = reinterpret_cast<const SigHashHeader*>(blob);
+        bool ok = table[s].size >= sizeof(SigHashHeader) && t->capacity > 0 &&
+                  (t->capacity & (t->capacity - 1)) == 0 && t->count < t->capacity &&
+                  sizeof(SigHashHeader) + static_cast<uint64_t>(t->capacity) * sizeof(SigHashEntry) <= table[s].size;
+        const SigHashEntry* entries = reinterpret_cast<const SigHashEntry*>(t + 1);
+        // count comes from the file; only a slot that really is empty ends lookup's probe
+        uint32_t empty = 0;
+        for (uint32_t i = 0; ok && i < t->capacity; i++) {
+            ok = entries[i].name_offset < strings_size;
+            empty += entries[i].name_offset == 0;
+        }
+        ok = ok && empty > 0;
+        if (!ok) {
+            error = "bad table in section " + std::to_string(s);
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* SignaturePack::findFirst(SigSet set, std::string_view input) const {
+    const SigAutomatonHeader* a = automaton(set);
+    if (!a) return nullptr;
+    const uint32_t* delta = array(a, a->delta_offset);
+    const uint32_t* out_index = array(a, a->out_index_offset);
+    uint32_t state = 0;
+    for (unsigned char c : input) {
+        state = delta[state * a->num_classes + a->classmap[c]];
+        if (out_index[state] != out_index[state + 1]) {
+            const uint32_t* out_ids = array(a, a->out_ids_offset);
+            return text(array(a, a->patterns_offset)[out_ids[out_index[state]]]);
+        }
+    }
+    return nullptr;
+}
+
+const char* SignaturePack::lookup(SigSection s, uint32_t key, std::string_view name) const {
+    const char* blob = section(s);
+    if (!blob) return nullptr;
+    const SigHashHeader* t = reinterpret_cast<const SigHashHeader*>(blob);
+    const SigHashEntry* entries = reinterpret_cast<const SigHashEntry*>(t + 1);
+    uint32_t mask = t->capacity - 1;
+    // validate() rejects tables without an empty slot, so the probe always ends
+    for (uint32_t slot = mixKey(key) & mask; entries[slot].name_offset != 0; slot = (slot + 1) & mask) {
+        if (entries[slot].key != key) continue;
+        if (name.empty() || name == text(entries[slot].name_offset)) return text(entries[slot].name_offset);
+    }
+    return nullptr;
+}
+
+const char* SignaturePack::matchPci(uint16_t vendor, uint16_t device) const {
+    const char* label = lookup(SIG_SECTION_PCI, static_cast<uint32_t>(vendor) << 16 | device);
+    return label ? label : lookup(SIG_SECTION_PCI, static_cast<uint32_t>(vendor) << 16 | SIG_ANY_DEVICE);
+}
+
+const char* SignaturePack::matchUsb(uint16_t vendor, uint16_t product) const {
+    const char* label = lookup(SIG_SECTION_USB, static_cast<uint32_t>(vendor) << 16 | product);
+    return label ? label : lookup(SIG_SECTION_USB, static_cast<uint32_t>(vendor) << 16 | SIG_ANY_DEVICE);
+}
+
+const char* SignaturePack::matchOui(uint32_t oui) const {
+    return lookup(SIG_SECTION_OUI, oui);
+}
+
+bool SignaturePack::hasModule(std::string_view name) const {
+    return !name.empty() && lookup(SIG_SECTION_MODULES, signatureHash(name), name) != nullptr;
+}
+
+size_t SignaturePack::tableSize(SigSection s) const {
+    const char* blob = section(s);
+    return blob ? reinterpret_cast<const SigHashHeader*>(blob)->count : 0;
+}
+
+//============================== Active pack ==============================
+
+std::string signature_pack_path = SIGPACK_PATH;
+
+static std::shared_ptr<const SignaturePack> active_pack;
+static volatile sig_atomic_t reload_requested = 0;
+
+std::shared_ptr<const SignaturePack> currentSignatures() {
+    std::shared_ptr<const SignaturePack> pack = std::atomic_load(&active_pack);
+    if (!pack) {
+        loadSignatures();
+        pack = std::atomic_load(&active_pack);
+    }
+    return pack;
+}
+
+bool loadSignatures() {
+    std::string error;
+    std::shared_ptr<const SignaturePack> pack;
+    if (!signature_pack_path.empty() && access(signature_pack_path.c_str(), F_OK) == 0) {
+        pack = SignaturePack::load(signature_pack_path, error);
+        if (!pack) {
+            std::cerr << "Cannot load signature pack " << error << std::endl;
+            // A broken pack never replaces a working one
+            if (std::atomic_load(&active_pack)) return false;
+        }
+    }
+    if (!pack) {
+        pack = SignaturePack::compile(builtinSignatureSource(), error);
+        if (!pack) {
+            std::cerr << "Built-in signatures failed to compile: " << error << std::endl;
+            return false;
+        }
+    }
+    std::atomic_store(&active_pack, pack);
+    return true;
+}
+
+void requestSignatureReload() {
+    reload_requested = 1;
+}
+
+void reloadSignaturesIfRequested() {
+    if (!reload_requested) return;
+    reload_requested = 0;
+    if (loadSignatures()) {
+        std::shared_ptr<const SignaturePack> pack = std::atomic_load(&active_pack);
+        std::cout << "Reloaded signatures from " << pack->origin() << " (generation " << pack->generation() << ")" << std::endl;
+    }
+}
@@ -0,0 +1,195 @@
+#ifndef SIGPACK_H
+#define SIGPACK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+    Compiled signature pack: every piece of detection knowledge (signature
+    strings, PCI/USB IDs, NIC OUIs, kernel module names) with its lookup
+    structures precomputed, so probes never build them at scan time.
+
+    Packs are produced offline by sigpack_compile from a text source (run
+    "sigpack_compile -d" for the built-in one) and mapped read-only. Without
+    a pack file the built-in source is compiled in memory at startup.
+
+    File layout, little-endian, all offsets from the start of the file:
+        SigPackHeader
+        SigPackSectionEntry[section_count]   indexed by SigSection
+        section blobs, 4-byte aligned
+    Sections a reader does not know are ignored and missing ones are empty,
+    so packs stay loadable across section additions. Offset 0 of the strings
+    section is an empty string.
+
+    Packs are replaced by rename, never rewritten in place: a mapped pack
+    stays valid until its last user drops it.
+ */
+
+#define SIGPACK_MAGIC   "VMDSIG1"
+#define SIGPACK_VERSION 1
+#define SIGPACK_PATH    "/usr/local/share/vm_detection/signatures.pack"
+
+enum SigSection : uint32_t {
+    SIG_SECTION_STRINGS = 0,     // NUL-terminated names and labels
+    SIG_SECTION_AC_GENERAL,      // automaton over [strings], case-sensitive
+    SIG_SECTION_AC_GENERAL_ICASE,// automaton over [strings], ASCII case-insensitive
+    SIG_SECTION_AC_DMI,          // automaton over [dmi], ASCII case-insensitive
+    SIG_SECTION_PCI,             // hash table, key vendor << 16 | device
+    SIG_SECTION_USB,             // hash table, key vendor << 16 | product
+    SIG_SECTION_OUI,             // hash table, key 24-bit OUI
+    SIG_SECTION_MODULES,         // hash table, key FNV-1a of the module name
+    SIG_SECTION_AC_DEVICETREE,   // automaton over [devicetree], ASCII case-insensitive
+    SIG_SECTION_COUNT
+};
+
+// Automata usable with SignaturePack::scan
+enum SigSet : uint32_t {
+    SIG_GENERAL = SIG_SECTION_AC_GENERAL,
+    SIG_GENERAL_ICASE = SIG_SECTION_AC_GENERAL_ICASE,
+    SIG_DMI = SIG_SECTION_AC_DMI,
+    SIG_DEVICETREE = SIG_SECTION_AC_DEVICETREE,
+};
+
+struct SigPackSectionEntry {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct SigPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t generation;         // "version" line of the source, for operators
+    uint32_t section_count;
+    uint32_t reserved;
+};
+
+/**
+    Aho-Corasick automaton with failure links folded into a dense DFA over
+    byte classes. Arrays follow the header, offsets relative to its start:
+        delta[num_states * num_classes]   next state
+        out_index[num_states + 1]         range into out_ids per state
+        out_ids[]                         pattern ids ending at the state
+        patterns[num_patterns]            string offset of each pattern
+ */
+struct SigAutomatonHeader {
+    uint32_t num_states;
+    uint32_t num_classes;
+    uint32_t num_patterns;
+    uint32_t flags;
+    uint32_t delta_offset;
+    uint32_t out_index_offset;
+    uint32_t out_ids_offset;
+    uint32_t patterns_offset;
+    uint8_t classmap[256];
+};
+
+/**
+    Open-addressing hash table with power-of-two capacity. A slot with
+    name_offset 0 is empty. Entries follow the header.
+ */
+struct SigHashHeader {
+    uint32_t capacity;
+    uint32_t count;
+};
+
+struct SigHashEntry {
+    uint32_t key;
+    uint32_t name_offset;
+};
+
+// PCI/USB entries with this device/product match every ID of the vendor
+#define SIG_ANY_DEVICE 0xffffu
+
+class SignaturePack {
+public:
+    // Maps a compiled pack file; null (with a message in error) if invalid
+    static std::shared_ptr<const SignaturePack> load(const std::string& path, std::string& error);
+    // Compiles source text in memory
+    static std::shared_ptr<const SignaturePack> compile(const std::string& source, std::string& error);
+
+    ~SignaturePack();
+    SignaturePack(const SignaturePack&) = delete;
+    SignaturePack& operator=(const SignaturePack&) = delete;
+
+    uint32_t generation() const { return header()->generation; }
+    const std::string& origin() const { return origin_; }
+
+    // Calls on_match(pattern) for every pattern occurrence in input
+    template <typename F>
+    void scan(SigSet set, std::string_view input, F&& on_match) const {
+        const SigAutomatonHeader* a = automaton(set);
+        if (!a) return;
+        const uint32_t* delta = array(a, a->delta_offset);
+        const uint32_t* out_index = array(a, a->out_index_offset);
+        const uint32_t* out_ids = array(a, a->out_ids_offset);
+        const uint32_t* patterns = array(a, a->patterns_offset);
+        uint32_t state = 0;
+        for (unsigned char c : input) {
+            state = delta[state * a->num_classes + a->classmap[c]];
+            for (uint32_t i = out_index[state]; i < out_index[state + 1]; i++)
+                on_match(text(patterns[out_ids[i]]));
+        }
+    }
+
+    // Pattern of the earliest-ending occurrence in input, or null
+    const char* findFirst(SigSet set, std::string_view input) const;
+
+    // Label of a matching entry, or null
+    const char* matchPci(uint16_t vendor, uint16_t device) const;
+    const char* matchUsb(uint16_t vendor, uint16_t product) const;
+    const char* matchOui(uint32_t oui) const;
+    bool hasModule(std::string_view name) const;
+
+    // Number of entries in a hash table section
+    size_t tableSize(SigSection section) const;
+
+private:
+    SignaturePack() = default;
+    bool validate(std::string& error);
+
+    const SigPackHeader* header() const { return reinterpret_cast<const SigPackHeader*>(data_); }
+    const char* section(SigSection s) const;
+    const SigAutomatonHeader* automaton(SigSet set) const;
+    const char* text(uint32_t offset) const { return strings_ + offset; }
+    static const uint32_t* array(const SigAutomatonHeader* a, uint32_t offset) {
+        return reinterpret_cast<const uint32_t*>(reinterpret_cast<const char*>(a) + offset);
+    }
+    const char* lookup(SigSection table, uint32_t key, std::string_view name = std::string_view()) const;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    void* map_ = nullptr;            // set when the pack is an mmap'ed file
+    std::vector<char> owned_;        // set when the pack was compiled in memory
+    const char* strings_ = nullptr;
+    std::string origin_;
+};
+
+// Compiles signature source text into pack bytes; false with error on bad input
+bool compileSignaturePack(const std::string& source, std::vector<char>& pack, std::string& error);
+
+// The signature source compiled into the binary
+const char* builtinSignatureSource();
+
+// FNV-1a, the key of the modules table
+uint32_t signatureHash(std::string_view text);
+
+// Pack path, settable with -p; the built-in signatures are used when it is missing
+extern std::string signature_pack_path;
+
+// Pack in use. Callers keep the returned pointer for the whole probe, so a
+// reload never pulls the tables out from under a running scan.
+std::shared_ptr<const SignaturePack> currentSignatures();
+
+// Loads signature_pack_path (or the built-in source) and swaps it in atomically.
+// On failure the previous pack stays active.
+bool loadSignatures();
+
+// Async-signal-safe: asks the next reloadSignaturesIfRequested() to reload
+void requestSignatureReload();
+void reloadSignaturesIfRequested();
+
+#endif // SIGPACK_H
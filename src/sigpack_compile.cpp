@@ -0,0 +1,79 @@
+/**
+    Compiles a signature source file into the pack mapped by vm_detection
+    (see sigpack.h).
+
+    Usage: sigpack_compile -o signatures.pack signatures.txt
+           sigpack_compile -d    print the built-in source as a starting point
+
+    Install the pack at the default path or pass it with -p, then send
+    SIGHUP to a running daemon to switch to it.
+ */
+#include "sigpack.h"
+#include "file_reader.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <unistd.h>
+
+static void usage() {
+    std::cerr << "Usage: sigpack_compile -o signatures.pack signatures.txt" << std::endl;
+    std::cerr << "       sigpack_compile -d" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const char* output = nullptr;
+    int option;
+    while ((option = getopt(argc, argv, "o:d")) != -1) {
+        switch (option) {
+            case 'o': output = optarg; break;
+            case 'd':
+                std::cout << builtinSignatureSource();
+                return 0;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (!output || optind + 1 != argc) {
+        usage();
+        return 1;
+    }
+
+    FileReader source;
+    if (!source.read(argv[optind])) {
+        std::cerr << "Cannot read " << argv[optind] << std::endl;
+        return 1;
+    }
+
+    std::vector<char> pack;
+    std::string error;
+    if (!compileSignaturePack(std::string(source.data()), pack, error)) {
+        std::cerr << argv[optind] << ": " << error << std::endl;
+        return 1;
+    }
+
+    // Write beside the target and rename, so running daemons never map a partial pack
+    std::string tmp = std::string(output) + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(pack.data(), pack.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), output) != 0) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<const SignaturePack> check = SignaturePack::load(output, error);
+    if (!check) {
+        std::cerr << "Written pack does not validate: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << output << " (generation " << check->generation() << ", "
+              << pack.size() << " bytes): "
+              << check->tableSize(SIG_SECTION_PCI) << " PCI IDs, "
+              << check->tableSize(SIG_SECTION_USB) << " USB IDs, "
+              << check->tableSize(SIG_SECTION_OUI) << " OUIs, "
+              << check->tableSize(SIG_SECTION_MODULES) << " modules" << std::endl;
+    return 0;
+}
@@ -0,0 +1,371 @@
+#include "squashfs.h"
+#include <cstring>
+#include <zlib.h>
+#include <lzma.h>
+
+namespace {
+
+// The on-disk format is little-endian, like every host this tool targets
+template <typename T>
+T load(const char* p) {
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+bool SquashImage::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
+
+bool SquashImage::open(std::string_view image, std::string& error) {
+    image_ = image;
+    metadata_cache_.clear();
+    fragment_index_ = SQUASHFS_NO_FRAGMENT;
+    sb_ = SquashSuperblock();
+
+    const char* p = image.data();
+    if (image.size() < SQUASHFS_SUPERBLOCK_SIZE || load<uint32_t>(p) != SQUASHFS_MAGIC) {
+        error = "not a SquashFS image";
+        return false;
+    }
+    sb_.inode_count = load<uint32_t>(p + 4);
+    sb_.block_size = load<uint32_t>(p + 12);
+    sb_.fragment_count = load<uint32_t>(p + 16);
+    sb_.compression = load<uint16_t>(p + 20);
+    sb_.flags = load<uint16_t>(p + 24);
+    sb_.version_major = load<uint16_t>(p + 28);
+    sb_.version_minor = load<uint16_t>(p + 30);
+    sb_.root_inode = load<uint64_t>(p + 32);
+    sb_.bytes_used = load<uint64_t>(p + 40);
+    sb_.inode_table = load<uint64_t>(p + 64);
+    sb_.directory_table = load<uint64_t>(p + 72);
+    sb_.fragment_table = load<uint64_t>(p + 80);
+
+    if (sb_.version_major != 4) {
+        error = "unsupported SquashFS version " + std::to_string(sb_.version_major) + "." + std::to_string(sb_.version_minor);
+        return false;
+    }
+    if (sb_.block_size < 4096 || sb_.block_size > (1u << 20) || (sb_.block_size & (sb_.block_size - 1)) != 0) {
+        error = "bad block size";
+        return false;
+    }
+    if (sb_.bytes_used > image.size() || sb_.inode_table >= sb_.bytes_used || sb_.directory_table >= sb_.bytes_used) {
+        error = "truncated image";
+        return false;
+    }
+    if (sb_.compression != SQUASHFS_ZLIB && sb_.compression != SQUASHFS_XZ && sb_.compression != SQUASHFS_LZMA) {
+        error = std::string("unsupported compression: ") + compressionName();
+        return false;
+    }
+    return true;
+}
+
+const char* SquashImage::compressionName() const {
+    switch (sb_.compression) {
+        case SQUASHFS_ZLIB: return "gzip";
+        case SQUASHFS_LZMA: return "lzma";
+        case SQUASHFS_LZO: return "lzo";
+        case SQUASHFS_XZ: return "xz";
+        case SQUASHFS_LZ4: return "lz4";
+        case SQUASHFS_ZSTD: return "zstd";
+        default: return "unknown";
+    }
+}
+
+bool SquashImage::decompress(std::string_view in, size_t max_out, std::string& out) {
+    out.resize(max_out);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in.data());
+    uint8_t* dst = reinterpret_cast<uint8_t*>(&out[0]);
+
+    if (sb_.compression == SQUASHFS_ZLIB) {
+        uLongf out_len = max_out;
+        if (uncompress(dst, &out_len, src, in.size()) != Z_OK) return fail("zlib stream is corrupt");
+        out.resize(out_len);
+        return true;
+    }
+    if (sb_.compression == SQUASHFS_XZ) {
+        uint64_t memlimit = UINT64_MAX;
+        size_t in_pos = 0, out_pos = 0;
+        if (lzma_stream_buffer_decode(&memlimit, 0, nullptr, src, &in_pos, in.size(), dst, &out_pos, max_out) != LZMA_OK)
+            return fail("xz stream is corrupt");
+        out.resize(out_pos);
+        return true;
+    }
+
+    // Legacy lzma: the "lzma alone" container
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_alone_decoder(&stream, UINT64_MAX) != LZMA_OK) return fail("lzma decoder init failed");
+    stream.next_in = src;
+    stream.avail_in = in.size();
+    stream.next_out = dst;
+    stream.avail_out = max_out;
+    lzma_ret ret = lzma_code(&stream, LZMA_FINISH);
+    size_t produced = max_out - stream.avail_out;
+    lzma_end(&stream);
+    if (ret != LZMA_STREAM_END && ret != LZMA_OK) return fail("lzma stream is corrupt");
+    out.resize(produced);
+    return true;
+}
+
+const std::string* SquashImage::metadataBlock(uint64_t offset, uint64_t& next) {
+    auto cached = metadata_cache_.find(offset);
+    if (cached != metadata_cache_.end()) {
+        next = cached->second.next;
+        return &cached->second.data;
+    }
+    if (!inImage(offset, 2)) {
+        fail("metadata block outside the image");
+        return nullptr;
+    }
+    uint16_t header = load<uint16_t>(image_.data() + offset);
+    uint32_t size = header & ~SQUASHFS_METADATA_UNCOMPRESSED;
+    if (size == 0 || size > SQUASHFS_METADATA_SIZE || !inImage(offset + 2, size)) {
+        fail("bad metadata block");
+        return nullptr;
+    }
+
+    CachedBlock block;
+    std::string_view raw = image_.substr(offset + 2, size);
+    if (header & SQUASHFS_METADATA_UNCOMPRESSED) block.data.assign(raw.data(), raw.size());
+    else if (!decompress(raw, SQUASHFS_METADATA_SIZE, block.data)) return nullptr;
+    block.next = offset + 2 + size;
+    next = block.next;
+    return &metadata_cache_.emplace(offset, std::move(block)).first->second.data;
+}
+
+bool SquashImage::readMetadata(uint64_t& block, uint32_t& offset, void* out, size_t len) {
+    char* dst = static_cast<char*>(out);
+    while (len > 0) {
+        uint64_t next;
+        const std::string* data = metadataBlock(block, next);
+        if (!data) return false;
+        if (offset >= data->size()) {
+            if (offset > data->size()) return fail("metadata offset past block end");
+            block = next;
+            offset = 0;
+            continue;
+        }
+        size_t n = std::min(len, data->size() - offset);
+        memcpy(dst, data->data() + offset, n);
+        dst += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool SquashImage::readInode(uint64_t ref, SquashInode& inode) {
+    uint64_t block = sb_.inode_table + (ref >> 16);
+    uint32_t offset = ref & 0xffff;
+    inode = SquashInode();
+
+    char header[16];
+    if (!readMetadata(block, offset, header, sizeof(header))) return false;
+    inode.type = load<uint16_t>(header);
+    inode.mode = load<uint16_t>(header + 2);
+    inode.number = load<uint32_t>(header + 12);
+
+    char body[40];
+    switch (inode.type) {
+        case SQUASHFS_DIR:
+            if (!readMetadata(block, offset, body, 16)) return false;
+            inode.dir_block = load<uint32_t>(body);
+            inode.dir_size = load<uint16_t>(body + 8);
+            inode.dir_offset = load<uint16_t>(body + 10);
+            return true;
+        case SQUASHFS_EXT_DIR:
+            if (!readMetadata(block, offset, body, 24)) return false;
+            inode.dir_size = load<uint32_t>(body + 4);
+            inode.dir_block = load<uint32_t>(body + 8);
+            inode.dir_offset = load<uint16_t>(body + 18);
+            return true;
+        case SQUASHFS_FILE:
+            if (!readMetadata(block, offset, body, 16)) return false;
+            inode.blocks_start = load<uint32_t>(body);
+            inode.fragment = load<uint32_t>(body + 4);
+            inode.fragment_offset = load<uint32_t>(body + 8);
+            inode.file_size = load<uint32_t>(body + 12);
+            break;
+        case SQUASHFS_EXT_FILE:
+            if (!readMetadata(block, offset, body, 40)) return false;
+            inode.blocks_start = load<uint64_t>(body);
+            inode.file_size = load<uint64_t>(body + 8);
+            inode.fragment = load<uint32_t>(body + 28);
+            inode.fragment_offset = load<uint32_t>(body + 32);
+            break;
+        case SQUASHFS_SYMLINK:
+        case SQUASHFS_EXT_SYMLINK: {
+            if (!readMetadata(block, offset, body, 8)) return false;
+            uint32_t target_size = load<uint32_t>(body + 4);
+            if (target_size > 4096) return fail("symlink target too long");
+            inode.target.resize(target_size);
+            return readMetadata(block, offset, &inode.target[0], target_size);
+        }
+        default:
+            return true;
+    }
+
+    // A tail in a fragment means the last partial block is not in the list
+    uint64_t count = inode.file_size / sb_.block_size;
+    if (inode.fragment == SQUASHFS_NO_FRAGMENT && inode.file_size % sb_.block_size != 0) count++;
+    if (count * sizeof(uint32_t) > sb_.bytes_used) return fail("bad file size");
+    inode.block_sizes.resize(count);
+    return readMetadata(block, offset, inode.block_sizes.data(), count * sizeof(uint32_t));
+}
+
+bool SquashImage::listDirectory(const SquashInode& dir, std::vector<SquashDirEntry>& entries) {
+    entries.clear();
+    if (!dir.isDirectory()) return fail("not a directory");
+    // The listing size counts the implicit "." and ".." as 3 bytes
+    if (dir.dir_size <= 3) return true;
+
+    uint64_t block = sb_.directory_table + dir.dir_block;
+    uint32_t offset = dir.dir_offset;
+    int64_t remaining = static_cast<int64_t>(dir.dir_size) - 3;
+    char header[12], entry[8];
+    char name[257];
+
+    while (remaining >= static_cast<int64_t>(sizeof(header))) {
+        if (!readMetadata(block, offset, header, sizeof(header))) return false;
+        remaining -= sizeof(header);
+        uint32_t count = load<uint32_t>(header) + 1;
+        uint32_t start = load<uint32_t>(header + 4);
+        if (count > 256) return fail("bad directory header");
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!readMetadata(block, offset, entry, sizeof(entry))) return false;
+            uint16_t name_size = load<uint16_t>(entry + 6) + 1;
+            if (name_size > 256 || !readMetadata(block, offset, name, name_size)) return fail("bad directory entry");
+            remaining -= sizeof(entry) + name_size;
+
+            SquashDirEntry& out = entries.emplace_back();
+            out.name.assign(name, name_size);
+            out.inode_ref = (static_cast<uint64_t>(start) << 16) | load<uint16_t>(entry);
+            out.type = load<uint16_t>(entry + 4);
+        }
+    }
+    return true;
+}
+
+bool SquashImage::lookup(std::string_view path, SquashInode& inode, bool follow_last) {
+    return resolve(path, inode, follow_last, 0);
+}
+
+bool SquashImage::resolve(std::string_view path, SquashInode& inode, bool follow_last, int depth) {
+    if (depth > 16) return fail("too many levels of symbolic links");
+
+    std::vector<std::string_view> parts;
+    while (!path.empty()) {
+        size_t slash = path.find('/');
+        std::string_view part = path.substr(0, slash);
+        if (!part.empty() && part != ".") parts.push_back(part);
+        path = slash == std::string_view::npos ? std::string_view() : path.substr(slash + 1);
+    }
+
+    SquashInode current;
+    if (!readInode(sb_.root_inode, current)) return false;
+    std::string walked;                  // directories traversed so far, for relative links
+    std::vector<SquashDirEntry> entries;
+
+    for (size_t i = 0; i < parts.size(); i++) {
+        std::string rest;
+        for (size_t j = i + 1; j < parts.size(); j++) rest += "/" + std::string(parts[j]);
+
+        if (parts[i] == "..") {
+            size_t slash = walked.rfind('/');
+            walked = slash == std::string::npos ? std::string() : walked.substr(0, slash);
+            return resolve(walked + rest, inode, follow_last, depth + 1);
+        }
+        if (!listDirectory(current, entries)) return false;
+
+        const SquashDirEntry* match = nullptr;
+        for (const auto& entry : entries) {
+            if (entry.name == parts[i]) {
+                match = &entry;
+                break;
+            }
+        }
+        if (!match) return fail("no such file: " + std::string(parts[i]));
+
+        SquashInode child;
+        if (!readInode(match->inode_ref, child)) return false;
+        bool last = i + 1 == parts.size();
+        if (child.isSymlink() && (!last || follow_last)) {
+            if (child.target.empty()) return fail("empty symlink: " + std::string(parts[i]));
+            std::string target = child.target[0] == '/' ? child.target : walked + "/" + child.target;
+            return resolve(target + rest, inode, follow_last, depth + 1);
+        }
+        if (!last && !child.isDirectory()) return fail("not a directory: " + std::string(parts[i]));
+        walked += "/" + std::string(parts[i]);
+        current = std::move(child);
+    }
+    inode = std::move(current);
+    return true;
+}
+
+bool SquashImage::readBlock(uint32_t size_field, uint64_t offset, std::string& out) {
+    uint32_t size = size_field & ~SQUASHFS_BLOCK_UNCOMPRESSED;
+    if (size > sb_.block_size || !inImage(offset, size)) return fail("data block outside the image");
+    std::string_view raw = image_.substr(offset, size);
+    if (size_field & SQUASHFS_BLOCK_UNCOMPRESSED) {
+        out.assign(raw.data(), raw.size());
+        return true;
+    }
+    return decompress(raw, sb_.block_size, out);
+}
+
+bool SquashImage::fragmentBlock(uint32_t index, std::string& out) {
+    if (index == fragment_index_) {
+        out = fragment_data_;
+        return true;
+    }
+    if (index >= sb_.fragment_count) return fail("bad fragment index");
+    // The fragment table is an array of pointers to metadata blocks of 512 entries each
+    uint64_t pointer_index = static_cast<uint64_t>(index / 512) * 8;
+    if (!inImage(sb_.fragment_table, pointer_index) || !inImage(sb_.fragment_table + pointer_index, 8))
+        return fail("fragment table outside the image");
+    uint64_t pointer_offset = sb_.fragment_table + pointer_index;
+    uint64_t block = load<uint64_t>(image_.data() + pointer_offset);
+    uint32_t offset = (index % 512) * 16;
+
+    char entry[16];
+    if (!readMetadata(block, offset, entry, sizeof(entry))) return false;
+    if (!readBlock(load<uint32_t>(entry + 8), load<uint64_t>(entry), fragment_data_)) {
+        fragment_index_ = SQUASHFS_NO_FRAGMENT;
+        return false;
+    }
+    fragment_index_ = index;
+    out = fragment_data_;
+    return true;
+}
+
+bool SquashImage::readFile(const SquashInode& file, size_t max_bytes, std::string& out) {
+    out.clear();
+    if (!file.isFile()) return fail("not a regular file");
+    uint64_t want = std::min<uint64_t>(file.file_size, max_bytes);
+
+    uint64_t offset = file.blocks_start;
+    for (uint32_t size_field : file.block_sizes) {
+        if (out.size() >= want) break;
+        if (size_field == 0) {
+            // Sparse block
+            out.append(sb_.block_size, '\0');
+            continue;
+        }
+        if (!readBlock(size_field, offset, scratch_)) return false;
+        out += scratch_;
+        offset += size_field & ~SQUASHFS_BLOCK_UNCOMPRESSED;
+    }
+
+    if (out.size() < want && file.fragment != SQUASHFS_NO_FRAGMENT) {
+        if (!fragmentBlock(file.fragment, scratch_)) return false;
+        uint64_t tail = file.file_size - static_cast<uint64_t>(file.block_sizes.size()) * sb_.block_size;
+        if (file.fragment_offset + tail > scratch_.size()) return fail("fragment shorter than the file tail");
+        out.append(scratch_, file.fragment_offset, tail);
+    }
+    if (out.size() > want) out.resize(want);
+    return true;
+}
@@ -0,0 +1,141 @@
+#ifndef SQUASHFS_H
+#define SQUASHFS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define SQUASHFS_MAGIC 0x73717368u       // "hsqs"
+#define SQUASHFS_SUPERBLOCK_SIZE 96
+#define SQUASHFS_METADATA_SIZE 8192
+#define SQUASHFS_METADATA_UNCOMPRESSED 0x8000      // in a metadata block header
+#define SQUASHFS_BLOCK_UNCOMPRESSED (1u << 24)      // in a data block size
+#define SQUASHFS_NO_FRAGMENT 0xffffffffu
+#define SQUASHFS_INVALID_TABLE 0xffffffffffffffffull
+
+// Superblock flags
+#define SQUASHFS_FLAG_NO_FRAGMENTS 0x0010
+#define SQUASHFS_FLAG_NO_XATTRS 0x0200
+
+enum SquashCompression : uint16_t {
+    SQUASHFS_ZLIB = 1,
+    SQUASHFS_LZMA = 2,
+    SQUASHFS_LZO = 3,
+    SQUASHFS_XZ = 4,
+    SQUASHFS_LZ4 = 5,
+    SQUASHFS_ZSTD = 6,
+};
+
+enum SquashInodeType : uint16_t {
+    SQUASHFS_DIR = 1,
+    SQUASHFS_FILE = 2,
+    SQUASHFS_SYMLINK = 3,
+    SQUASHFS_EXT_DIR = 8,
+    SQUASHFS_EXT_FILE = 9,
+    SQUASHFS_EXT_SYMLINK = 10,
+};
+
+// The superblock fields the reader uses (little-endian on disk)
+struct SquashSuperblock {
+    uint32_t inode_count = 0;
+    uint32_t block_size = 0;
+    uint32_t fragment_count = 0;
+    uint16_t compression = 0;
+    uint16_t flags = 0;
+    uint16_t version_major = 0;
+    uint16_t version_minor = 0;
+    uint64_t root_inode = 0;
+    uint64_t bytes_used = 0;
+    uint64_t inode_table = 0;
+    uint64_t directory_table = 0;
+    uint64_t fragment_table = 0;
+};
+
+// A decoded inode: directories, regular files and symlinks; devices and the like are "other"
+struct SquashInode {
+    uint16_t type = 0;
+    uint16_t mode = 0;
+    uint32_t number = 0;
+    // Directories
+    uint32_t dir_block = 0;
+    uint32_t dir_offset = 0;
+    uint32_t dir_size = 0;
+    // Regular files
+    uint64_t blocks_start = 0;
+    uint64_t file_size = 0;
+    uint32_t fragment = 0xffffffffu;
+    uint32_t fragment_offset = 0;
+    std::vector<uint32_t> block_sizes;
+    // Symlinks
+    std::string target;
+
+    bool isDirectory() const { return type == SQUASHFS_DIR || type == SQUASHFS_EXT_DIR; }
+    bool isFile() const { return type == SQUASHFS_FILE || type == SQUASHFS_EXT_FILE; }
+    bool isSymlink() const { return type == SQUASHFS_SYMLINK || type == SQUASHFS_EXT_SYMLINK; }
+};
+
+struct SquashDirEntry {
+    std::string name;
+    uint64_t inode_ref = 0;              // metadata block offset << 16 | offset in block
+    uint16_t type = 0;
+};
+
+/**
+    SquashFS 4.0 reader over an image held in memory (a MappedFile, or a
+    file inside an ISO). Only the metadata blocks and data blocks a lookup
+    or read actually touches are decompressed; metadata blocks are cached
+    per reader. zlib, xz and legacy lzma are supported. Not thread-safe:
+    use one reader per thread.
+ */
+class SquashImage {
+public:
+    bool open(std::string_view image, std::string& error);
+
+    const SquashSuperblock& superblock() const { return sb_; }
+    const char* compressionName() const;
+    const std::string& error() const { return error_; }
+
+    bool readInode(uint64_t ref, SquashInode& inode);
+    bool listDirectory(const SquashInode& dir, std::vector<SquashDirEntry>& entries);
+
+    /**
+        Resolves a path from the root ("etc/modules"), following symlinks in
+        every component (merged /usr: "lib" -> "usr/lib"). With
+        follow_last false a final symlink is returned as is.
+     */
+    bool lookup(std::string_view path, SquashInode& inode, bool follow_last = true);
+
+    // Reads up to max_bytes of a regular file into out
+    bool readFile(const SquashInode& file, size_t max_bytes, std::string& out);
+
+private:
+    bool fail(const std::string& message);
+    // [offset, offset + size) lies within bytes_used; offsets come from the image, so no sums that can wrap
+    bool inImage(uint64_t offset, uint64_t size) const { return offset <= sb_.bytes_used && size <= sb_.bytes_used - offset; }
+    // Decompressed metadata block at an absolute image offset, and the offset of the next one
+    const std::string* metadataBlock(uint64_t offset, uint64_t& next);
+    // Reads len bytes of a metadata stream, crossing into following blocks as needed
+    bool readMetadata(uint64_t& block, uint32_t& offset, void* out, size_t len);
+    bool decompress(std::string_view in, size_t max_out, std::string& out);
+    bool readBlock(uint32_t size_field, uint64_t offset, std::string& out);
+    bool fragmentBlock(uint32_t index, std::string& out);
+    bool resolve(std::string_view path, SquashInode& inode, bool follow_last, int depth);
+
+    std::string_view image_;
+    SquashSuperblock sb_;
+    std::string error_;
+
+    struct CachedBlock {
+        std::string data;
+        uint64_t next = 0;
+    };
+    std::unordered_map<uint64_t, CachedBlock> metadata_cache_;
+    std::string scratch_;
+    // Files packed into the same fragment are usually read one after another
+    uint32_t fragment_index_ = 0xffffffffu;
+    std::string fragment_data_;
+};
+
+#endif // SQUASHFS_H
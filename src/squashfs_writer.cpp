@@ -0,0 +1,443 @@
+#include "squashfs_writer.h"
+#include "file_reader.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <lzma.h>
+
+namespace {
+
+template <typename T>
+void store(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Directory entries carry the basic inode type even for extended inodes
+uint16_t basicType(mode_t mode) {
+    if (S_ISDIR(mode)) return SQUASHFS_DIR;
+    if (S_ISLNK(mode)) return SQUASHFS_SYMLINK;
+    return SQUASHFS_FILE;
+}
+
+bool allZero(std::string_view data) {
+    for (char c : data) {
+        if (c) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// A metadata table (inodes, directories, ids) built in memory in 8 KiB blocks
+class SquashWriter::MetadataWriter {
+public:
+    explicit MetadataWriter(SquashWriter& owner) : owner_(owner) {}
+
+    // Reference of the next byte: block start relative to the table << 16 | offset in the block
+    uint64_t ref() const { return (static_cast<uint64_t>(out_.size()) << 16) | pending_.size(); }
+
+    void append(const std::string& data) {
+        pending_ += data;
+        while (pending_.size() >= SQUASHFS_METADATA_SIZE) flush(SQUASHFS_METADATA_SIZE);
+    }
+    const std::string& finish() {
+        if (!pending_.empty()) flush(pending_.size());
+        return out_;
+    }
+
+private:
+    void flush(size_t len) {
+        std::string_view block(pending_.data(), len);
+        uint16_t header;
+        if (owner_.compress(block, packed_)) {
+            header = packed_.size();
+            store(out_, header);
+            out_ += packed_;
+        } else {
+            header = len | SQUASHFS_METADATA_UNCOMPRESSED;
+            store(out_, header);
+            out_.append(block.data(), block.size());
+        }
+        pending_.erase(0, len);
+    }
+
+    SquashWriter& owner_;
+    std::string pending_, out_, packed_;
+};
+
+SquashWriter::SquashWriter(int fd, uint64_t base, SquashCompression compression, uint32_t block_size)
+    : fd_(fd), base_(base), compression_(compression), block_size_(block_size) {
+    root_.mode = S_IFDIR | 0755;
+    root_.mtime = time(nullptr);
+}
+
+void SquashWriter::setOwner(uid_t uid, gid_t gid) {
+    force_owner_ = true;
+    uid_ = uid;
+    gid_ = gid;
+}
+
+bool SquashWriter::add(const std::string& host_path, std::string_view dest, std::string& error) {
+    Node* node = &root_;
+    while (!dest.empty()) {
+        size_t slash = dest.find('/');
+        std::string part(dest.substr(0, slash));
+        dest = slash == std::string_view::npos ? std::string_view() : dest.substr(slash + 1);
+        if (part.empty() || part == ".") continue;
+        if (part == ".." || part.size() > 256) {
+            error = "bad destination component: " + part;
+            return false;
+        }
+
+        auto& child = node->children[part];
+        if (!child) {
+            // Parents of the destination; scan() replaces the attributes of the last one
+            child = std::make_unique<Node>();
+            child->mode = S_IFDIR | 0755;
+            child->mtime = root_.mtime;
+        } else if (!S_ISDIR(child->mode)) {
+            error = part + " is already added as a file";
+            return false;
+        }
+        node = child.get();
+    }
+    return scan(host_path, *node, error);
+}
+
+bool SquashWriter::scan(const std::string& host_path, Node& node, std::string& error) {
+    struct stat st;
+    if (lstat(host_path.c_str(), &st) != 0) {
+        error = host_path + ": " + strerror(errno);
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode) && !node.children.empty()) {
+        error = host_path + ": a file cannot replace a directory";
+        return false;
+    }
+    node.mode = st.st_mode;
+    node.uid = force_owner_ ? uid_ : st.st_uid;
+    node.gid = force_owner_ ? gid_ : st.st_gid;
+    node.mtime = st.st_mtime;
+    node.size = st.st_size;
+    node.host_path = host_path;
+
+    if (S_ISLNK(st.st_mode)) {
+        char target[4096];
+        ssize_t len = readlink(host_path.c_str(), target, sizeof(target));
+        if (len <= 0) {
+            error = host_path + ": unreadable symlink";
+            return false;
+        }
+        node.link_target.assign(target, len);
+        return true;
+    }
+    if (S_ISREG(st.st_mode)) return true;
+    if (!S_ISDIR(st.st_mode)) {
+        error = host_path + ": only files, directories and symlinks can be added";
+        return false;
+    }
+
+    int dirfd = openDirectory(host_path.c_str());
+    if (dirfd < 0) {
+        error = host_path + ": " + strerror(errno);
+        return false;
+    }
+    DirScanner entries(dirfd);
+    const char* name;
+    bool ok = true;
+    while (ok && entries.next(name)) {
+        struct stat child_st;
+        // Sockets, devices and fifos have no place in a live image layer
+        if (fstatat(dirfd, name, &child_st, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !(S_ISREG(child_st.st_mode) || S_ISDIR(child_st.st_mode) || S_ISLNK(child_st.st_mode)))
+            continue;
+        if (strlen(name) > 256) {
+            error = host_path + "/" + name + ": name too long";
+            ok = false;
+            break;
+        }
+        auto& child = node.children[name];
+        if (!child) child = std::make_unique<Node>();
+        ok = scan(host_path + "/" + name, *child, error);
+    }
+    close(dirfd);
+    return ok;
+}
+
+void SquashWriter::number(Node& node) {
+    // Children first: a directory's listing needs their inode numbers
+    for (auto& child : node.children) number(*child.second);
+    node.number = ++next_number_;
+}
+
+uint16_t SquashWriter::idIndex(uint32_t id) {
+    for (size_t i = 0; i < ids_.size(); i++) {
+        if (ids_[i] == id) return i;
+    }
+    ids_.push_back(id);
+    return ids_.size() - 1;
+}
+
+bool SquashWriter::compress(std::string_view in, std::string& out) {
+    if (compression_ == SQUASHFS_ZLIB) {
+        uLongf len = compressBound(in.size());
+        out.resize(len);
+        if (compress2(reinterpret_cast<Bytef*>(&out[0]), &len, reinterpret_cast<const Bytef*>(in.data()),
+                      in.size(), Z_BEST_COMPRESSION) != Z_OK)
+            return false;
+        out.resize(len);
+        return len < in.size();
+    }
+
+    // The kernel's xz decoder preallocates a dictionary of one block, so say so in the stream
+    lzma_options_lzma options;
+    if (lzma_lzma_preset(&options, LZMA_PRESET_DEFAULT)) return false;
+    options.dict_size = block_size_;
+    lzma_filter filters[] = {{LZMA_FILTER_LZMA2, &options}, {LZMA_VLI_UNKNOWN, nullptr}};
+    out.resize(lzma_stream_buffer_bound(in.size()));
+    size_t len = 0;
+    if (lzma_stream_buffer_encode(filters, LZMA_CHECK_CRC32, nullptr, reinterpret_cast<const uint8_t*>(in.data()),
+                                  in.size(), reinterpret_cast<uint8_t*>(&out[0]), &len, out.size()) != LZMA_OK)
+        return false;
+    out.resize(len);
+    return len < in.size();
+}
+
+bool SquashWriter::put(const void* data, size_t len, std::string& error) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t written = pwrite(fd_, p, len, base_ + pos_);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            error = std::string("write failed: ") + strerror(errno);
+            return false;
+        }
+        p += written;
+        len -= written;
+        pos_ += written;
+    }
+    return true;
+}
+
+bool SquashWriter::writeData(Node& node, uint64_t& blocks_start, std::vector<uint32_t>& sizes, std::string& error) {
+    blocks_start = pos_;
+    sizes.clear();
+    int fd = open(node.host_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = node.host_path + ": " + strerror(errno);
+        return false;
+    }
+
+    uint64_t total = 0;
+    bool ok = true;
+    block_.resize(block_size_);
+    while (ok) {
+        size_t len = 0;
+        while (len < block_size_) {
+            ssize_t n = read(fd, &block_[len], block_size_ - len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                error = node.host_path + ": " + strerror(errno);
+                ok = false;
+            }
+            if (n <= 0) break;
+            len += n;
+        }
+        if (!ok || len == 0) break;
+        total += len;
+
+        std::string_view block(block_.data(), len);
+        if (len == block_size_ && allZero(block)) {
+            sizes.push_back(0);
+        } else if (compress(block, packed_)) {
+            sizes.push_back(packed_.size());
+            ok = put(packed_.data(), packed_.size(), error);
+        } else {
+            sizes.push_back(len | SQUASHFS_BLOCK_UNCOMPRESSED);
+            ok = put(block.data(), len, error);
+        }
+        if (len < block_size_) break;
+    }
+    close(fd);
+    // The file may have changed since it was scanned; the inode records what was stored
+    node.size = total;
+    return ok;
+}
+
+bool SquashWriter::writeNode(Node& node, uint32_t parent, MetadataWriter& inodes, MetadataWriter& dirs, std::string& error) {
+    std::string inode;
+    uint16_t uid = idIndex(node.uid);
+    uint16_t gid = idIndex(node.gid);
+    if (ids_.size() > 0xffff) {
+        error = "too many distinct owners";
+        return false;
+    }
+
+    auto header = [&](uint16_t type) {
+        store<uint16_t>(inode, type);
+        store<uint16_t>(inode, node.mode & 07777);
+        store<uint16_t>(inode, uid);
+        store<uint16_t>(inode, gid);
+        store<uint32_t>(inode, node.mtime);
+        store<uint32_t>(inode, node.number);
+    };
+
+    if (S_ISDIR(node.mode)) {
+        uint32_t subdirs = 0;
+        for (auto& child : node.children) {
+            if (!writeNode(*child.second, node.number, inodes, dirs, error)) return false;
+            if (S_ISDIR(child.second->mode)) subdirs++;
+        }
+
+        // Runs of entries share a header while their inodes share a metadata block
+        std::string listing;
+        auto it = node.children.begin();
+        while (it != node.children.end()) {
+            uint32_t start = it->second->inode_ref >> 16;
+            uint32_t base = it->second->number;
+            auto end = it;
+            uint32_t count = 0;
+            while (end != node.children.end() && count < 256 && (end->second->inode_ref >> 16) == start &&
+                   static_cast<int64_t>(end->second->number) - base <= 32767) {
+                ++end;
+                ++count;
+            }
+            store<uint32_t>(listing, count - 1);
+            store<uint32_t>(listing, start);
+            store<uint32_t>(listing, base);
+            for (; it != end; ++it) {
+                const Node& child = *it->second;
+                store<uint16_t>(listing, child.inode_ref & 0xffff);
+                store<int16_t>(listing, static_cast<int16_t>(child.number - base));
+                store<uint16_t>(listing, basicType(child.mode));
+                store<uint16_t>(listing, it->first.size() - 1);
+                listing += it->first;
+            }
+        }
+
+        uint64_t dir_ref = dirs.ref();
+        dirs.append(listing);
+        uint64_t file_size = listing.size() + 3;
+        if (file_size <= 0xffff) {
+            header(SQUASHFS_DIR);
+            store<uint32_t>(inode, dir_ref >> 16);
+            store<uint32_t>(inode, 2 + subdirs);
+            store<uint16_t>(inode, file_size);
+            store<uint16_t>(inode, dir_ref & 0xffff);
+            store<uint32_t>(inode, parent);
+        } else {
+            header(SQUASHFS_EXT_DIR);
+            store<uint32_t>(inode, 2 + subdirs);
+            store<uint32_t>(inode, file_size);
+            store<uint32_t>(inode, dir_ref >> 16);
+            store<uint32_t>(inode, parent);
+            store<uint16_t>(inode, 0);               // no directory index
+            store<uint16_t>(inode, dir_ref & 0xffff);
+            store<uint32_t>(inode, 0xffffffffu);     // no xattrs
+        }
+    } else if (S_ISLNK(node.mode)) {
+        header(SQUASHFS_SYMLINK);
+        store<uint32_t>(inode, 1);
+        store<uint32_t>(inode, node.link_target.size());
+        inode += node.link_target;
+    } else {
+        uint64_t blocks_start;
+        std::vector<uint32_t> sizes;
+        if (!writeData(node, blocks_start, sizes, error)) return false;
+        if (blocks_start <= 0xffffffffu && node.size <= 0xffffffffu) {
+            header(SQUASHFS_FILE);
+            store<uint32_t>(inode, blocks_start);
+            store<uint32_t>(inode, SQUASHFS_NO_FRAGMENT);
+            store<uint32_t>(inode, 0);
+            store<uint32_t>(inode, node.size);
+        } else {
+            header(SQUASHFS_EXT_FILE);
+            store<uint64_t>(inode, blocks_start);
+            store<uint64_t>(inode, node.size);
+            store<uint64_t>(inode, 0);               // sparse bytes, informational
+            store<uint32_t>(inode, 1);
+            store<uint32_t>(inode, SQUASHFS_NO_FRAGMENT);
+            store<uint32_t>(inode, 0);
+            store<uint32_t>(inode, 0xffffffffu);
+        }
+        for (uint32_t size : sizes) store<uint32_t>(inode, size);
+    }
+
+    node.inode_ref = inodes.ref();
+    inodes.append(inode);
+    return true;
+}
+
+bool SquashWriter::write(uint64_t& written, std::string& error) {
+    if (compression_ != SQUASHFS_ZLIB && compression_ != SQUASHFS_XZ) {
+        error = "only gzip and xz layers can be written";
+        return false;
+    }
+    next_number_ = 0;
+    number(root_);
+    inode_count_ = next_number_;
+
+    // Data blocks follow the superblock; the tables come after all data
+    pos_ = SQUASHFS_SUPERBLOCK_SIZE;
+    MetadataWriter inodes(*this), dirs(*this), ids(*this);
+    // mksquashfs gives the root a parent one past the last inode
+    if (!writeNode(root_, next_number_ + 1, inodes, dirs, error)) return false;
+
+    uint64_t inode_table = pos_;
+    const std::string& inode_data = inodes.finish();
+    if (!put(inode_data.data(), inode_data.size(), error)) return false;
+    uint64_t directory_table = pos_;
+    const std::string& dir_data = dirs.finish();
+    if (!put(dir_data.data(), dir_data.size(), error)) return false;
+
+    // Id table: metadata blocks of ids, then an index of their offsets
+    std::string id_list;
+    for (uint32_t id : ids_) store<uint32_t>(id_list, id);
+    ids.append(id_list);
+    uint64_t id_blocks = pos_;
+    const std::string& id_data = ids.finish();
+    if (!put(id_data.data(), id_data.size(), error)) return false;
+    std::string id_index;
+    for (size_t offset = 0; offset < id_data.size();) {
+        store<uint64_t>(id_index, id_blocks + offset);
+        uint16_t header;
+        memcpy(&header, id_data.data() + offset, sizeof(header));
+        offset += 2 + (header & ~SQUASHFS_METADATA_UNCOMPRESSED);
+    }
+    uint64_t id_table = pos_;
+    if (!put(id_index.data(), id_index.size(), error)) return false;
+    uint64_t bytes_used = pos_;
+
+    uint16_t block_log = 0;
+    while ((1u << block_log) < block_size_) block_log++;
+    std::string sb;
+    store<uint32_t>(sb, SQUASHFS_MAGIC);
+    store<uint32_t>(sb, inode_count_);
+    store<uint32_t>(sb, time(nullptr));
+    store<uint32_t>(sb, block_size_);
+    store<uint32_t>(sb, 0);                          // fragments
+    store<uint16_t>(sb, compression_);
+    store<uint16_t>(sb, block_log);
+    store<uint16_t>(sb, SQUASHFS_FLAG_NO_FRAGMENTS | SQUASHFS_FLAG_NO_XATTRS);
+    store<uint16_t>(sb, ids_.size());
+    store<uint16_t>(sb, 4);
+    store<uint16_t>(sb, 0);
+    store<uint64_t>(sb, root_.inode_ref);
+    store<uint64_t>(sb, bytes_used);
+    store<uint64_t>(sb, id_table);
+    store<uint64_t>(sb, SQUASHFS_INVALID_TABLE);     // xattrs
+    store<uint64_t>(sb, inode_table);
+    store<uint64_t>(sb, directory_table);
+    store<uint64_t>(sb, SQUASHFS_INVALID_TABLE);     // fragments
+    store<uint64_t>(sb, SQUASHFS_INVALID_TABLE);     // export
+    // Block devices read in 4 KiB units, so pad like mksquashfs
+    std::string padding((4096 - bytes_used % 4096) % 4096, '\0');
+    if (!put(padding.data(), padding.size(), error)) return false;
+    written = pos_;
+    pos_ = 0;
+    return put(sb.data(), sb.size(), error);
+}
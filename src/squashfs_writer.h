@@ -0,0 +1,77 @@
+#ifndef SQUASHFS_WRITER_H
+#define SQUASHFS_WRITER_H
+
+#include "squashfs.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+/**
+    Writes a SquashFS 4.0 image from host files straight into a file
+    descriptor at a given offset, so a layer can be streamed into the free
+    space at the end of an ISO without a scratch copy. Data is read and
+    compressed one block at a time; only the tree's metadata is kept in
+    memory. Tails are stored as short blocks (no fragments), all-zero
+    blocks as sparse, and there are no xattrs. The result mounts as an
+    overlay layer: synthesized parent directories are root-owned 0755.
+ */
+class SquashWriter {
+public:
+    SquashWriter(int fd, uint64_t base, SquashCompression compression, uint32_t block_size = 128 * 1024);
+
+    // Files written with this owner instead of the host's (e.g. the live user)
+    void setOwner(uid_t uid, gid_t gid);
+
+    // Adds a host file or directory tree at dest ("home/user/project")
+    bool add(const std::string& host_path, std::string_view dest, std::string& error);
+
+    // Writes the image; written is its size including the padding to 4 KiB
+    bool write(uint64_t& written, std::string& error);
+
+    size_t inodeCount() const { return inode_count_; }
+
+private:
+    struct Node {
+        mode_t mode = 0;
+        uid_t uid = 0;
+        gid_t gid = 0;
+        uint32_t mtime = 0;
+        uint64_t size = 0;
+        std::string host_path;                        // empty for synthesized directories
+        std::string link_target;
+        std::map<std::string, std::unique_ptr<Node>> children;    // sorted, as SquashFS requires
+        // Assigned while writing
+        uint32_t number = 0;
+        uint64_t inode_ref = 0;
+    };
+    class MetadataWriter;
+
+    bool scan(const std::string& host_path, Node& node, std::string& error);
+    void number(Node& node);
+    bool writeData(Node& node, uint64_t& blocks_start, std::vector<uint32_t>& sizes, std::string& error);
+    bool writeNode(Node& node, uint32_t parent, MetadataWriter& inodes, MetadataWriter& dirs, std::string& error);
+    bool compress(std::string_view in, std::string& out);
+    bool put(const void* data, size_t len, std::string& error);
+    uint16_t idIndex(uint32_t id);
+
+    int fd_;
+    uint64_t base_;
+    SquashCompression compression_;
+    uint32_t block_size_;
+    bool force_owner_ = false;
+    uid_t uid_ = 0;
+    gid_t gid_ = 0;
+
+    Node root_;
+    uint64_t pos_ = 0;                                // relative to base_
+    uint32_t next_number_ = 0;
+    size_t inode_count_ = 0;
+    std::vector<uint32_t> ids_;
+    std::string block_, packed_;                      // one data block, read and compressed
+};
+
+#endif // SQUASHFS_WRITER_H
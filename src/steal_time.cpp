@@ -0,0 +1,177 @@
+#include "steal_time.h"
+#include "file_reader.h"
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+unsigned int steal_window_ms = 250;
+
+namespace {
+
+// Raw counters for one CPU at one point in time
+struct CpuCounters {
+    bool present = false;
+    uint64_t steal = 0;          // USER_HZ ticks
+    uint64_t total = 0;          // USER_HZ ticks
+    uint64_t run_delay_ns = 0;
+};
+
+struct Snapshot {
+    CpuCounters total;
+    std::vector<CpuCounters> cpus;
+    uint64_t self_run_delay_ns = 0;
+};
+
+/**
+    A procfs file kept open for repeated sampling. Each read starts again at
+    offset 0, where procfs regenerates the contents, and continues to EOF:
+    /proc/stat and /proc/schedstat are seq_file and span several pages on
+    hosts with many CPUs.
+ */
+class ProcFile {
+public:
+    explicit ProcFile(const char* path) : path_(path), reader_(16384) {}
+    ~ProcFile() { if (fd_ >= 0) close(fd_); }
+
+    bool read() {
+        if (fd_ < 0) {
+            fd_ = open(path_, O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0) return false;
+        }
+        return reader_.readFd(fd_);
+    }
+
+    // NUL-terminated contents of the last read
+    const char* buffer() const { return reader_.data().data(); }
+
+private:
+    const char* path_;
+    int fd_ = -1;
+    FileReader reader_;
+};
+
+ProcFile proc_stat("/proc/stat");
+ProcFile proc_schedstat("/proc/schedstat");
+ProcFile self_schedstat("/proc/self/schedstat");
+
+// Parses the numbers after a "cpu" / "cpuN" label, up to max_fields of them
+int parseFields(const char*& p, uint64_t* fields, int max_fields) {
+    int count = 0;
+    while (*p != '\n' && *p != '\0') {
+        while (*p == ' ') p++;
+        if (*p == '\n' || *p == '\0') break;
+        char* end;
+        uint64_t value = strtoull(p, &end, 10);
+        if (end == p) break;
+        if (count < max_fields) fields[count] = value;
+        count++;
+        p = end;
+    }
+    return count;
+}
+
+// Moves p to the start of the next line
+void nextLine(const char*& p) {
+    while (*p != '\n' && *p != '\0') p++;
+    if (*p == '\n') p++;
+}
+
+// Returns the CPU number of a "cpuN" label, -1 for the aggregate "cpu" label
+// and -2 for anything else. Leaves p after the label.
+int parseCpuLabel(const char*& p) {
+    if (strncmp(p, "cpu", 3) != 0) return -2;
+    p += 3;
+    if (*p == ' ') return -1;
+    char* end;
+    long cpu = strtol(p, &end, 10);
+    if (end == p || cpu < 0) return -2;
+    p = end;
+    return static_cast<int>(cpu);
+}
+
+CpuCounters& slot(Snapshot& snap, int cpu) {
+    if (static_cast<size_t>(cpu) >= snap.cpus.size()) snap.cpus.resize(cpu + 1);
+    return snap.cpus[cpu];
+}
+
+bool takeSnapshot(Snapshot& snap) {
+    if (!proc_stat.read()) return false;
+
+    // cpu user nice system idle iowait irq softirq steal guest guest_nice
+    for (const char* p = proc_stat.buffer(); *p; nextLine(p)) {
+        int cpu = parseCpuLabel(p);
+        if (cpu == -2) continue;
+
+        uint64_t f[8] = {0};
+        if (parseFields(p, f, 8) < 8) continue;
+
+        CpuCounters& c = (cpu == -1) ? snap.total : slot(snap, cpu);
+        c.present = true;
+        c.steal = f[7];
+        c.total = f[0] + f[1] + f[2] + f[3] + f[4] + f[5] + f[6] + f[7];
+    }
+
+    // cpuN yld 0 sched_count sched_goidle ttwu ttwu_local rq_cpu_time run_delay pcount
+    if (proc_schedstat.read()) {
+        for (const char* p = proc_schedstat.buffer(); *p; nextLine(p)) {
+            int cpu = parseCpuLabel(p);
+            if (cpu < 0) continue;
+
+            uint64_t f[9] = {0};
+            if (parseFields(p, f, 9) < 8) continue;
+            slot(snap, cpu).run_delay_ns = f[7];
+            snap.total.run_delay_ns += f[7];
+        }
+    }
+
+    // run_ns wait_ns timeslices
+    if (self_schedstat.read()) {
+        const char* p = self_schedstat.buffer();
+        uint64_t f[3] = {0};
+        if (parseFields(p, f, 3) >= 2) snap.self_run_delay_ns = f[1];
+    }
+    return snap.total.present;
+}
+
+CpuStealStats delta(int cpu, const CpuCounters& before, const CpuCounters& after) {
+    CpuStealStats stats;
+    stats.cpu = cpu;
+    stats.steal_ticks = after.steal;
+
+    uint64_t total = after.total - before.total;
+    uint64_t steal = after.steal - before.steal;
+    stats.steal_pct = total ? (100.0 * steal) / total : 0.0;
+    stats.run_delay_ms = (after.run_delay_ns - before.run_delay_ns) / 1e6;
+    return stats;
+}
+
+} // namespace
+
+bool sampleStealTime(unsigned int window_ms, StealReport& report) {
+    Snapshot before, after;
+    report = StealReport();
+    report.window_ms = window_ms;
+
+    if (!takeSnapshot(before)) return false;
+
+    struct timespec ts;
+    ts.tv_sec = window_ms / 1000;
+    ts.tv_nsec = (window_ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+
+    if (!takeSnapshot(after)) return false;
+
+    report.total = delta(-1, before.total, after.total);
+    for (size_t cpu = 0; cpu < after.cpus.size(); cpu++) {
+        if (!after.cpus[cpu].present || cpu >= before.cpus.size() || !before.cpus[cpu].present)
+            continue;
+        report.cpus.push_back(delta(static_cast<int>(cpu), before.cpus[cpu], after.cpus[cpu]));
+    }
+    report.self_run_delay_ms = (after.self_run_delay_ns - before.self_run_delay_ns) / 1e6;
+    report.ok = true;
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef STEAL_TIME_H
+#define STEAL_TIME_H
+
+#include <cstdint>
+#include <vector>
+
+// Steal and run-queue delay for one CPU (cpu == -1 is the all-CPU aggregate)
+struct CpuStealStats {
+    int cpu = -1;
+    double steal_pct = 0.0;      // share of CPU time stolen during the window
+    uint64_t steal_ticks = 0;    // stolen USER_HZ ticks since boot
+    double run_delay_ms = 0.0;   // run-queue wait accumulated during the window
+};
+
+struct StealReport {
+    bool ok = false;
+    unsigned int window_ms = 0;
+    CpuStealStats total;
+    std::vector<CpuStealStats> cpus;
+    double self_run_delay_ms = 0.0;  // time this process spent waiting to run
+};
+
+// Sampling window used by checkStealTime(), settable with -w
+extern unsigned int steal_window_ms;
+
+/**
+    Samples /proc/stat, /proc/schedstat and /proc/self/schedstat twice,
+    window_ms apart. The files are kept open between calls and each sample
+    preads them from offset 0 to EOF, so this is cheap enough to run in
+    daemon mode.
+ */
+bool sampleStealTime(unsigned int window_ms, StealReport& report);
+
+#endif // STEAL_TIME_H
@@ -1,4 +1,20 @@
 #include "vm_detection.h"
+#include "steal_time.h"
+#include "file_reader.h"
+#include "batch_reader.h"
+#include "netlink_links.h"
+#include "oui_db.h"
+#include "sigpack.h"
+#include "descriptor_tables.h"
+#include "arm_platform.h"
+#include "fdt_index.h"
+#include "kernel_snapshot.h"
+#include "container_scan.h"
+#include "scan_history.h"
+#include "pci_inspect.h"
+#include "probe_watchdog.h"
+#include "scan_budget.h"
+#include "hw_fingerprint.h"
 #include <iostream>
 #include <vector>
 #include <fstream>
@@ -8,11 +24,14 @@
 #include <algorithm>
 #include <functional>
 #include <pci/pci.h>
-#include <regex>
-#include <csignal>
-#include <csetjmp>
 #include <cstdint>
 #include <numeric>
+#include <chrono>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <set>
+#include <unistd.h>
+#include <fcntl.h>
 
 #ifdef __x86_64__
     #include <cpuid.h>
@@ -29,69 +48,8 @@ using namespace std;
 OS_TYPE OS = OS_UNKNOWN;
 ARCH_TYPE ARCH = ARCH_UNKNOWN;
 
-//List of Common VM signatures
-vector<string> vm_signatures = {
-    "VMware", "VirtualBox", "VBOX", "QEMU",
-    "KVM", "Microsoft Corporation", "Hyper-V",
-    "Parallels", "Bochs", "BHYVE",
-    "HVM domU", "innotek GmbH", "QEM", "VRT"
-};
-
-
-// List of common VM MAC address prefixes (need to get more accurate)
-const std::vector<std::string> vm_mac_prefixes = {
-    "00:05:69",  // VMware
-    "00:0C:29",  // VMware
-    "00:1C:14",  // VMware
-    "00:50:56",  // VMware
-    "08:00:27",  // VirtualBox
-    "52:54:00",  // QEMU/KVM
-    "00:15:5D",  // Microsoft Hyper-V
-    "00:16:3E",  // Xen
-    "00:1A:4A"   // Parallels
-};
-
-// Known PCI vendor and device IDs for virtual devices
-std::vector<std::string> virtual_device_ids = {
-    "0x15ad:0x0740", // VMware
-    "0x15ad:0x0405", // VMware
-    "0x15ad:0x07a0", // VMware
-    "1234:1111", // QEMU
-    "1af4:1000", // Virtio (QEMU)
-    "80ee:beef", // VirtualBox
-    "10de:1db6", // NVIDIA vGPU for virtual environments
-    "5853:0001", // Xen
-    "5853:0002", // Xen
-};
-
-
-// List of known virtualization-related kernel modules
-std::vector<std::string> virtualization_modules = {
-    "vboxguest",    // VirtualBox Guest Additions
-    "vboxsf",       // VirtualBox Shared Folders
-    "vboxvideo",    // VirtualBox Video Driver
-    "vmw_balloon",  // VMware Balloon Driver
-    "vmw_vmci",     // VMware VMCI Driver
-    "vmw_vsock_vmci_transport", // VMware Vsock Driver
-    "vmw_vsock_virtio_transport_common", // VMware Vsock Virtio Transport
-    "vmwgfx",       // VMware Graphics Driver
-    "vsock",        // Virtual Socket Driver
-    "hyperv",       // Microsoft Hyper-V
-    "hv_utils",     // Hyper-V Utilities
-    "hv_vmbus",     // Hyper-V VMBus
-    "hv_storvsc",   // Hyper-V Storage Driver
-    "kvm",          // Kernel-based Virtual Machine
-    "kvm_intel",    // KVM for Intel Processors
-    "kvm_amd",      // KVM for AMD Processors
-    "xen_netfront", // Xen Network Driver
-    "xen_blkfront", // Xen Block Device Driver
-    "xenfs",        // Xen Filesystem
-    "xen_platform_pci", // Xen Platform PCI Driver
-    "parallels",    // Parallels
-    "prl_fs",       // Parallels Shared Folders
-    "prl_tg",       // Parallels Tools Gate
-    // Add more modules as needed
-};
+// Signature strings, PCI/USB IDs, NIC prefixes and module names live in the
+// signature pack (see sigpack.h); probes take currentSignatures() once per run
 
 //Map for storing all of our tests
 static const std::map<std::string, std::function<bool()>> tests = {
@@ -101,19 +59,53 @@ static const std::map<std::string, std::function<bool()>> tests = {
         {"dmi", checkDMI},
         {"mac", checkMAC},
         {"pci", checkPCI},
+        {"pci-deep", checkPCIDeep},
         {"timing", checkTiming},
         {"desc-tables", checkDescriptorTables},
         {"acpi", checkACPI},
         {"lscpu", checklscpu},
         {"usb", checkUSBDevices},
         {"env", checkEnvVars},
-        {"lsmod", checkLSMod}
+        {"lsmod", checkLSMod},
+        {"steal", checkStealTime},
+        {"fdt", checkDeviceTree}
         // Add more test mappings here as needed
     };
 
 // Test Result map
 std::map<std::string, bool> test_results;
 
+// Per-probe results of the last scan
+std::map<std::string, ProbeResult> probe_results;
+
+// Timing measurements from the last timing/steal probes
+TimingStats timing_stats;
+
+// Result the running probe records its evidence into (null outside runProbe)
+static thread_local ProbeResult* current_probe = nullptr;
+
+// Set while this thread runs probes inside another process's namespaces
+static thread_local const NamespaceScan* namespace_scan = nullptr;
+
+// Tests that only read files, netlink and CPUID; no fork/exec and no host-only state
+const std::vector<std::string> namespace_tests = {
+    "io", "cpu", "cpuid-vendor", "dmi", "mac", "pci", "env", "lsmod", "fdt"
+};
+
+// The kernel snapshot describes the host's namespaces, never a scanned container's
+static const KernelSnapshot* probeSnapshot()
+{
+    return namespace_scan ? nullptr : kernelSnapshot();
+}
+
+void recordEvidence(const std::string& item)
+{
+    if (!current_probe) return;
+    auto& evidence = current_probe->evidence;
+    if (std::find(evidence.begin(), evidence.end(), item) == evidence.end())
+        evidence.push_back(item);
+}
+
 //number of tests
 const int NUMTESTS = tests.size();
 
@@ -125,6 +117,88 @@ void displayHelp()
     cout << "  -h           Display this help message" << endl;
     cout << "  -a           Run all tests" << endl;
     cout << "  -t <test>    Run individual test (e.g., io, cpu)" << endl;
+    cout << "  -d <secs>    Daemon mode: re-run the selected tests every <secs> seconds" << endl;
+    cout << "  -w <ms>      Sampling window for the steal test (default 250)" << endl;
+    cout << "  -s <path>    Publish results to a shared-memory file (e.g. /run/vm_detection/results)" << endl;
+    cout << "  -m <addr>    Serve OpenMetrics on <port>, <host:port> or unix:<path>" << endl;
+    cout << "  -u           Batch sysfs reads through io_uring when available" << endl;
+    cout << "  -O <path>    Compiled OUI registry for MAC attribution (default " << OUI_DB_PATH << ")" << endl;
+    cout << "  -p <path>    Compiled signature pack (default " << SIGPACK_PATH << ", built-in if missing);" << endl;
+    cout << "               SIGHUP reloads it in daemon mode" << endl;
+    cout << "  --mitigate   Scan, load the mitigations for what was detected and exit" << endl;
+    cout << "  --verify     With --mitigate: re-run only the affected probes and diff their evidence" << endl;
+    cout << "  -P           Count cycles, instructions, context switches, page faults and" << endl;
+    cout << "               task-clock per probe with perf_event_open" << endl;
+    cout << "  -k <path>    Kernel snapshot device (default " << VMD_SNAPSHOT_DEVICE << ", used when snapshot_module" << endl;
+    cout << "               is loaded; -k \"\" disables it)" << endl;
+    cout << "  -C <targets> Scan containers from the host: comma-separated PIDs, cgroup:<path> or all;" << endl;
+    cout << "               runs the file/netlink tests inside each one's mount and network namespaces" << endl;
+    cout << "  -j <n>       Worker threads for -C (default " << container_scan_threads << ")" << endl;
+    cout << "  --budget <pct>     Low-impact mode: SCHED_IDLE, at most <pct>% of a CPU (scaled by the cgroup's" << endl;
+    cout << "                     cpu.max) with paced sleeps between batches, and a usage report per scan" << endl;
+    cout << "  --budget-exits <n> With --budget: at most <n> VM exits (cpuid) per second (default "
+         << budget_exits_per_sec << ")" << endl;
+    cout << "  -T <ms>      Time budget per probe (default " << probe_timeout_ms << ", 0 disables); helpers are killed" << endl;
+    cout << "               and the probe reported as timed out when it runs out" << endl;
+    cout << "  -F           Print the hardware fingerprint (CPUID, DMI, ACPI OEM IDs, PCI IDs, NIC OUIs)" << endl;
+    cout << "               with its per-component breakdown and exit" << endl;
+    cout << "  -H <path>    Append every scan to a history log at <path> and report drift" << endl;
+    cout << "  --history <n>      With -H: print the newest <n> records and exit" << endl;
+    cout << "  --since <when>     With -H: what changed since <when> (Unix seconds, or 30m, 6h, 2d ago)" << endl;
+    cout << "  --history-limit <KiB>  Compact the history log past this size (default "
+         << history_max_bytes / 1024 << ")" << endl;
+}
+
+// Counter group reused by every probe when -P is given
+static PerfGroup perf_group;
+
+static void printProbeCounters(const std::string& testName, const ProbeCounters& counters)
+{
+    cout << "[perf] " << testName << ": task-clock " << std::fixed << std::setprecision(3)
+         << counters.task_clock_ns / 1e6 << " ms, " << counters.context_switches << " context switches, "
+         << counters.page_faults << " page faults";
+    if (counters.hardware) {
+        cout << ", " << counters.cycles << " cycles, " << counters.instructions << " instructions";
+        if (counters.cycles > 0)
+            cout << " (IPC " << std::setprecision(2) << static_cast<double>(counters.instructions) / counters.cycles << ")";
+    } else {
+        cout << ", no PMU (software events only)";
+    }
+    if (counters.scaled) cout << ", multiplexed";
+    cout.unsetf(std::ios::floatfield);
+    cout << endl;
+}
+
+// Runs one test on this thread, timing it and collecting its evidence into probe
+static bool measureProbe(ProbeResult& probe, const std::function<bool()>& testFunction)
+{
+    current_probe = &probe;
+    auto start = std::chrono::steady_clock::now();
+    bool result = testFunction();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    current_probe = nullptr;
+
+    probe.detected = result;
+    probe.elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return result;
+}
+
+// Runs one test, timing it and recording the result in probe_results
+static bool runProbe(const std::string& testName, const std::function<bool()>& testFunction)
+{
+    ProbeResult& probe = probe_results[testName];
+    // In budget mode, pay back the previous probe's CPU while idle, outside this probe's deadline
+    budgetPace(0);
+    bool counting = perf_counters_enabled && perf_group.start();
+    armProbeDeadline(testName);
+    bool result = measureProbe(probe, testFunction);
+    probe.timed_out = disarmProbeDeadline(result);
+    if (counting) perf_group.stop(probe.counters);
+
+    if (probe.timed_out)
+        cout << "[watchdog] " << testName << ": timed out after " << probe_timeout_ms << " ms, results are partial" << endl;
+    if (probe.counters.ok) printProbeCounters(testName, probe.counters);
+    return result;
 }
 
 // Function to run all tests
@@ -133,16 +207,21 @@ std::map<std::string, bool> runAllTests()
     int totalTests = tests.size();
     int detected = 0;
     cout << ARCH << endl;
+    probe_results.clear();
+    beginWatchedScan();
+    beginBudgetWindow();
+    refreshKernelSnapshot();
 
     // Run all tests and store results
     for (const auto& [testName, testFunction] : tests) 
     {
-        bool result = testFunction();  // Run the test
+        bool result = runProbe(testName, testFunction);  // Run the test
         test_results[testName] = result;  // Store the result in test_results map
         if (result) {
             detected++;
         }
     }
+    computeHardwareFingerprint(hardware_fingerprint);
 
     // Display results in a formatted box
     cout << "\n\t╔══════════════════════════════════════════════════════════════════╗" << endl;
@@ -156,6 +235,7 @@ std::map<std::string, bool> runAllTests()
     displayResults(test_results);
 
     cout << "\t╚══════════════════════════════════════════════════════════════════╝" << endl;
+    cout << "\tHardware fingerprint: " << formatFingerprint(hardware_fingerprint) << endl;
 
     return test_results;
 }
@@ -168,7 +248,13 @@ int runIndividualTest(const std::string& testName)
     if (it != tests.end()) 
     {
         // Run the test if it exists
-        return it->second();
+        probe_results.clear();
+        beginWatchedScan();
+        beginBudgetWindow();
+        refreshKernelSnapshot();
+        int result = runProbe(it->first, it->second);
+        computeHardwareFingerprint(hardware_fingerprint);
+        return result;
     } 
     else 
     {
@@ -177,6 +263,35 @@ int runIndividualTest(const std::string& testName)
     }
 }
 
+void runSelectedTests(const std::vector<std::string>& testNames)
+{
+    probe_results.clear();
+    beginWatchedScan();
+    beginBudgetWindow();
+    refreshKernelSnapshot();
+    for (const auto& testName : testNames)
+    {
+        auto it = tests.find(testName);
+        if (it == tests.end())
+        {
+            cout << "Unknown test name: " << testName << endl;
+            continue;
+        }
+        test_results[testName] = runProbe(it->first, it->second);
+    }
+    computeHardwareFingerprint(hardware_fingerprint);
+}
+
+void runNamespaceTests(const NamespaceScan& scan, std::map<std::string, ProbeResult>& results)
+{
+    namespace_scan = &scan;
+    for (const auto& testName : namespace_tests) {
+        budgetPace(0);
+        measureProbe(results[testName], tests.at(testName));
+    }
+    namespace_scan = nullptr;
+}
+
 // Function to display test results in box format
 void displayResults(const std::map<std::string, bool> test_results) {
     // Calculate max test name width
@@ -190,7 +305,9 @@ void displayResults(const std::map<std::string, bool> test_results) {
     int totalWidth = maxTestNameWidth + maxResultWidth + 13; // Adjust total width based on max widths
 
     for (const auto& [testName, result] : test_results) {
-        std::string resultText = result ? "Detected" : "Not Detected";
+        auto probe = probe_results.find(testName);
+        bool timed_out = probe != probe_results.end() && probe->second.timed_out;
+        std::string resultText = result ? "Detected" : timed_out ? "Timed Out" : "Not Detected";
         
         // Print line with padding to align right side
         cout << "\t║ Test: " << std::left << std::setw(maxTestNameWidth) << testName
@@ -202,55 +319,111 @@ void displayResults(const std::map<std::string, bool> test_results) {
 //======================================TESTS===========================================
 
 /**
-    Function to check for presence of common virtualization kernel modules
+    Function to measure CPU time stolen by the hypervisor and run-queue delay.
+    Steal is only accounted when the kernel has a paravirtual steal clock, so
+    any nonzero steal is strong evidence of virtualization.
  */
-bool checkLSMod(){
-    std::cout << "\n===== Checking Loaded Kernel Modules (lsmod) =====" << std::endl;
+bool checkStealTime() {
+    std::cout << "\n===== Checking Steal Time and Scheduler Delay =====" << std::endl;
     bool detected = false;
 
-    FILE* pipe = popen("lsmod", "r");
-    if(!pipe)
-    {
-        std::cerr<<"Failed to run lsmod command."<<std::endl;
-        return detected;
-    }
+    // The sampling window never outlasts the probe's budget
+    unsigned int window_ms = steal_window_ms;
+    int remaining_ms = probeRemainingMs();
+    if (remaining_ms >= 0 && window_ms > static_cast<unsigned int>(remaining_ms) / 2)
+        window_ms = std::max(1u, static_cast<unsigned int>(remaining_ms) / 2);
 
-    char buffer[256];
+    StealReport report;
+    if (!sampleStealTime(window_ms, report)) {
+        std::cerr << "Failed to sample /proc/stat." << std::endl;
+        return false;
+    }
 
-    std::vector<std::string> loaded_modules;
+    std::cout << "Sampled over " << report.window_ms << " ms" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& cpu : report.cpus) {
+        std::cout << "  cpu" << cpu.cpu << ": steal " << cpu.steal_pct << "%"
+                  << " (" << cpu.steal_ticks << " ticks since boot)"
+                  << ", run delay " << cpu.run_delay_ms << " ms" << std::endl;
+    }
+    std::cout << "All CPUs: steal " << report.total.steal_pct << "%"
+              << ", run delay " << report.total.run_delay_ms << " ms"
+              << ", own run delay " << report.self_run_delay_ms << " ms" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    timing_stats.steal_pct = report.total.steal_pct;
+    timing_stats.run_delay_ms = report.total.run_delay_ms;
+
+    if (report.total.steal_ticks > 0 || report.total.steal_pct > 0.0) {
+        std::cout << "Nonzero steal time: a hypervisor is accounting stolen CPU time." << std::endl;
+        recordEvidence("steal:nonzero");
+        detected = true;
+    } else {
+        std::cout << "No steal time recorded." << std::endl;
+    }
+    return detected;
+}
 
-    while(fgets(buffer, sizeof(buffer), pipe) != nullptr)
+// Module names from snapshot_module instead of running lsmod
+static bool checkLSModSnapshot(const KernelSnapshot& snapshot)
+{
+    bool detected = false;
+    auto signatures = currentSignatures();
+    auto modules = snapshot.modules();
+    for (size_t i = 0; i < modules.size(); i++)
     {
-        std::string line(buffer);
-        std::istringstream iss(line);
-        std::string module_name;
-
-        if(iss >> module_name)
+        std::string module_name = snapshotString(modules[i].name);
+        if (signatures->hasModule(module_name))
         {
-            loaded_modules.push_back(module_name);
+            std::cout << "Virtualization module detected: " << module_name << std::endl;
+            recordEvidence("module:" + module_name);
+            detected = true;
         }
     }
-    pclose(pipe);
+    if (!detected)
+        std::cout << "No virtualization artifacts detected in " << modules.size() << " loaded kernel modules (kernel snapshot)" << std::endl;
+    return detected;
+}
+
+// Module names from /proc/modules, which is all lsmod prints, without a helper to wait on
+static bool checkLSModProc()
+{
+    static thread_local FileReader modules;
+    if (!modules.read("/proc/modules"))
+    {
+        std::cerr << "Could not read /proc/modules" << std::endl;
+        return false;
+    }
 
-    //iterate thru and lowercase modules for comparison
-    for(const auto& virt_module : virtualization_modules)
+    bool detected = false;
+    auto signatures = currentSignatures();
+    LineScanner lines(modules.data());
+    std::string_view line;
+    while (lines.next(line))
     {
-        std::string virt_module_lower = virt_module;
-        std::transform(virt_module_lower.begin(), virt_module_lower.end(), virt_module_lower.begin(), ::tolower);
-        if (std::find(loaded_modules.begin(), loaded_modules.end(), virt_module_lower) != loaded_modules.end()) 
+        FieldScanner fields(line);
+        std::string_view module_name;
+        if (fields.next(module_name) && signatures->hasModule(module_name))
         {
-            std::cout << "Virtualization module detected: " << virt_module << std::endl;
+            std::cout << "Virtualization module detected: " << module_name << std::endl;
+            recordEvidence("module:" + std::string(module_name));
             detected = true;
         }
-
     }
+    if (!detected)
+        std::cout << "No virtualization artifacts detected in loaded kernel modules" << std::endl;
+    return detected;
+}
 
-    if(!detected)
-    {
-        std::cout<< "No virtualization artifacts detected in loaded kernel modules" << std::endl;
+/**
+    Function to check for presence of common virtualization kernel modules
+ */
+bool checkLSMod(){
+    std::cout << "\n===== Checking Loaded Kernel Modules (lsmod) =====" << std::endl;
 
-    }
-    return detected;
+    const KernelSnapshot* snapshot = probeSnapshot();
+    if (snapshot && snapshot->has(VMD_SNAP_MODULES)) return checkLSModSnapshot(*snapshot);
+    return checkLSModProc();
 }
 
 
@@ -260,32 +433,27 @@ bool checkLSMod(){
 bool checkEnvVars() {
     std::cout << "\n===== Checking Environment Variables for Virtualization Signatures =====" << std::endl;
 
-    // Run printenv and capture output
-    FILE* pipe = popen("printenv", "r");
-    if (!pipe) {
-        std::cerr << "Failed to run printenv command." << std::endl;
-        return false;
-    }
-
-    char buffer[128];
+    auto signatures = currentSignatures();
     bool detected = false;
-
-    // Read printenv output line-by-line
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        std::string line(buffer);
-
-        // Check each line for any known VM signatures
-        for (const auto& signature : vm_signatures) 
+    auto checkVariable = [&](std::string_view variable) {
+        // One pass over the variable finds any known VM signature
+        if (signatures->findFirst(SIG_GENERAL, variable))
         {
-            if (line.find(signature) != std::string::npos) 
-            {
-                std::cout << "Virtualization signature found in environment variable: " << line;
-                detected = true;
-                break;
-            }
+            std::cout << "Virtualization signature found in environment variable: " << variable << std::endl;
+            recordEvidence("env:" + std::string(variable.substr(0, variable.find('='))));
+            detected = true;
         }
+    };
+
+    if (namespace_scan) {
+        // A namespace scan checks the target's environment, read from /proc/<pid>/environ
+        FieldScanner variables(namespace_scan->environment, std::string_view("\0", 1));
+        std::string_view variable;
+        while (variables.next(variable)) checkVariable(variable);
+    } else {
+        // Our own environment: what printenv would print, without a helper to wait on
+        for (char** variable = environ; *variable; variable++) checkVariable(*variable);
     }
-    pclose(pipe);
 
     if (!detected) 
     {
@@ -300,32 +468,46 @@ bool checkEnvVars() {
  */
 bool checkUSBDevices() {
     std::cout << "\n===== Checking USB Devices for Virtualization Artifacts =====" << std::endl;
-    char buffer[128];
     bool detected = false;
 
     // Execute `lsusb` command and capture output
-    FILE* pipe = popen("lsusb", "r");
-    if (!pipe) {
-        std::cerr << "Failed to run lsusb command." << std::endl;
+    static thread_local std::string output;
+    HelperStatus status = runHelper({"lsusb"}, output);
+    if (status == HELPER_NOT_RUN || status == HELPER_TIMED_OUT) {
+        std::cerr << (status == HELPER_NOT_RUN ? "Failed to run lsusb command." : "lsusb timed out.") << std::endl;
         return false;
     }
 
-    // Read lsusb output line-by-line
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        std::string line(buffer);
+    auto signatures = currentSignatures();
 
-        // Check each line for any known VM signatures
-        for (const auto& signature : vm_signatures) 
+    // Read lsusb output line-by-line
+    LineScanner lines(output);
+    std::string_view line;
+    while (lines.next(line)) {
+
+        // "Bus 001 Device 002: ID 80ee:0021 VirtualBox USB Tablet"
+        size_t id = line.find(" ID ");
+        uint64_t vendor, product;
+        const char* label = nullptr;
+        if (id != std::string_view::npos && line.size() >= id + 13 &&
+            parseUnsigned(line.substr(id + 4, 4), vendor, 16) &&
+            parseUnsigned(line.substr(id + 9, 4), product, 16))
         {
-            if (line.find(signature) != std::string::npos) 
-            {
-                std::cout << "Virtualization signature found in USB device: \n" << line;
-                detected = true;
-                break;
-            }
+            label = signatures->matchUsb(static_cast<uint16_t>(vendor), static_cast<uint16_t>(product));
+        }
+        if (label)
+        {
+            std::cout << "Virtual USB device found (" << label << "): \n" << line << std::endl;
+            recordEvidence(std::string("usb:") + std::string(line.substr(id + 4, 9)));
+            detected = true;
+        }
+        else if (const char* signature = signatures->findFirst(SIG_GENERAL, line)) 
+        {
+            std::cout << "Virtualization signature found in USB device: \n" << line << std::endl;
+            recordEvidence(std::string("usb:") + signature);
+            detected = true;
         }
     }
-    pclose(pipe);
 
     if (!detected) {
         std::cout << "No virtualization indicators found in USB devices." << std::endl;
@@ -339,33 +521,31 @@ bool checkUSBDevices() {
 bool checklscpu() {
     std::cout << "\n===== Checking lscpu Output for VM Signatures =====" << std::endl;
     bool detected = false;
-    // Run lscpu command and redirect output to a file
-    std::system("lscpu > lscpu_output.txt");
-    std::ifstream lscpu_file("lscpu_output.txt");
-    if (!lscpu_file.is_open()) 
+    // Run lscpu and capture its output
+    static thread_local std::string output;
+    if (runHelper({"lscpu"}, output) != HELPER_OK)
     {
-        std::cerr << "Could not open lscpu output file." << std::endl;
+        std::cerr << "Could not run lscpu (missing, failed or timed out)." << std::endl;
         return detected;
     }
-    std::string line;
-    while (std::getline(lscpu_file, line)) 
+    auto signatures = currentSignatures();
+    LineScanner lines(output);
+    std::string_view line;
+    while (lines.next(line)) 
     {
         // Check each line for any VM signature
-        for (const auto& signature : vm_signatures) 
-        {
+        const char* found = nullptr;
+        signatures->scan(SIG_GENERAL, line, [&found](const char* signature) {
             //KVM appears in cpu vuln mitigations 
-            if(signature != "KVM"){
- 
-                if (line.find(signature) != std::string::npos) 
-                {
-                    std::cout << "Virtualization signature found in lscpu output: \n" << line << std::endl;
-                    detected = true;
-                    break;
-                }
-            }
+            if (!found && strcmp(signature, "KVM") != 0) found = signature;
+        });
+        if (found) 
+        {
+            std::cout << "Virtualization signature found in lscpu output: \n" << line << std::endl;
+            recordEvidence(std::string("lscpu:") + found);
+            detected = true;
         }
     }
-    lscpu_file.close();
     if (detected) 
     {
         std::cout << "Virtualization detected based on VM signatures in lscpu output." << std::endl;
@@ -377,6 +557,29 @@ bool checklscpu() {
 }
 
 
+// OEM and creator IDs of every installed table from snapshot_module, without acpidump
+static bool checkACPISnapshot(const KernelSnapshot& snapshot)
+{
+    bool detected = false;
+    auto signatures = currentSignatures();
+    auto tables = snapshot.acpi();
+    for (size_t i = 0; i < tables.size(); i++)
+    {
+        const vmd_snap_acpi& table = tables[i];
+        std::string ids = snapshotString(table.signature) + " " + snapshotString(table.oem_id) + " " +
+                          snapshotString(table.oem_table_id) + " " + snapshotString(table.creator_id);
+        if (const char* signature = signatures->findFirst(SIG_GENERAL_ICASE, ids))
+        {
+            std::cout << "Virtualization signature found in ACPI table header: " << signature << "\n\t Table: " << ids << std::endl;
+            recordEvidence(std::string("acpi:") + signature);
+            detected = true;
+        }
+    }
+    if (!detected)
+        std::cout << "No virtualization signatures in " << tables.size() << " ACPI table headers (kernel snapshot)." << std::endl;
+    return detected;
+}
+
 /**
     Function to check ACPI tables for virtualization artifacts
  */
@@ -384,79 +587,48 @@ bool checkACPI() {
     std::cout << "\n===== Checking ACPI Tables =====" << std::endl;
     bool detected = false;
 
-    // Construct the regex pattern by joining the signatures
-    std::string pattern = "(";
-    for (size_t i = 0; i < vm_signatures.size(); ++i) 
-    {
-        pattern += vm_signatures[i];
-        if (i != vm_signatures.size() - 1) {
-            pattern += "|";
-        }
-    }
-    pattern += ")";
+    const KernelSnapshot* snapshot = probeSnapshot();
+    if (snapshot && snapshot->has(VMD_SNAP_ACPI)) return checkACPISnapshot(*snapshot);
 
-    std::regex signature_regex(pattern, std::regex_constants::icase);
-
-    // Temporary file to store ACPI dump
-    const std::string acpi_dump_file = "/tmp/acpi_tables.txt";
-
-    // Execute acpidump command and redirect output to the file
-    int ret = system(("sudo acpidump > " + acpi_dump_file).c_str());
-    if (ret != 0) 
-    {
-        std::cerr << "Failed to execute acpidump. Ensure you have the necessary permissions." << std::endl;
-        return false;
-    }
+    // Case-insensitive automaton over the signature strings, prebuilt in the pack
+    auto signatures = currentSignatures();
 
-    // Open the dumped ACPI tables file
-    std::ifstream acpi_file(acpi_dump_file);
-    if (!acpi_file.is_open()) 
+    // acpidump needs root; sudo -n fails instead of prompting for a password
+    static thread_local std::string acpi_dump;
+    std::vector<std::string> command = {"acpidump"};
+    if (geteuid() != 0) command.insert(command.begin(), {"sudo", "-n"});
+    HelperStatus status = runHelper(command, acpi_dump);
+    if (status != HELPER_OK) 
     {
-        std::cerr << "Failed to open ACPI dump file." << std::endl;
+        std::cerr << (status == HELPER_TIMED_OUT ? "acpidump timed out." :
+                      "Failed to execute acpidump. Ensure you have the necessary permissions.") << std::endl;
         return false;
     }
 
-    std::string line;
-    std::smatch match;
+    LineScanner lines(acpi_dump);
+    std::string_view line;
     int linenum = 0;
-    // Read the file line by line
-    while (std::getline(acpi_file, line)) 
+    // Read the dump line by line
+    while (lines.next(line)) 
     {
         // Search for any of the virtualization signatures
-        if (std::regex_search(line, match, signature_regex)) 
+        if (const char* signature = signatures->findFirst(SIG_GENERAL_ICASE, line)) 
         {
-            std::cout << "Virtualization signature found in ACPI table: " << match.str(1) << "\n\t Line: " << linenum << std::endl;
+            std::cout << "Virtualization signature found in ACPI table: " << signature << "\n\t Line: " << linenum << std::endl;
+            recordEvidence(std::string("acpi:") + signature);
             detected = true;
         }
         linenum++;
     }
 
-    acpi_file.close();
-
-    // Remove the temporary file
-    std::remove(acpi_dump_file.c_str());
-
     return detected;
 }
 
 
 
 
-// Jump buffer for non-local goto in signal handler
-jmp_buf buf;
-
 /**
- * Signal handler for catching segmentation faults.
- * Uses longjmp to return to a safe execution point.
- */
-void signal_handler(int signum) {
-    int x = signum;
-    cout<<x<<endl;
-    longjmp(buf, 1); // Jump back to setjmp point with return value 1
-}
-
-/**
- * Checks the base addresses of the GDT and IDT.
+ * Checks the base addresses of the GDT and IDT on every CPU.
  * Detects possible virtualization by analyzing these addresses.
  */
 bool checkDescriptorTables() {
@@ -465,63 +637,83 @@ bool checkDescriptorTables() {
 
     if(OS == OS_LINUX){
 
-    
     #if defined(__x86_64__)
-        // Set up signal handler for SIGSEGV to catch segmentation faults
-        std::signal(SIGSEGV, signal_handler);
-
-        // Buffers to store GDTR and IDTR contents
-        struct {
-            uint16_t limit;
-            uint64_t base;
-        } __attribute__((packed)) gdtr, idtr;
-
-
-        // Use setjmp/longjmp for exception handling
-        if (setjmp(buf) == 0) {
-            // Attempt to execute SGDT and SIDT instructions
-            asm volatile("sgdt %0" : "=m"(gdtr));
-            asm volatile("sidt %0" : "=m"(idtr));
+        DescriptorTableReport report;
+        const KernelSnapshot* snapshot = probeSnapshot();
+        if (snapshot && !snapshot->cpus().empty()) {
+            // Read in the kernel by snapshot_module, so UMIP does not hide the real bases
+            auto cpus = snapshot->cpus();
+            std::cout << "Descriptor tables read by the kernel snapshot on " << cpus.size() << " CPUs" << std::endl;
+            report.ok = true;
+            for (size_t i = 0; i < cpus.size(); i++) {
+                CpuDescriptorTables& cpu = report.cpus.emplace_back();
+                cpu.cpu = static_cast<int>(cpus[i].cpu);
+                cpu.pinned = true;
+                cpu.gdt_limit = cpus[i].gdt_limit;
+                cpu.gdt_base = cpus[i].gdt_base;
+                cpu.idt_limit = cpus[i].idt_limit;
+                cpu.idt_base = cpus[i].idt_base;
+            }
+        } else if (!sampleDescriptorTables(report)) {
+            std::cerr << "Could not start descriptor table sampling threads." << std::endl;
+            return false;
+        }
 
-            // If no exception occurred, analyze the base addresses
-            std::cout << "SGDT and SIDT executed successfully." << std::endl;
+        std::cout << "UMIP: " << (report.umip ? "enabled (user-mode SGDT/SIDT trap to the kernel)" : "not reported") << std::endl;
 
-            std::cout << "GDTR Base: 0x" << std::hex << gdtr.base << std::endl;
-            std::cout << "IDTR Base: 0x" << std::hex << idtr.base << std::endl;
+        for (const auto& cpu : report.cpus) {
+            std::cout << "CPU " << cpu.cpu << (cpu.pinned ? "" : " (not pinned)") << ": ";
+            if (cpu.faulted) {
+                std::cout << "SGDT/SIDT faulted" << std::endl;
+                continue;
+            }
+            std::cout << std::hex << "GDTR base 0x" << cpu.gdt_base << " limit 0x" << cpu.gdt_limit
+                      << ", IDTR base 0x" << cpu.idt_base << " limit 0x" << cpu.idt_limit << std::dec;
+            if (cpu.gdt_base == UMIP_DUMMY_GDT_BASE && cpu.idt_base == UMIP_DUMMY_IDT_BASE)
+                std::cout << " (UMIP emulation)";
+            std::cout << std::endl;
+        }
 
-            //reset to decimal format
-            std::cout << std::dec;
+        size_t real_bases = 0;
+        for (const auto& cpu : report.cpus) {
+            if (cpu.faulted) {
+                // With UMIP the fault is the expected outcome on bare metal too
+                if (!report.umip) {
+                    std::cout << "CPU " << cpu.cpu << ": SGDT or SIDT caused a segmentation fault without UMIP. Possible virtualization detected." << std::endl;
+                    recordEvidence("desc-tables:sgdt-fault");
+                    virtualization_detected = true;
+                }
+                continue;
+            }
+            // Spoofed values say nothing about the real tables
+            if (cpu.gdt_base == UMIP_DUMMY_GDT_BASE && cpu.idt_base == UMIP_DUMMY_IDT_BASE) continue;
+            real_bases++;
 
             // Check if base addresses are in user space (unexpected)
-            if (gdtr.base < 0xFFFF800000000000) {
-                std::cout << "GDTR base address is in user space (unexpected). Possible virtualization detected." << std::endl;
+            if (cpu.gdt_base < 0xFFFF800000000000) {
+                std::cout << "CPU " << cpu.cpu << ": GDTR base address is in user space (unexpected). Possible virtualization detected." << std::endl;
+                recordEvidence("gdtr:user-space");
                 virtualization_detected = true;
-            } else {
-                std::cout << "GDTR base address is in kernel space (expected)." << std::endl;
             }
-
-            if (idtr.base < 0xFFFF800000000000) {
-                std::cout << "IDTR base address is in user space (unexpected). Possible virtualization detected." << std::endl;
+            if (cpu.idt_base < 0xFFFF800000000000) {
+                std::cout << "CPU " << cpu.cpu << ": IDTR base address is in user space (unexpected). Possible virtualization detected." << std::endl;
+                recordEvidence("idtr:user-space");
                 virtualization_detected = true;
-            } else {
-                std::cout << "IDTR base address is in kernel space (expected)." << std::endl;
             }
 
             // Additional checks for known virtualization signatures
             // For example, checking for specific base addresses used by VMware
-            if (idtr.base == 0xfff82000 || gdtr.base == 0xfff82000) {
-                std::cout << "Descriptor tables have base addresses common in VMware environments." << std::endl;
+            if (cpu.idt_base == 0xfff82000 || cpu.gdt_base == 0xfff82000) {
+                std::cout << "CPU " << cpu.cpu << ": descriptor tables have base addresses common in VMware environments." << std::endl;
+                recordEvidence("desc-tables:vmware-base");
                 virtualization_detected = true;
             }
-
-        } else {
-            // If an exception occurred, execution jumps here
-            std::cout << "SGDT or SIDT caused a segmentation fault. Possible virtualization detected." << std::endl;
-            virtualization_detected = true;
         }
 
-        // Restore default signal handler
-        std::signal(SIGSEGV, SIG_DFL);
+        if (real_bases == 0)
+            std::cout << "UMIP hides the real descriptor table bases on every CPU; no conclusion from their addresses." << std::endl;
+        else if (!virtualization_detected)
+            std::cout << "Descriptor table base addresses are in kernel space on " << real_bases << " CPUs (expected)." << std::endl;
 
     #elif defined(__aarch64__) 
         cout<<"ARM system detected..."<<endl;
@@ -586,43 +778,41 @@ uint64_t rdtsc_end() {
 }
 
 
-#if defined(__arm__) || defined(_M_ARM) ||  defined(__aarch64__) || defined(_M_ARM64)
-//Function to get frequency of ARM timer (hz)
-uint64_t get_arm_frequency(){
-    uint64_t frequency;
-    asm volatile("mrs %0, cntfrq_el0" : "=r" (frequency));
-    return frequency;
-}
-#endif
-
 bool checkTiming() {
     std::cout << "\n===== Measuring Timing Discrepancies =====" << std::endl;
     bool detected = false;
-    std::ifstream cpuinfo("/proc/cpuinfo");
-    std::string line;
-    std::regex pattern("cpu MHz\\s+: ([0-9]+\\.[0-9]+)");
-    std::smatch match;
+    static thread_local FileReader cpuinfo;
     
 if (OS == OS_LINUX) {
     #if defined(__x86_64__) //for x86 intel processors...
         unsigned int cpu_mhz = 0;
-        if (cpuinfo.is_open()) 
+        if (cpuinfo.read("/proc/cpuinfo")) 
         {
-            while (std::getline(cpuinfo, line)) {
-                if (std::regex_search(line, match, pattern)) 
+            LineScanner lines(cpuinfo.data());
+            std::string_view line;
+            while (lines.next(line)) {
+                // "cpu MHz\t\t: 2400.000"
+                size_t colon = line.find(':');
+                double mhz;
+                if (line.rfind("cpu MHz", 0) == 0 && colon != std::string_view::npos &&
+                    parseDouble(line.substr(colon + 1), mhz)) 
                 {
-                    double mhz = std::stod(match[1]);
                     cpu_mhz = static_cast<unsigned int>(mhz);
                 }
             }
         }
         std::cout << "Detected CPU frequency: " << cpu_mhz << " MHz" << std::endl;
 
-        const int iterations = 1000000;
+        // --budget takes a smaller sample; the average needs far fewer than a million
+        const int iterations = budget_enabled ? BUDGET_TIMING_ITERATIONS : 1000000;
         uint64_t start, end;
         uint64_t total_cycles = 0;
+        int measured = 0;
+        bool cut_off = false;
         cout<<"Iterating nop instructions...."<<endl;
         for (int i = 0; i < iterations; ++i) {
+            // Under heavy steal this loop takes seconds; stop at the probe's deadline
+            if ((i & 0xffff) == 0 && probeCancelled()) break;
             start = rdtsc_start();
 
             // Code block to measure
@@ -630,13 +820,26 @@ if (OS == OS_LINUX) {
 
             end = rdtsc_end();
             total_cycles += (end - start);
+            measured++;
+            // Each iteration is two cpuid exits; in budget mode they go out in paced batches of 1024
+            if ((measured & 0x3ff) == 0 && !budgetPace(2 * 0x400)) {
+                cut_off = true;
+                break;
+            }
         }
+        if (cut_off)
+            std::cout << "Budget ran out after " << measured << " of " << iterations << " iterations." << std::endl;
+        else if (measured < iterations)
+            std::cout << "Cancelled after " << measured << " of " << iterations << " iterations." << std::endl;
+        if (measured == 0) return false;
 
-        double average_cycles = total_cycles / static_cast<double>(iterations);
+        double average_cycles = total_cycles / static_cast<double>(measured);
         double average_time_ns = (average_cycles / (cpu_mhz * 1e6)) * 1e9; // Convert to nanoseconds
 
         std::cout << "Done. \nAverage cycles per operation: " << average_cycles << std::endl;
         std::cout << "Average time per operation: " << average_time_ns << " ns" << std::endl;
+        timing_stats.cycles_per_op = average_cycles;
+        timing_stats.ns_per_op = average_time_ns;
 
         /**
             We know that on an natively running i7-13800H, 
@@ -651,6 +854,7 @@ if (OS == OS_LINUX) {
 
         if (average_time_ns > threshold_ns) {
             std::cout << "Timing discrepancies detected. Possible virtualization environment." << std::endl;
+            recordEvidence("timing:slow-cpuid");
             detected = true;
         } 
         else {
@@ -659,34 +863,29 @@ if (OS == OS_LINUX) {
 
     #elif defined(__aarch64__) || defined(_M_ARM64) //for arm processors
         std::cout<<"ARM system detected..."<<endl;
-        uint64_t start,end,total_cycles = 0;
-        uint64_t frequency = get_arm_frequency();
-        std::cout<<"ARM Frequency: " << frequency <<" Hz" << endl;
-
-
-        const int iterations = 1000000;
-        std::cout<<"Iterating nop instructions...."<<endl;
-
-        for(int i = 0; i < iterations; ++i)
+        CounterTiming counter;
+        if (!measureCounterTiming(counter))
         {
-            start = rdtsc_start();
-
-            asm volatile("nop");
-
-            end = rdtsc_end();
-            total_cycles+= (end - start);
+            std::cerr << "Generic timer frequency (cntfrq_el0) is not set." << std::endl;
+            return false;
+        }
+        std::cout << "Advertised counter frequency: " << counter.cntfrq << " Hz" << std::endl;
+        std::cout << "Average time per cntvct_el0 read: " << counter.read_ns << " ns ("
+                  << counter.read_ticks << " ticks)" << std::endl;
+        timing_stats.cycles_per_op = counter.read_ticks;
+        timing_stats.ns_per_op = counter.read_ns;
+
+        // A trapped counter read costs an exit to EL2, far above a native read
+        if (counter.read_ns > ARM_COUNTER_READ_THRESHOLD_NS)
+        {
+            std::cout << "Counter reads are trapped. Possible virtualization environment." << std::endl;
+            recordEvidence("timing:slow-cntvct");
+            detected = true;
+        }
+        if (!detected)
+        {
+            std::cout << "No significant timing discrepancies detected." << std::endl;
         }
-        unsigned int frequency_mhz = frequency / 1e6;
-
-
-        //average cycles per NOP instruction
-        double avg_cycles = total_cycles / static_cast<double>(iterations);
-        //average time in ns
-        double avg_time = (avg_cycles / frequency_mhz) * 1e3;
-
-        //make sure these calculations are correct lol
-        std::cout<<"Done. \nAverage cycles per operation: "<<avg_cycles<<std::endl;
-        std::cout<<"Average time per operation: "<< avg_time<<std::endl;
     #endif
 
     }
@@ -707,59 +906,95 @@ if (OS == OS_LINUX) {
     Seems like we will have two options: try to spoof hardward (hard),
     or just adjust vm settings to allow for a hardware passthrough.
  */
+// Vendor and device IDs from snapshot_module instead of two sysfs reads per function
+static bool checkPCISnapshot(const KernelSnapshot& snapshot)
+{
+    bool detected = false;
+    unsigned int virtualized_devices = 0;
+    auto signatures = currentSignatures();
+    auto devices = snapshot.pci();
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        const vmd_snap_pci& device = devices[i];
+        const char* label = signatures->matchPci(device.vendor, device.device);
+        if (!label) continue;
+
+        char vendor_device[16];
+        snprintf(vendor_device, sizeof(vendor_device), "%04x:%04x", device.vendor, device.device);
+        std::cout << "Virtual PCI device: " << snapshotString(device.slot) << " " << vendor_device << " (" << label << ")" << std::endl;
+        virtualized_devices++;
+        recordEvidence(std::string("pci:") + vendor_device);
+        detected = true;
+    }
+    std::cout << "Virtualization artifacts detected for: " << virtualized_devices << " PCI devices. " << std::endl;
+    return detected;
+}
+
 bool checkPCI(){
     cout<<"\n===== Checking for virtualized PCI devices =====" << endl;
     bool detected = false;
     unsigned int virtualized_devices= 0;
     if (OS == OS_LINUX)
     {
-         const std::string pci_path = "/sys/bus/pci/devices";
+    const KernelSnapshot* snapshot = probeSnapshot();
+    if (snapshot && snapshot->has(VMD_SNAP_PCI)) return checkPCISnapshot(*snapshot);
+
+         const char* const pci_path = "/sys/bus/pci/devices";
 
-    if (!std::filesystem::exists(pci_path)) {
+    int pci_dir = openDirectory(pci_path);
+    if (pci_dir < 0) {
         std::cerr << "PCI devices path does not exist." << std::endl;
         return false;
     }
 
-    for (const auto& entry : std::filesystem::directory_iterator(pci_path)) {
-        std::string device_path = entry.path();
-        std::string vendor_id, device_id;
-
-        try {
-            // Read vendor ID
-            std::ifstream vendor_file(device_path + "/vendor");
-            if (vendor_file) {
-                std::getline(vendor_file, vendor_id);
-                vendor_file.close();
-            } else {
-                std::cerr << "Failed to read vendor ID for device: " << device_path << std::endl;
-                continue;
-            }
+    auto signatures = currentSignatures();
 
-            // Read device ID
-            std::ifstream device_file(device_path + "/device");
-            if (device_file) {
-                std::getline(device_file, device_id);
-                device_file.close();
-            } else {
-                std::cerr << "Failed to read device ID for device: " << device_path << std::endl;
-                continue;
-            }
+    // Queue the vendor and device ID of every function, then read them in one batch
+    static thread_local BatchReader batch;
+    batch.clear();
+    DirScanner entries(pci_dir);
+    const char* device;
+    char path[300];
 
-            // Combine vendor and device IDs in "vendor:device" format
-            std::string vendor_device = vendor_id + ":" + device_id;
-            // Check if the combined vendor:device ID is in the list of known virtual device IDs
-            auto it = std::find(virtual_device_ids.begin(), virtual_device_ids.end(), vendor_device);
-            if (it != virtual_device_ids.end()) 
-            {
-                virtualized_devices++;
-                detected = true;
-            } 
+    while (entries.next(device)) {
+        snprintf(path, sizeof(path), "%s/vendor", device);
+        batch.add(pci_dir, path);
+        snprintf(path, sizeof(path), "%s/device", device);
+        batch.add(pci_dir, path);
+    }
+    batch.run();
 
-        } 
-        catch (const std::exception& e) {
-            std::cerr << "Error processing device " << entry.path().filename() << ": " << e.what() << std::endl;
+    for (size_t i = 0; i + 1 < batch.size(); i += 2) {
+        if (!batch.ok(i)) {
+            std::cerr << "Failed to read vendor ID for device: " << pci_path << "/" << batch.name(i) << std::endl;
+            continue;
         }
+        if (!batch.ok(i + 1)) {
+            std::cerr << "Failed to read device ID for device: " << pci_path << "/" << batch.name(i + 1) << std::endl;
+            continue;
+        }
+
+        // sysfs IDs are "0x15ad"; compare them as integers
+        uint64_t vendor_id, device_id;
+        if (!parseUnsigned(batch.data(i), vendor_id, 16) || !parseUnsigned(batch.data(i + 1), device_id, 16))
+            continue;
+
+        // Check the vendor:device pair against the known virtual device IDs
+        const char* label = signatures->matchPci(static_cast<uint16_t>(vendor_id), static_cast<uint16_t>(device_id));
+        if (label) 
+        {
+            char vendor_device[16];
+            snprintf(vendor_device, sizeof(vendor_device), "%04x:%04x",
+                     static_cast<unsigned int>(vendor_id), static_cast<unsigned int>(device_id));
+            std::string_view slot = batch.name(i);
+            std::cout << "Virtual PCI device: " << slot.substr(0, slot.find('/'))
+                      << " " << vendor_device << " (" << label << ")" << std::endl;
+            virtualized_devices++;
+            recordEvidence(std::string("pci:") + vendor_device);
+            detected = true;
+        } 
     } 
+    close(pci_dir);
     std::cout << "Virtualization artifacts detected for: " 
     << virtualized_devices << " PCI devices. " << std::endl;
     
@@ -778,6 +1013,197 @@ bool checkPCI(){
     return detected;
 }
 
+// Parses "aa:bb:cc:dd:ee:ff" into six bytes
+static bool parseMacAddress(std::string_view text, uint8_t* mac)
+{
+    if (text.size() < 17) return false;
+    for (int i = 0; i < 6; i++) {
+        uint64_t octet;
+        if (!parseUnsigned(text.substr(i * 3, 2), octet, 16)) return false;
+        mac[i] = static_cast<uint8_t>(octet);
+    }
+    return true;
+}
+
+// Compiled IEEE registry (see oui_compile), settable with -O
+std::string oui_db_path = OUI_DB_PATH;
+
+// Maps the registry on first use; checkMAC falls back to the signature pack's OUIs without it
+static const OuiDatabase& ouiDatabase()
+{
+    static OuiDatabase db;
+    static const bool opened = db.open(oui_db_path.c_str());
+    (void)opened;
+    return db;
+}
+
+void openOuiDatabase()
+{
+    (void)ouiDatabase();
+}
+
+// Formats the assigned bits of a registry prefix, e.g. "00:0C:29" or "70:B3:D5:1"
+static std::string formatOuiPrefix(uint64_t prefix, unsigned int bits)
+{
+    std::string text;
+    char digit[4];
+    for (unsigned int nibble = 0; nibble < bits / 4; nibble++) {
+        if (nibble > 0 && nibble % 2 == 0) text += ':';
+        snprintf(digit, sizeof(digit), "%X", static_cast<unsigned int>((prefix >> (44 - nibble * 4)) & 0xf));
+        text += digit;
+    }
+    return text;
+}
+
+// Attributes one address to its registered vendor and records virtual NIC hits
+static bool matchVmOui(std::string_view iface, const uint8_t* mac, const char* note)
+{
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    const OuiDatabase& db = ouiDatabase();
+    if (db.isOpen()) {
+        const OuiDbEntry* entry = db.lookup(mac);
+        if (!entry) return false;
+        if (entry->tag == OUI_TAG_NONE) {
+            cout << iface << ": " << note << " " << text << " registered to " << db.name(entry) << endl;
+            return false;
+        }
+        cout << "Virtual NIC prefix detected: " << iface << " with " << note << " " << text
+             << " (" << ouiTagName(entry->tag) << ", " << db.name(entry) << ")" << endl;
+        recordEvidence("mac:" + formatOuiPrefix(entry->prefix, entry->bits));
+        return true;
+    }
+
+    const char* vendor = currentSignatures()->matchOui(macOui(mac));
+    if (!vendor) return false;
+
+    cout << "Virtual NIC prefix detected: " << iface << " with " << note << " " << text << " (" << vendor << ")" << endl;
+    recordEvidence("mac:" + std::string(text, 8));
+    return true;
+}
+
+// Fallback for kernels without rtnetlink: /proc/net/dev plus one sysfs read per interface
+static bool checkMACSysfs()
+{
+    bool detected = false;
+    static thread_local FileReader netDev;
+    static thread_local BatchReader macFiles;
+    if (!netDev.read("/proc/net/dev")) 
+    {
+        cerr << "Cannot open /proc/net/dev" << endl;
+        return false;
+    }
+    int net_dir = openDirectory("/sys/class/net");
+
+    LineScanner lines(netDev.data());
+    std::string_view line;
+    // Skip the first two header lines
+    lines.next(line);
+    lines.next(line);
+
+    macFiles.clear();
+    while(lines.next(line))
+    {
+        //get the interface name
+        size_t colon = line.find(':');
+        if(colon != std::string_view::npos)
+        {
+            std::string_view iface = trim(line.substr(0, colon));
+            if (iface.empty() || iface.size() >= IFNAMSIZ) continue;
+
+            //now we construct path to the MAC address file, relative to /sys/class/net
+            char macPath[IFNAMSIZ + 16];
+            snprintf(macPath, sizeof(macPath), "%.*s/address", static_cast<int>(iface.size()), iface.data());
+            macFiles.add(net_dir, macPath);
+        }
+    }
+    if (net_dir >= 0) macFiles.run();
+
+    for (size_t i = 0; i < macFiles.size(); i++)
+    {
+        std::string_view iface = macFiles.name(i);
+        iface = iface.substr(0, iface.find('/'));
+
+        uint8_t mac[6];
+        if(macFiles.ok(i) && parseMacAddress(trim(macFiles.data(i)), mac))
+        {
+            //now we check this mac address to see if it matches any known prefix addys
+            if (matchVmOui(iface, mac, "MAC")) detected = true;
+        }
+    }
+    if (net_dir >= 0) close(net_dir);
+    return detected;
+}
+
+// Interface addresses from snapshot_module; links without a parent device are software links
+static bool checkMACSnapshot(const KernelSnapshot& snapshot)
+{
+    bool detected = false;
+    static const uint8_t zero[6] = {};
+    auto links = snapshot.netdevs();
+    for (size_t i = 0; i < links.size(); i++)
+    {
+        const vmd_snap_netdev& link = links[i];
+        if (link.type == ARPHRD_LOOPBACK || !link.parent_bus[0]) continue;
+
+        std::string name = snapshotString(link.name);
+        bool hit = memcmp(link.addr, zero, 6) != 0 && matchVmOui(name, link.addr, "MAC");
+        if (memcmp(link.perm_addr, zero, 6) != 0 && memcmp(link.perm_addr, link.addr, 6) != 0 &&
+            matchVmOui(name, link.perm_addr, "permanent MAC")) hit = true;
+
+        if (hit)
+            cout << "  parent device: " << snapshotString(link.parent_bus) << " " << snapshotString(link.parent_dev) << endl;
+        detected = detected || hit;
+    }
+    return detected;
+}
+
+/**
+    Test to inspect every PCI function's configuration space through libpci:
+    subsystem IDs, capability lists, virtio vendor capabilities and BARs,
+    judged by the rule table in pci_inspect.cpp. Needs root for more than
+    the first 64 bytes of config space.
+ */
+bool checkPCIDeep() {
+    std::cout << "\n===== Inspecting PCI Configuration Space (libpci) =====" << std::endl;
+    if (OS != OS_LINUX) return false;
+
+    static std::vector<PciFunction> functions;
+    std::string error;
+    if (!scanPciFunctions(functions, error)) {
+        std::cerr << "PCI inspection failed: " << error << std::endl;
+        return false;
+    }
+
+    auto signatures = currentSignatures();
+    bool detected = false;
+    bool header_only = false;
+    for (const auto& function : functions) {
+        header_only = header_only || function.config_size <= 64;
+        bool flagged = false;
+        auto matched = matchPciRules(function, *signatures, flagged);
+        if (matched.empty()) continue;
+
+        char ids[64];
+        snprintf(ids, sizeof(ids), "%04x:%04x rev %02x subsystem %04x:%04x", function.vendor, function.device,
+                 function.revision, function.subsys_vendor, function.subsys_device);
+        std::cout << (flagged ? "Virtual PCI function: " : "PCI function: ") << function.slot << " " << ids << std::endl;
+        for (const PciRule* rule : matched) {
+            std::cout << "  " << rule->name << (rule->strong ? "" : " (weak)") << ": " << rule->description << std::endl;
+            if (flagged) recordEvidence(std::string("pci-deep:") + rule->name);
+        }
+        detected = detected || flagged;
+    }
+
+    std::cout << "Inspected " << functions.size() << " PCI functions" << std::endl;
+    if (header_only)
+        std::cout << "Only the 64-byte header was readable for some functions; run as root for capabilities" << std::endl;
+    if (!detected)
+        std::cout << "No virtualization artifacts found in PCI configuration space" << std::endl;
+    return detected;
+}
+
 /**
     Test to check our MAC ADDRESS for common VM address prefixes.
  */
@@ -787,53 +1213,31 @@ bool checkMAC(){
 
     if(OS == OS_LINUX)
     {
-        ifstream netDev("/proc/net/dev");
-        if (!netDev.is_open()) 
+        const KernelSnapshot* snapshot = probeSnapshot();
+        if (snapshot && snapshot->has(VMD_SNAP_NETDEV)) return checkMACSnapshot(*snapshot);
+
+        // One rtnetlink dump returns every link's addresses and kind
+        static thread_local std::vector<LinkInfo> links;
+        if (!dumpLinks(links))
         {
-        cerr << "Cannot open /proc/net/dev" << endl;
-        return false;
+            cerr << "rtnetlink link dump failed, falling back to sysfs." << endl;
+            return checkMACSysfs();
         }
-        string line;
-        // Skip the first two header lines
-        getline(netDev, line);
-        getline(netDev, line);
-        
-        while(getline(netDev, line))
-        {
-            istringstream iss(line);
-            string iface;
-
-            //get the interface name
-            if(getline(iss, iface, ':'))
-            {
-                iface.erase(0, iface.find_first_not_of(" \t"));
-                iface.erase(iface.find_last_not_of(" \t") + 1);
 
-                //now we construct path to the MAC address file:
-                string macPath = "/sys/class/net/" + iface + "/address";
-                ifstream macFile(macPath);
+        for (const auto& link : links)
+        {
+            // Loopback and software links (veth, bridge, tun, ...) have no vendor OUI
+            if (link.type == ARPHRD_LOOPBACK || isVirtualLinkKind(link.kind)) continue;
 
-                if(macFile.is_open())
-                {
-                    string mac;
-                    getline(macFile, mac);
-                    macFile.close();
-                    std::transform(mac.begin(),mac.end(),mac.begin(), ::toupper);
-                    //now we check this mac address to see if it matches any known prefix addys
-                    for(const auto& prefix : vm_mac_prefixes)
-                    {
-                        if (mac.find(prefix) == 0 )
-                        {
-                            cout << "Virtual NIC prefix detected: " << iface 
-                            << " with MAC " << mac << endl;
-                            detected = true;
-                        }
-                    }
+            bool hit = link.has_addr && matchVmOui(link.name, link.addr, "MAC");
+            // The permanent address still shows the vendor when the MAC is overridden
+            if (link.has_perm_addr && memcmp(link.perm_addr, link.addr, 6) != 0 &&
+                matchVmOui(link.name, link.perm_addr, "permanent MAC")) hit = true;
 
-                }
-            }
+            if (hit && link.parent_dev[0])
+                cout << "  parent device: " << link.parent_bus << " " << link.parent_dev << endl;
+            detected = detected || hit;
         }
-
     }
     if (OS == OS_WINDOWS){
 
@@ -847,6 +1251,56 @@ bool checkMAC(){
     return detected;
 }
 
+// Expanded DMI fields under /sys/class/dmi/id, including additional fields for virtualization artifacts
+static const char* const dmi_fields[] = {
+    "sys_vendor",
+    "product_name",
+    "product_version",
+    "board_vendor",
+    "bios_vendor",
+    "product_family",
+    "uevent",      // Added path for uevent
+    "modalias"     // Added path for modalias
+};
+
+// The strings modalias (and uevent's MODALIAS=) is built from, by their snapshot_module names
+static const char* const dmi_modalias_fields[] = {
+    "bios_vendor", "bios_version", "bios_date", "sys_vendor", "product_name", "product_version", "product_sku",
+    "board_vendor", "board_name", "board_version", "chassis_vendor", "chassis_type", "chassis_version",
+};
+
+// Whether the sysfs path sees a field, so both paths reach the same verdict; serials,
+// UUIDs and asset tags are root-only and left out of both
+static bool dmiFieldInSysfs(std::string_view field)
+{
+    for (const char* name : dmi_fields) if (field == name) return true;
+    for (const char* name : dmi_modalias_fields) if (field == name) return true;
+    return false;
+}
+
+// dmi_get_system_info() strings from snapshot_module, replacing sysfs and dmidecode
+static bool checkDMISnapshot(const KernelSnapshot& snapshot)
+{
+    bool detected = false;
+    size_t scanned = 0;
+    auto signatures = currentSignatures();
+    auto fields = snapshot.dmi();
+    for (size_t i = 0; i < fields.size(); i++) {
+        if (!dmiFieldInSysfs(snapshotString(fields[i].field))) continue;
+        scanned++;
+        std::string value = snapshotString(fields[i].value);
+        std::set<const char*> found;
+        signatures->scan(SIG_DMI, value, [&found](const char* signature) { found.insert(signature); });
+        for (const char* signature : found) {
+            detected = true;
+            recordEvidence(std::string("dmi:") + signature);
+            std::cout << "Signature found: \"" << signature << "\" in DMI field: " << snapshotString(fields[i].field) << " (kernel snapshot)" << std::endl;
+        }
+    }
+    if (!detected)
+        std::cout << "No VM signatures in " << scanned << " DMI fields (kernel snapshot)." << std::endl;
+    return detected;
+}
 
 /**
     Test to check for VM signatures in DMI fields
@@ -856,80 +1310,60 @@ bool checkDMI() {
 
     // Check for Linux OS
     if(OS == OS_LINUX){
-    // Expanded DMI paths, including additional paths for virtualization artifacts
-    const std::vector<std::string> dmi_paths = {
-        "/sys/class/dmi/id/sys_vendor",
-        "/sys/class/dmi/id/product_name",
-        "/sys/class/dmi/id/product_version",
-        "/sys/class/dmi/id/board_vendor",
-        "/sys/class/dmi/id/bios_vendor",
-        "/sys/class/dmi/id/product_family",
-        "/sys/class/dmi/id/uevent",      // Added path for uevent
-        "/sys/class/dmi/id/modalias"     // Added path for modalias
-    };
+    const KernelSnapshot* snapshot = probeSnapshot();
+    if (snapshot && snapshot->has(VMD_SNAP_DMI)) return checkDMISnapshot(*snapshot);
 
-    // Signatures of VM platforms (expand as needed)
-    const std::vector<std::string> vm_signatures = {
-        "qemu", "vmware", "virtualbox", "hyper-v", "xen", "kvm", "parallels"
-    };
+    const char* const dmi_dir_path = "/sys/class/dmi/id";
 
-    bool detected = false;
+    // Signatures of VM platforms, the pack's [dmi] section
+    auto signatures = currentSignatures();
 
-    // Check each DMI field for VM signatures
-    for (const auto& path : dmi_paths) {
-        std::ifstream file(path);
-        std::string value, line;
-
-        if (file.is_open()) {
-            // Read entire content for multi-line handling
-            while (std::getline(file, line)) {
-                value += line + " ";
-            }
+    bool detected = false;
+    static thread_local BatchReader files;
+    int dmi_dir = openDirectory(dmi_dir_path);
 
-            // Convert content to lowercase to enable case-insensitive searching
-            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    files.clear();
+    for (const char* field : dmi_fields) files.add(dmi_dir, field);
+    if (dmi_dir >= 0) files.run();
 
-            // Check if any VM signature is a substring within the content
-            for (const auto& signature : vm_signatures) {
-                if (value.find(signature) != std::string::npos) {
-                    detected = true;
-                    std::cout << "Signature found: \"" << signature << "\" in DMI field: " << path << std::endl;
-                }
+    // Check each DMI field for VM signatures
+    for (size_t i = 0; i < files.size(); i++) {
+        const char* field = files.name(i);
+        if (files.ok(i)) {
+            // Case-insensitive search over the whole content handles multi-line fields
+            std::set<const char*> found;
+            signatures->scan(SIG_DMI, files.data(i), [&found](const char* signature) { found.insert(signature); });
+            for (const char* signature : found) {
+                detected = true;
+                recordEvidence(std::string("dmi:") + signature);
+                std::cout << "Signature found: \"" << signature << "\" in DMI field: " << dmi_dir_path << "/" << field << std::endl;
             }
         } else {
-            std::cout << "Could not open file: " << path << std::endl;
+            std::cout << "Could not open file: " << dmi_dir_path << "/" << field << std::endl;
         }
     }
+    if (dmi_dir >= 0) close(dmi_dir);
+
+    // dmidecode reads the host's firmware tables, not anything namespaced
+    if (namespace_scan) return detected;
 
     // Additional check using dmidecode
     std::cout << "\n===== Checking dmidecode Output =====" << std::endl;
-    // Command to execute
-    const char* cmd = "dmidecode --type system 2>/dev/null";
-
-    // Open the command for reading
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
-    if (!pipe) {
-        std::cerr << "Could not run dmidecode command." << std::endl;
-        return detected; // Return current detection status
-    }
-
-    std::array<char, 256> buffer;
-    std::string dmidecode_output;
-
     // Read the output of dmidecode
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-        dmidecode_output += buffer.data();
+    static thread_local std::string dmidecode_output;
+    HelperStatus status = runHelper({"dmidecode", "--type", "system"}, dmidecode_output);
+    if (status == HELPER_NOT_RUN || status == HELPER_TIMED_OUT) {
+        std::cerr << (status == HELPER_NOT_RUN ? "Could not run dmidecode command." : "dmidecode timed out.") << std::endl;
+        return detected; // Return current detection status
     }
 
-    // Convert dmidecode output to lowercase
-    std::transform(dmidecode_output.begin(), dmidecode_output.end(), dmidecode_output.begin(), ::tolower);
-
     // Check for VM signatures in dmidecode output
-    for (const auto& signature : vm_signatures) {
-        if (dmidecode_output.find(signature) != std::string::npos) {
-            detected = true;
-            std::cout << "Signature found: \"" << signature << "\" in dmidecode output." << std::endl;
-        }
+    std::set<const char*> found;
+    signatures->scan(SIG_DMI, dmidecode_output, [&found](const char* signature) { found.insert(signature); });
+    for (const char* signature : found) {
+        detected = true;
+        recordEvidence(std::string("dmidecode:") + signature);
+        std::cout << "Signature found: \"" << signature << "\" in dmidecode output." << std::endl;
     }
 
     return detected;
@@ -949,6 +1383,70 @@ bool checkDMI() {
     return false;
 }
 
+/**
+    Test to check the flattened device tree for virtual platform nodes
+    ("linux,dummy-virt", fw-cfg, virtio-mmio). ARM and RISC-V guests often
+    boot from a device tree instead of DMI/ACPI.
+ */
+bool checkDeviceTree() {
+    std::cout << "\n===== Checking Device Tree =====" << std::endl;
+    bool detected = false;
+
+    if (OS == OS_LINUX)
+    {
+        // The whole tree in one buffer; sysfs hands out binary attributes a page per read
+        static thread_local FileReader blob(64 * 1024);
+        static thread_local FdtIndex index;
+        int fd = open(FDT_BLOB_PATH, O_RDONLY | O_CLOEXEC);
+        bool read_ok = fd >= 0 && blob.readStream(fd);
+        if (fd >= 0) close(fd);
+        if (!read_ok)
+        {
+            std::cout << "No flattened device tree at " << FDT_BLOB_PATH << " (DMI/ACPI boot, or not root)." << std::endl;
+            return false;
+        }
+        if (!indexFdt(blob.data(), index))
+        {
+            std::cerr << "Malformed device tree blob at " << FDT_BLOB_PATH << std::endl;
+            return false;
+        }
+        std::cout << "Indexed " << index.nodes.size() << " nodes and " << index.compatibles.size()
+                  << " compatible strings." << std::endl;
+
+        // Signature -> (hits, first node), so 32 virtio-mmio slots print as one line
+        auto signatures = currentSignatures();
+        std::map<std::string, std::pair<unsigned int, int>> hits;
+        auto note = [&hits](const char* signature, int node) {
+            auto& hit = hits.emplace(signature, std::make_pair(0u, node)).first->second;
+            hit.first++;
+        };
+        for (const auto& compatible : index.compatibles)
+        {
+            if (const char* signature = signatures->findFirst(SIG_DEVICETREE, compatible.value))
+                note(signature, compatible.node);
+        }
+        for (size_t node = 0; node < index.nodes.size(); node++)
+        {
+            if (const char* signature = signatures->findFirst(SIG_DEVICETREE, index.nodes[node].name))
+                note(signature, static_cast<int>(node));
+        }
+
+        for (const auto& [signature, hit] : hits)
+        {
+            std::cout << "Virtual platform signature \"" << signature << "\" at " << index.path(hit.second);
+            if (hit.first > 1) std::cout << " (" << hit.first << " matches)";
+            std::cout << std::endl;
+            recordEvidence("fdt:" + signature);
+            detected = true;
+        }
+        if (!detected)
+        {
+            std::cout << "No virtual platform nodes in the device tree." << std::endl;
+        }
+    }
+    return detected;
+}
+
 /**
     Test for checking EAX=0x40000000 for a Vendor ID string via CPUID.
  */
@@ -970,7 +1468,7 @@ bool checkVendorID() {
         );
 
         if (!(ecx & (1 << 31))) {
-            printf("No hypervisor detected (hypervisor bit not set).\n");
+            std::cout << "No hypervisor detected (hypervisor bit not set)." << std::endl;
             return false;
         }
 
@@ -989,27 +1487,52 @@ bool checkVendorID() {
 
         if (strlen(hyper_vendor) > 0) 
         {
-            printf("Hypervisor Vendor ID: %s\n", hyper_vendor);
+            std::cout << "Hypervisor Vendor ID: " << hyper_vendor << std::endl;
+            recordEvidence(std::string("cpuid-vendor:") + hyper_vendor);
             return true;
         } 
         else 
         {
-            printf("No Hypervisor Vendor ID found.\n");
+            std::cout << "No Hypervisor Vendor ID found." << std::endl;
             return false;
         }
     }
     else
     {
-        printf("Unsupported OS for hypervisor detection on x86 architecture.\n");
+        std::cout << "Unsupported OS for hypervisor detection on x86 architecture." << std::endl;
         return false;
     }
 #elif defined(__arm__) || defined(_M_ARM) ||  defined(__aarch64__) || defined(_M_ARM64)
     if (OS == OS_LINUX)
     {
-        // ARM-specific virtualization detection could be added here
-        // For now, we'll indicate that this operation is unsupported
-        std::cout << "Hypervisor detection via CPUID is not supported on ARM architectures.\n";
-        return false;
+        // No CPUID leaf on Arm: use what the kernel learned from SMCCC/PSCI discovery
+        HypervisorDiscovery discovery;
+        discoverHypervisor(discovery);
+        bool detected = false;
+
+        if (!discovery.xen_type.empty())
+        {
+            std::cout << "Hypervisor type: " << discovery.xen_type << " (/sys/hypervisor/type)\n";
+            recordEvidence("hypervisor:" + discovery.xen_type);
+            detected = true;
+        }
+        if (!discovery.kvm_ptp_clock.empty())
+        {
+            std::cout << "KVM vendor hypervisor service present: " << discovery.kvm_ptp_clock << " is the KVM virtual PTP clock\n";
+            recordEvidence("hypervisor:kvm");
+            detected = true;
+        }
+        if (!discovery.dt_hypervisor.empty())
+        {
+            std::cout << "Device tree hypervisor node: " << discovery.dt_hypervisor << "\n";
+            recordEvidence("hypervisor:dt:" + discovery.dt_hypervisor.substr(0, discovery.dt_hypervisor.find(',')));
+            detected = true;
+        }
+        if (!detected)
+        {
+            std::cout << "No hypervisor vendor discovered (load ptp_kvm to expose the KVM service).\n";
+        }
+        return detected;
     }
     else
     {
@@ -1044,9 +1567,10 @@ bool checkHypervisorBit()
         );
 
         if (ecx & (1 << 31)) {
-            printf("Hypervisor bit is set.\n");
+            cout << "Hypervisor bit is set." << endl;
+            recordEvidence("cpuid:hypervisor-bit");
         } else {
-            printf("Hypervisor bit is not set.\n");
+            cout << "Hypervisor bit is not set." << endl;
             return false;
         }
 
@@ -1068,7 +1592,60 @@ bool checkHypervisorBit()
 #elif defined(__arm__) || defined(_M_ARM) ||  defined(__aarch64__) || defined(_M_ARM64)
     if (OS == OS_LINUX)
     {
-        cout<<"On arm based processor, implement check hypervisor bit"<<endl;
+        bool detected = false;
+
+        std::vector<ArmCpuIdentity> cpus;
+        if (readArmCpuIdentity(cpus))
+        {
+            // Through cout rather than printf, so a container scan can route it per thread
+            char line[160];
+            for (const auto& id : cpus)
+            {
+                int n = snprintf(line, sizeof(line), "CPU %d: MIDR 0x%016llx (%s part 0x%03x r%up%u)", id.cpu,
+                                 static_cast<unsigned long long>(id.midr), armImplementerName(midrImplementer(id.midr)),
+                                 midrPartNum(id.midr), midrVariant(id.midr), midrRevision(id.midr));
+                if (id.has_revidr && n > 0 && static_cast<size_t>(n) < sizeof(line))
+                    snprintf(line + n, sizeof(line) - n, ", REVIDR 0x%016llx", static_cast<unsigned long long>(id.revidr));
+                cout << line << endl;
+                // Implementer 0 is reserved for software: an emulated CPU model, not silicon
+                if (midrImplementer(id.midr) == 0)
+                {
+                    recordEvidence("midr:software-defined");
+                    detected = true;
+                }
+            }
+        }
+        else
+        {
+            cout << "CPU identification registers not exposed in sysfs." << endl;
+        }
+
+        ArmFeatureRegisters features;
+        readArmFeatureRegisters(features);
+        if (features.ok)
+        {
+            char line[96];
+            snprintf(line, sizeof(line), "ID_AA64PFR0 0x%016llx, ID_AA64ISAR0 0x%016llx, ID_AA64MMFR0 0x%016llx",
+                     static_cast<unsigned long long>(features.pfr0), static_cast<unsigned long long>(features.isar0),
+                     static_cast<unsigned long long>(features.mmfr0));
+            cout << line << endl;
+        }
+
+        // PSCI over HVC: firmware calls are handled by a hypervisor at EL2
+        HypervisorDiscovery discovery;
+        discoverHypervisor(discovery);
+        if (discovery.dt_psci_method == "hvc" || discovery.acpi_psci_hvc)
+        {
+            cout << "PSCI conduit is HVC (" << (discovery.acpi_psci_hvc ? "ACPI FADT" : "device tree")
+                 << "): running under a hypervisor." << endl;
+            recordEvidence("psci:hvc");
+            detected = true;
+        }
+        else if (!discovery.dt_psci_method.empty() || discovery.acpi_fadt_read)
+        {
+            cout << "PSCI conduit is SMC (no hypervisor at EL2)." << endl;
+        }
+        return detected;
     }
 #else
     std::cout << "Unsupported architecture for hypervisor detection." << std::endl;
@@ -1087,25 +1664,24 @@ bool checkIODevices()
 
     if (OS == OS_LINUX) 
     {
-        ifstream io_device_file("/proc/bus/input/devices");
-        if (!io_device_file.is_open()) 
+        static thread_local FileReader io_device_file;
+        if (!io_device_file.read("/proc/bus/input/devices")) 
         {
             cerr << "Error opening /proc/bus/input/devices" << endl;
             return false;
         }
 
-        string line;
+        auto signatures = currentSignatures();
+        LineScanner lines(io_device_file.data());
+        std::string_view line;
         bool detected = false;
-        while (getline(io_device_file, line)) 
+        while (lines.next(line)) 
         {
-            for (const auto& signature : vm_signatures) 
-            {
-                if (line.find(signature) != string::npos) 
-                {
-                    cout << "Detected VM Vendor in IO devices: " << line << endl;
-                    detected = true;
-                }
-            }
+            signatures->scan(SIG_GENERAL, line, [&](const char* signature) {
+                cout << "Detected VM Vendor in IO devices: " << line << endl;
+                recordEvidence(std::string("io:") + signature);
+                detected = true;
+            });
         }
         return detected;
 
@@ -3,6 +3,9 @@
 
 #include <string> 
 #include <map>
+#include <cstdint>
+#include <vector>
+#include "perf_counters.h"
 
 // Architecture Detection Macros
 #if defined(__x86_64__) || defined(_M_X64) || defined(__amd64__)
@@ -62,10 +65,52 @@ enum ARCH_TYPE {
 extern OS_TYPE OS;
 extern ARCH_TYPE ARCH;
 
+// Outcome of one probe in the last scan
+struct ProbeResult {
+    bool detected = false;
+    bool timed_out = false;             // stopped by the watchdog (see probe_watchdog.h)
+    uint64_t elapsed_ns = 0;
+    std::vector<std::string> evidence;  // e.g. "dmi:qemu", "pci:1af4:1000"
+    ProbeCounters counters;             // filled when perf_counters_enabled
+};
+
+// Probes run by the last runAllTests()/runIndividualTest() call
+extern std::map<std::string, ProbeResult> probe_results;
+
+// Adds an evidence item to the probe currently being run (duplicates ignored)
+void recordEvidence(const std::string& item);
+
+// Measurements from checkTiming() and checkStealTime()
+struct TimingStats {
+    double cycles_per_op = 0.0;
+    double ns_per_op = 0.0;
+    double steal_pct = 0.0;
+    double run_delay_ms = 0.0;
+};
+extern TimingStats timing_stats;
+
 // Function declarations
 void displayHelp();
 std::map<std::string, bool> runAllTests();
 int runIndividualTest(const std::string& testName);
+// Runs only the named tests (unknown names are reported and skipped) into probe_results
+void runSelectedTests(const std::vector<std::string>& testNames);
+
+/**
+    A scan from a thread that has joined another process's mount and network
+    namespaces (see container_scan.h). Probes then see only that view: the
+    kernel snapshot is ignored, nothing is forked, and the environment is the
+    target's own rather than ours.
+ */
+struct NamespaceScan {
+    std::string environment;    // the target's /proc/<pid>/environ, read before joining
+};
+
+// Tests that can run in a namespace scan: file, netlink and CPUID reads only
+extern const std::vector<std::string> namespace_tests;
+
+// Runs namespace_tests on the calling thread into results; safe to call from several threads
+void runNamespaceTests(const NamespaceScan& scan, std::map<std::string, ProbeResult>& results);
 
 //individual tests
 bool checkIODevices();
@@ -74,6 +119,7 @@ bool checkVendorID();
 bool checkDMI();
 bool checkMAC();
 bool checkPCI();
+bool checkPCIDeep();
 bool checkTiming();
 bool checkDescriptorTables();
 bool checkACPI();
@@ -82,9 +128,18 @@ bool checkTiming();
 bool checkUSBDevices();
 bool checkEnvVars();
 bool checkLSMod();
+bool checkStealTime();
+bool checkDeviceTree();
 
 void displayResults(std::map<std::string, bool> test_results);
 
+// Path of the compiled OUI registry used by checkMAC
+extern std::string oui_db_path;
+
+// Maps the OUI registry now; call in the host's mount namespace, before any
+// container scan, since the first open is the one every later target uses
+void openOuiDatabase();
+
 
 
 uint64_t rdtsc_start();
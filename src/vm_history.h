@@ -0,0 +1,116 @@
+/*
+ * On-disk layout of the scan history kept by vm_detection -H <path>.
+ *
+ * <path> is an append-only log: a header, then one variable-size record per
+ * scan. <path>.idx is a small sorted array with one entry per record; it is
+ * only an accelerator and is rebuilt from the log whenever its generation
+ * does not match. Like vm_results_shm.h this header is plain C, all fields
+ * are little-endian and naturally aligned, with no implicit padding.
+ *
+ * A record is written with one pwrite and then indexed, so a crash leaves at
+ * most a torn last record, which fails its magic, size or checksum and is
+ * truncated away on the next open. Compaction rewrites both files under new
+ * names and renames them into place with a new generation; mappings readers
+ * already hold stay valid.
+ *
+ * struct vmd_history_header (64 bytes, at offset 0 of the log)
+ *     0     4  magic           VMD_HISTORY_MAGIC
+ *     4     2  version         VMD_HISTORY_VERSION
+ *     6     2  header_size     offset of the first record
+ *     8     8  generation      CLOCK_REALTIME when created or last compacted
+ *    16     8  compactions     times the log has been compacted
+ *    24    40  reserved
+ *
+ * struct vmd_history_record (88 bytes, followed by probe_count probes)
+ *     0     4  magic           VMD_HISTORY_RECORD_MAGIC
+ *     4     4  size            whole record, probes included
+ *     8     8  seq             scan number, kept across compaction
+ *    16     8  timestamp_ns    CLOCK_REALTIME when the scan finished
+ *    24    16  boot_id         /proc/sys/kernel/random/boot_id as bytes
+ *    40     8  checksum        FNV-1a 64 of the record with this field zero
+ *    48     4  flags           VMD_HISTORY_* change flags
+ *    52     2  probe_count
+ *    54     2  detected_count
+ *    56     8  cycles_per_op   timing_stats of the scan (0 when not run)
+ *    64     8  ns_per_op
+ *    72     8  steal_pct
+ *    80     8  run_delay_ms
+ *
+ * struct vmd_history_probe (40 bytes)
+ *     0    24  name            NUL-terminated test name
+ *    24     8  evidence_hash   FNV-1a 64 over the sorted evidence items
+ *    32     4  elapsed_us
+ *    36     2  evidence_count
+ *    38     1  detected
+ *    39     1  changed         verdict or evidence differs from the previous record
+ *
+ * Index file: struct vmd_history_index_header (32 bytes), then one
+ * struct vmd_history_index_entry (24 bytes) per record in log order.
+ */
+#ifndef VM_HISTORY_H
+#define VM_HISTORY_H
+
+#include <stdint.h>
+
+#define VMD_HISTORY_MAGIC           0x48444d56u  /* "VMDH" */
+#define VMD_HISTORY_RECORD_MAGIC    0x52444d56u  /* "VMDR" */
+#define VMD_HISTORY_INDEX_MAGIC     0x49444d56u  /* "VMDI" */
+#define VMD_HISTORY_VERSION         1
+#define VMD_HISTORY_NAME_LEN        24
+
+/* Record flags: what changed relative to the previous record */
+#define VMD_HISTORY_DRIFT           0x1u  /* a probe's evidence hash changed */
+#define VMD_HISTORY_VERDICT         0x2u  /* a probe's verdict changed */
+#define VMD_HISTORY_NEW_BOOT        0x4u  /* boot_id changed */
+
+struct vmd_history_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint64_t generation;
+    uint64_t compactions;
+    uint8_t  reserved[40];
+};
+
+struct vmd_history_probe {
+    char     name[VMD_HISTORY_NAME_LEN];
+    uint64_t evidence_hash;
+    uint32_t elapsed_us;
+    uint16_t evidence_count;
+    uint8_t  detected;
+    uint8_t  changed;
+};
+
+struct vmd_history_record {
+    uint32_t magic;
+    uint32_t size;
+    uint64_t seq;
+    uint64_t timestamp_ns;
+    uint8_t  boot_id[16];
+    uint64_t checksum;
+    uint32_t flags;
+    uint16_t probe_count;
+    uint16_t detected_count;
+    double   cycles_per_op;
+    double   ns_per_op;
+    double   steal_pct;
+    double   run_delay_ms;
+    /* struct vmd_history_probe probes[probe_count] follows */
+};
+
+struct vmd_history_index_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;
+    uint64_t generation;        /* matches the log header it indexes */
+    uint8_t  reserved[16];
+};
+
+struct vmd_history_index_entry {
+    uint64_t timestamp_ns;
+    uint64_t offset;            /* of the record in the log */
+    uint32_t size;
+    uint32_t flags;
+};
+
+#endif /* VM_HISTORY_H */
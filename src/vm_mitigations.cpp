@@ -1,72 +1,290 @@
 #include "vm_mitigations.h"
+#include "file_reader.h"
 #include <iostream>
 #include <map>
 #include <string>
 #include <filesystem>
+#include <algorithm>
+#include <set>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
 
 namespace fs = std::filesystem;
 
-const std::string kernel_module_dir = " ../kernel_modules/";
-const std::string make = "make -C ";
-const std::string insmod = "sudo insmod ";
-const std::string rmmod = "sudo rmmod ";
-const std::string ko_extension = ".ko";
+extern char** environ;
+
+// What each module is expected to hide; --verify holds it to exactly this
+static const std::vector<Mitigation> mitigations = {
+    {"dmi_module", "DMI masking module", {"dmi"}, {"dmi:", "dmidecode:"}},
+    {"acpi_mask_module", "ACPI masking module", {"acpi"}, {"acpi:"}},
+};
+
+static const char* const build_stamp_name = ".build_stamp";
+
+std::string mitigationModuleDir() {
+    static const std::string dir = [] {
+        // The binary is built in src/, the modules live beside it in kernel_modules/
+        std::error_code ec;
+        fs::path exe = fs::read_symlink("/proc/self/exe", ec);
+        if (!ec) {
+            fs::path modules = (exe.parent_path() / ".." / "kernel_modules").lexically_normal();
+            if (fs::is_directory(modules, ec)) return modules.string();
+        }
+        return std::string("../kernel_modules");
+    }();
+    return dir;
+}
+
+// Runs argv[0] from PATH without a shell, on our terminal so make output and sudo prompts reach the user
+static bool runCommand(const std::vector<std::string>& argv) {
+    std::vector<char*> args;
+    for (const auto& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+
+    pid_t pid;
+    int spawned = posix_spawnp(&pid, args[0], nullptr, nullptr, args.data(), environ);
+    if (spawned != 0) {
+        std::cerr << "Error: cannot run " << argv[0] << ": " << strerror(spawned) << std::endl;
+        return false;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static std::string kernelRelease() {
+    struct utsname name;
+    if (uname(&name) != 0) return std::string();
+    return name.release;
+}
+
+// FNV-1a over the name and contents of every file that goes into the build
+static uint64_t sourceHash(const std::string& dir) {
+    std::vector<fs::path> sources;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::string name = entry.path().filename().string();
+        if (ext == ".c" || ext == ".h" || name == "Makefile" || name == "Kbuild") sources.push_back(entry.path());
+    }
+    // Layout header shared with the scanner (see ccflags-y in the Makefile)
+    sources.push_back(fs::path(dir) / ".." / "src" / "vmd_snapshot.h");
+    std::sort(sources.begin(), sources.end());
+
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](std::string_view bytes) {
+        for (unsigned char c : bytes) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+    };
+    FileReader file;
+    for (const auto& path : sources) {
+        mix(path.filename().string());
+        if (file.read(path.c_str())) mix(file.data());
+    }
+    return hash;
+}
+
+static std::string buildStamp(const std::string& dir) {
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(sourceHash(dir)));
+    return kernelRelease() + " " + hash + "\n";
+}
+
+static bool modulesUpToDate(const std::string& dir, const std::string& stamp) {
+    FileReader file;
+    if (!file.read((dir + "/" + build_stamp_name).c_str()) || file.data() != stamp) return false;
+    for (const auto& mitigation : mitigations) {
+        if (access((dir + "/" + mitigation.module + ".ko").c_str(), R_OK) != 0) return false;
+    }
+    return true;
+}
 
 bool buildModules(){
-    int result = std::system( (make + kernel_module_dir).c_str() );
-    if(result != 0)
+    const std::string dir = mitigationModuleDir();
+    const std::string stamp = buildStamp(dir);
+    if (modulesUpToDate(dir, stamp))
+    {
+        std::cout << "Kernel modules are up to date for " << kernelRelease() << "." << std::endl;
+        return true;
+    }
+
+    std::cout << "\nBuilding kernel modules..." << std::endl;
+    if (!runCommand({"make", "-C", dir}))
     {
         std::cerr << "Error: Failed to build kernel module." << std::endl;
         return false;
     }
+    // Only stamp a build that actually left the modules in dir
+    for (const auto& mitigation : mitigations) {
+        if (access((dir + "/" + mitigation.module + ".ko").c_str(), R_OK) != 0) {
+            std::cerr << "Error: make succeeded but " << dir << "/" << mitigation.module << ".ko is missing." << std::endl;
+            return false;
+        }
+    }
+
+    FILE* out = fopen((dir + "/" + build_stamp_name).c_str(), "w");
+    if (out) {
+        fputs(stamp.c_str(), out);
+        fclose(out);
+    }
     return true;
 }
 
-void applyMitigations(const std::map<std::string, bool> test_results) {
-    std::cout <<"\nBuilding kernel modules..."<<std::endl;
-    buildModules();
+// "live" (or "coming") in /sys/module/<name>/initstate means there is nothing to load
+static bool moduleLoaded(const std::string& module) {
+    FileReader state;
+    if (!state.read(("/sys/module/" + module + "/initstate").c_str())) return false;
+    std::string_view value = trim(state.data());
+    return value == "live" || value == "coming";
+}
+
+bool loadMitigationModules(const std::vector<std::string>& modules) {
+    const std::string dir = mitigationModuleDir();
+    std::vector<std::string> need_sudo;
+    bool ok = true;
+
+    for (const auto& module : modules) {
+        if (moduleLoaded(module)) {
+            std::cout << "  " << module << " is already loaded." << std::endl;
+            continue;
+        }
+        std::string path = dir + "/" + module + ".ko";
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "Error: cannot open " << path << ": " << strerror(errno) << std::endl;
+            ok = false;
+            continue;
+        }
+        long result = syscall(SYS_finit_module, fd, "", 0);
+        int err = errno;
+        close(fd);
+
+        if (result == 0 || err == EEXIST) {
+            std::cout << "  " << module << (result == 0 ? " loaded." : " is already loaded.") << std::endl;
+        } else if (err == EPERM && geteuid() != 0) {
+            need_sudo.push_back(path);
+        } else {
+            std::cerr << "Error: Failed to load kernel module " << module << ": " << strerror(err) << std::endl;
+            ok = false;
+        }
+    }
+
+    // Without CAP_SYS_MODULE, one sudo for the whole batch; the paths go in as arguments,
+    // never into the script, so no directory name can reach the shell as code
+    if (!need_sudo.empty()) {
+        std::vector<std::string> command = {"sudo", "sh", "-c", "for m; do insmod \"$m\" || exit 1; done", "sh"};
+        command.insert(command.end(), need_sudo.begin(), need_sudo.end());
+        if (!runCommand(command)) {
+            std::cerr << "Error: Failed to load kernel modules with sudo" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+std::vector<const Mitigation*> selectMitigations(const std::map<std::string, bool>& test_results) {
+    std::vector<const Mitigation*> selected;
+    for (const auto& mitigation : mitigations) {
+        for (const auto& probe : mitigation.probes) {
+            auto it = test_results.find(probe);
+            if (it == test_results.end() || !it->second) continue;
+            std::cout << "Selected " << mitigation.description << " for the " << probe << " detection." << std::endl;
+            selected.push_back(&mitigation);
+            break;
+        }
+    }
+    return selected;
+}
+
+// Builds if needed, then loads every selected module in one pass
+static bool applySelected(const std::vector<const Mitigation*>& selected) {
+    if (selected.empty()) {
+        std::cout << "\nNo mitigations available for the detected artifacts." << std::endl;
+        return true;
+    }
+    if (!buildModules()) return false;
+
+    std::vector<std::string> modules;
+    for (const Mitigation* mitigation : selected) modules.push_back(mitigation->module);
     std::cout << "\nApplying mitigation techniques for detected artifacts...\n";
+    if (!loadMitigationModules(modules)) return false;
+    std::cout << "\nMitigations applied!" << std::endl;
+    return true;
+}
 
-    // Check each test and apply mitigation if it was detected
-    for (const auto& [testName, detected] : test_results) {
-        if (detected) {
-            if(testName == "dmi") mitigateDMI();
-            else if (testName == "acpi") mitigateACPI();
-        /** 
-            else if (testName == "io") mitigateIODevices();
-            else if (testName == "cpu") mitigateCPU();
-            else if (testName == "cpuid-vendor") mitigateVendorID();
-            else if (testName == "dmi") mitigateDMI();
-            else if (testName == "mac") mitigateMAC();
-            else if (testName == "pci") mitigatePCI();
-            else if (testName == "timing") mitigateTiming();
-            else if (testName == "desc-tables") mitigateDescriptorTables();
-            else if (testName == "acpi") mitigateACPI();
-            else if (testName == "lscpu") mitigateLSCPU();
-            else if (testName == "usb") mitigateUSB();
-            else if (testName == "env") mitigateEnvVars();
-            else cout << "No mitigation available for test: " << testName << endl;
-        */
+void applyMitigations(const std::map<std::string, bool> test_results) {
+    applySelected(selectMitigations(test_results));
+}
+
+// Evidence of the mitigation's probes that it is supposed to clear
+static std::set<std::string> targetedEvidence(const Mitigation& mitigation, const std::map<std::string, ProbeResult>& results) {
+    std::set<std::string> items;
+    for (const auto& probe : mitigation.probes) {
+        auto it = results.find(probe);
+        if (it == results.end()) continue;
+        for (const auto& item : it->second.evidence) {
+            for (const auto& prefix : mitigation.clears) {
+                if (item.compare(0, prefix.size(), prefix) == 0) {
+                    items.insert(item);
+                    break;
+                }
+            }
         }
     }
-    std::cout << "\nMitigations applied!";
+    return items;
 }
 
+bool mitigateAndVerify(const std::map<std::string, ProbeResult>& before, bool verify) {
+    std::map<std::string, bool> detections;
+    for (const auto& [name, result] : before) detections[name] = result.detected;
 
-bool mitigateACPI()
-{
-    std::cout<< "Mitigating ACPI Detections..."<< std::endl;
-    const std::string module_name = "acpi_mask_module.ko";
+    std::vector<const Mitigation*> selected = selectMitigations(detections);
+    if (!applySelected(selected)) return false;
+    if (!verify || selected.empty()) return true;
 
-    std::string load_command = insmod + kernel_module_dir + module_name;
-    int insmod_result = std::system(load_command.c_str());
+    // Only the probes the loaded mitigations claim to affect
+    std::vector<std::string> probes;
+    for (const Mitigation* mitigation : selected) {
+        for (const auto& probe : mitigation->probes) {
+            if (std::find(probes.begin(), probes.end(), probe) == probes.end()) probes.push_back(probe);
+        }
+    }
+    std::cout << "\nRe-running " << probes.size() << " of " << before.size() << " probes to verify..." << std::endl;
+    runSelectedTests(probes);
+    const std::map<std::string, ProbeResult> after = probe_results;
 
-    if (insmod_result != 0)
-    {
-        std::cerr<<"Error: Failed to load kernel module" << std::endl;
-        return false;
+    size_t passed = 0;
+    for (const Mitigation* mitigation : selected) {
+        std::set<std::string> old_items = targetedEvidence(*mitigation, before);
+        std::set<std::string> new_items = targetedEvidence(*mitigation, after);
+
+        std::cout << "\n===== Verifying " << mitigation->module << " (" << mitigation->description << ") =====" << std::endl;
+        for (const auto& item : old_items)
+            std::cout << (new_items.count(item) ? "  = " : "  - ") << item << (new_items.count(item) ? "  (still present)" : "  (cleared)") << std::endl;
+        for (const auto& item : new_items) {
+            if (!old_items.count(item)) std::cout << "  + " << item << "  (new)" << std::endl;
+        }
+        bool pass = new_items.empty();
+        std::cout << "Result: " << (pass ? "PASS" : "FAIL") << std::endl;
+        if (pass) passed++;
     }
+    std::cout << "\nMitigation verification: " << passed << " passed, " << selected.size() - passed << " failed." << std::endl;
+    return passed == selected.size();
+}
+
 
+bool mitigateACPI()
+{
+    std::cout<< "Mitigating ACPI Detections..."<< std::endl;
+    if (!buildModules() || !loadMitigationModules({"acpi_mask_module"})) return false;
     std::cout<<"ACPI masking module applied."<<std::endl;
     return true;
 }
@@ -74,16 +292,7 @@ bool mitigateACPI()
 bool mitigateDMI()
 {
     std::cout << "Mitigating DMI Detections...\n  Loading kernel module..." << std::endl;
-    const std::string module_name = "dmi_module.ko";
-
-    std::string load_command = insmod + kernel_module_dir + module_name;
-    int insmod_result = std::system(load_command.c_str());
-
-    if (insmod_result != 0)
-    {
-        std::cerr<<"Error: Failed to load kernel module" << std::endl;
-        return false;
-    }
+    if (!buildModules() || !loadMitigationModules({"dmi_module"})) return false;
     std::cout<<"DMI masking module applied."<<std::endl;
     return true;
-}
\ No newline at end of file
+}
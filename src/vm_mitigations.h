@@ -3,8 +3,47 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include "vm_detection.h"
+
+// One kernel module that hides the artifacts some probes look for
+struct Mitigation {
+    const char* module;                 // module name as in /sys/module, e.g. "dmi_module"
+    const char* description;
+    std::vector<std::string> probes;    // probes whose detection selects it, re-run by --verify
+    std::vector<std::string> clears;    // evidence prefixes it must remove, e.g. "dmi:"
+};
+
+// Mitigations whose probes reported a detection, each once
+std::vector<const Mitigation*> selectMitigations(const std::map<std::string, bool>& test_results);
+
+// Directory holding the module sources and .ko files, next to the executable by default
+std::string mitigationModuleDir();
+
+/**
+    Rebuilds the modules only when the sources or the running kernel changed
+    since the last build, judged by a stamp (kernel release plus a content
+    hash of the sources) written after each successful build.
+ */
+bool buildModules();
+
+/**
+    Loads the named modules in one pass: modules already live in /sys/module
+    are skipped and the rest go through finit_module directly (one batched
+    sudo insmod when not running as root).
+ */
+bool loadMitigationModules(const std::vector<std::string>& modules);
 
 void applyMitigations(const std::map<std::string, bool> test_results);
+
+/**
+    Non-interactive --mitigate: loads the mitigations for the detections in
+    before. With verify, re-runs only the probes those mitigations declare
+    and prints a before/after diff of the evidence each is meant to clear.
+    Returns false if loading failed or any mitigation left its evidence.
+ */
+bool mitigateAndVerify(const std::map<std::string, ProbeResult>& before, bool verify);
+
 bool mitigateDMI();
 bool mitigateACPI();
 #endif // VM_MITIGATIONS_H
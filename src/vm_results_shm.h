@@ -0,0 +1,91 @@
+/*
+ * Layout of the shared-memory results segment published by vm_detection -s.
+ *
+ * This header is plain C so that agents can include it directly; Go and
+ * Python consumers can map the same layout from the offsets listed below.
+ * All fields are little-endian (native on x86_64/aarch64) and naturally
+ * aligned, with no implicit padding.
+ *
+ * Concurrency is a seqlock with a single writer, which holds flock(LOCK_EX)
+ * on the file for as long as it publishes:
+ *   1. s1 = seq (acquire load). If s1 is odd a write is in progress, retry.
+ *   2. Copy the fields you need.
+ *   3. s2 = seq (acquire fence, then load). If s1 != s2, retry from 1.
+ * A reader never blocks the writer and needs no syscalls once mapped.
+ *
+ * struct vmd_results (total_size bytes)
+ *   off  size  field
+ *     0     4  magic           VMD_RESULTS_MAGIC
+ *     4     2  version         VMD_RESULTS_VERSION
+ *     6     2  header_size     offset of probes[0]
+ *     8     4  total_size      size of the whole segment
+ *    12     4  probe_slot_size sizeof(struct vmd_probe_slot)
+ *    16     8  seq             seqlock counter, odd while writing
+ *    24     8  scan_count      completed scans
+ *    32     8  last_scan_ns    CLOCK_REALTIME of the last scan
+ *    40     4  probe_count     slots in use
+ *    44     4  detected_count  slots whose latest verdict is "detected"
+ *    48     4  verdict         1 if any probe currently detects a VM
+ *    52     4  writer_pid
+ *    56        probes[VMD_RESULTS_MAX_PROBES]
+ *
+ * struct vmd_probe_slot (1072 bytes)
+ *     0    24  name            NUL-terminated test name, e.g. "cpuid-vendor"
+ *    24     4  history_head    samples ever written; newest is
+ *                              history[(history_head - 1) % VMD_RESULTS_HISTORY]
+ *    28     4  reserved
+ *    32    16  latest          most recent sample
+ *    48  1024  history[VMD_RESULTS_HISTORY]
+ *
+ * struct vmd_probe_sample (16 bytes)
+ *     0     8  timestamp_ns    CLOCK_REALTIME when the probe finished
+ *     8     4  elapsed_us      probe run time
+ *    12     1  detected        0 or 1
+ *    13     1  timed_out       1 if the watchdog stopped the probe at its budget
+ *    14     2  reserved
+ */
+#ifndef VM_RESULTS_SHM_H
+#define VM_RESULTS_SHM_H
+
+#include <stdint.h>
+
+#define VMD_RESULTS_MAGIC       0x31444d56u  /* "VMD1" */
+#define VMD_RESULTS_VERSION     2    /* 2: vmd_probe_sample.timed_out */
+#define VMD_RESULTS_MAX_PROBES  32
+#define VMD_RESULTS_HISTORY     64
+#define VMD_RESULTS_NAME_LEN    24
+#define VMD_RESULTS_PATH        "/run/vm_detection/results"
+
+struct vmd_probe_sample {
+    uint64_t timestamp_ns;
+    uint32_t elapsed_us;
+    uint8_t  detected;
+    uint8_t  timed_out;
+    uint8_t  reserved[2];
+};
+
+struct vmd_probe_slot {
+    char     name[VMD_RESULTS_NAME_LEN];
+    uint32_t history_head;
+    uint32_t reserved;
+    struct vmd_probe_sample latest;
+    struct vmd_probe_sample history[VMD_RESULTS_HISTORY];
+};
+
+struct vmd_results {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t total_size;
+    uint32_t probe_slot_size;
+    uint64_t seq;
+    uint64_t scan_count;
+    uint64_t last_scan_ns;
+    uint32_t probe_count;
+    uint32_t detected_count;
+    uint32_t verdict;
+    uint32_t writer_pid;
+    struct vmd_probe_slot probes[VMD_RESULTS_MAX_PROBES];
+};
+
+#endif /* VM_RESULTS_SHM_H */
@@ -0,0 +1,120 @@
+/*
+ * Layout of the artifact snapshot served by kernel_modules/snapshot_module.c
+ * on /dev/vmd_snapshot.
+ *
+ * Each open() builds a fresh snapshot; read() returns it from offset 0, so a
+ * buffer of at least total_size bytes gets the whole scan input in one
+ * syscall. This header is plain C and shared by the module and the scanner.
+ * All fields are native-endian and naturally aligned, with no implicit
+ * padding; sections start on 8-byte boundaries.
+ *
+ * struct vmd_snapshot_header (32 bytes)
+ *   off  size  field
+ *     0     4  magic           VMD_SNAPSHOT_MAGIC
+ *     4     2  version         VMD_SNAPSHOT_VERSION
+ *     6     2  header_size     offset of the section table
+ *     8     4  total_size      size of the whole snapshot
+ *    12     4  section_count   entries in the section table
+ *    16     8  generation      snapshots built since the module loaded
+ *    24     8  timestamp_ns    CLOCK_REALTIME when the snapshot was built
+ *
+ * struct vmd_snapshot_section (16 bytes), section_count of them
+ *     0     4  type            VMD_SNAP_*
+ *     4     4  entry_size      sizeof the entry struct the writer used
+ *     8     4  count
+ *    12     4  offset          from the start of the snapshot
+ *
+ * Readers must skip unknown section types and accept an entry_size larger
+ * than the struct they know (fields are only ever appended).
+ */
+#ifndef VMD_SNAPSHOT_H
+#define VMD_SNAPSHOT_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#define VMD_SNAPSHOT_MAGIC      0x4b444d56u  /* "VMDK" */
+#define VMD_SNAPSHOT_VERSION    1
+#define VMD_SNAPSHOT_DEVICE     "/dev/vmd_snapshot"
+
+enum vmd_snapshot_type {
+    VMD_SNAP_DMI = 1,
+    VMD_SNAP_ACPI = 2,
+    VMD_SNAP_PCI = 3,
+    VMD_SNAP_MODULES = 4,
+    VMD_SNAP_NETDEV = 5,
+    VMD_SNAP_CPU = 6,
+};
+
+struct vmd_snapshot_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t total_size;
+    uint32_t section_count;
+    uint64_t generation;
+    uint64_t timestamp_ns;
+};
+
+struct vmd_snapshot_section {
+    uint32_t type;
+    uint32_t entry_size;
+    uint32_t count;
+    uint32_t offset;
+};
+
+/* One dmi_get_system_info() string, named after its /sys/class/dmi/id file */
+struct vmd_snap_dmi {
+    char field[24];             /* "sys_vendor" */
+    char value[104];            /* NUL-terminated, truncated */
+};
+
+/* The common ACPI table header, as installed */
+struct vmd_snap_acpi {
+    char     signature[4];
+    uint32_t length;
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem_id[6];
+    char     oem_table_id[8];
+    uint32_t oem_revision;
+    char     creator_id[4];
+    uint32_t creator_revision;
+};
+
+struct vmd_snap_pci {
+    char     slot[16];          /* "0000:00:03.0" */
+    uint16_t vendor;
+    uint16_t device;
+    uint16_t subsystem_vendor;
+    uint16_t subsystem_device;
+    uint32_t class_code;        /* base, sub-class, prog-if */
+    uint32_t reserved;
+};
+
+struct vmd_snap_module {
+    char name[64];
+};
+
+struct vmd_snap_netdev {
+    char     name[16];
+    char     parent_bus[16];    /* "pci", "virtio"; empty for software links */
+    char     parent_dev[32];    /* "0000:00:03.0", "virtio0" */
+    uint32_t type;              /* ARPHRD_* */
+    uint8_t  addr[6];           /* zero unless the link has a 6-byte address */
+    uint8_t  perm_addr[6];      /* burned-in address, zero if unknown */
+};
+
+/* Descriptor table registers read in the kernel on each online CPU (x86 only) */
+struct vmd_snap_cpu {
+    uint32_t cpu;
+    uint16_t gdt_limit;
+    uint16_t idt_limit;
+    uint64_t gdt_base;
+    uint64_t idt_base;
+};
+
+#endif /* VMD_SNAPSHOT_H */